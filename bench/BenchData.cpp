@@ -0,0 +1,30 @@
+#include "BenchData.hpp"
+#include "ContactFormat.hpp"
+
+namespace bench {
+
+namespace {
+
+void write_contacts(const std::string& path, ContactFormat format, std::size_t rows)
+{
+    FileWriter file(path);
+    auto writer = make_contact_writer(format, file);
+    writer->begin();
+    for (std::size_t i = 0; i < rows; ++i)
+        writer->write(make_contact(i));
+    file.finish();
+}
+
+} // namespace
+
+void write_csv(const std::string& path, std::size_t rows)
+{
+    write_contacts(path, ContactFormat::csv, rows);
+}
+
+void write_jsonl(const std::string& path, std::size_t rows)
+{
+    write_contacts(path, ContactFormat::jsonl, rows);
+}
+
+} // namespace bench
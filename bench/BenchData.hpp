@@ -0,0 +1,88 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "ContactStore.hpp"
+#include "FileWriter.hpp"
+#include "Metrics.hpp"
+
+// Synthetic data and reporting shared by the benchmarks. Rows are
+// generated, not random, so every run measures the same input.
+namespace bench {
+
+// Rows to generate: the first argument, else 1,000,000
+inline std::size_t row_count(int argc, char* argv[])
+{
+    return argc > 1 ? static_cast<std::size_t>(std::strtoull(argv[1], nullptr, 10)) : 1000000;
+}
+
+// Row i; about one in sixteen names needs quoting in CSV
+inline Contact make_contact(std::size_t i)
+{
+    Contact c;
+    c.first_name = "First" + std::to_string(i % 9973);
+    c.last_name = (i % 16 == 0 ? "O'Neil, Jr " : "Last") + std::to_string((i * 7919) % 1000003);
+    c.email = "user" + std::to_string(i) + "@example" + std::to_string(i % 97) + ".com";
+    c.mobile = "+1 555 " + std::to_string(1000000 + i % 9000000);
+    return c;
+}
+
+inline std::vector<Contact> make_contacts(std::size_t first, std::size_t count)
+{
+    std::vector<Contact> rows;
+    rows.reserve(count);
+    for (std::size_t i = first; i < first + count; ++i)
+        rows.push_back(make_contact(i));
+    return rows;
+}
+
+inline void fill(ContactStore& store, std::size_t rows)
+{
+    constexpr std::size_t kBatch = 10000;
+    for (std::size_t i = 0; i < rows; i += kBatch)
+        store.insert_batch(make_contacts(i, std::min(kBatch, rows - i)));
+}
+
+// Writes rows contacts as CSV with a header to path
+void write_csv(const std::string& path, std::size_t rows);
+// Writes rows contacts as JSON Lines to path
+void write_jsonl(const std::string& path, std::size_t rows);
+
+// A file under the system temp directory, removed when this goes away
+class TempFile {
+public:
+    explicit TempFile(const std::string& name)
+    : m_path((std::filesystem::temp_directory_path() / name).string())
+    {
+    }
+    ~TempFile()
+    {
+        std::error_code ignored;
+        std::filesystem::remove(m_path, ignored);
+    }
+
+    TempFile(const TempFile&) = delete;
+    TempFile& operator=(const TempFile&) = delete;
+
+    const std::string& path() const { return m_path; }
+
+private:
+    std::string m_path;
+};
+
+// Records name through metrics::record and prints rows/s and MB/s
+inline void report(const std::string& name, double ms, std::size_t rows, std::uint64_t bytes)
+{
+    metrics::record("bench." + name, ms);
+    double seconds = ms / 1000.0;
+    std::cout << "  " << name << ": " << rows << " rows, "
+              << static_cast<std::uint64_t>(rows / seconds) << " rows/s, "
+              << bytes / seconds / (1 << 20) << " MB/s\n";
+}
+
+} // namespace bench
@@ -0,0 +1,38 @@
+// CSV reading: the raw RFC 4180 scan, then the same file decoded and
+// validated into Contacts as an import does.
+//
+//   bench_csv_scan [rows]
+#include "BenchData.hpp"
+#include "ContactSource.hpp"
+#include "CsvParser.hpp"
+#include "MappedFile.hpp"
+
+int main(int argc, char* argv[])
+{
+    const std::size_t rows = bench::row_count(argc, argv);
+    bench::TempFile csv("contacts-bench-scan.csv");
+    bench::write_csv(csv.path(), rows);
+    MappedFile file(csv.path());
+    std::cout << "CSV scan, " << rows << " rows, " << file.size() << " bytes, "
+              << CsvReader::simd_level() << " kernel\n";
+
+    {
+        metrics::Stopwatch timer;
+        CsvReader reader(file.data());
+        std::vector<CsvField> fields;
+        std::size_t records = 0;
+        while (reader.next(fields))
+            ++records;
+        bench::report("csv_scan.records", timer.elapsed_ms(), records, file.size());
+    }
+    {
+        metrics::Stopwatch timer;
+        CsvContactSource source(file);
+        Contact contact;
+        std::size_t decoded = 0;
+        while (source.next(contact))
+            ++decoded;
+        bench::report("csv_scan.contacts", timer.elapsed_ms(), decoded, file.size());
+    }
+    return 0;
+}
@@ -0,0 +1,37 @@
+// Export from an InMemoryStore through FileWriter in each format, serially
+// and in parallel id-range partitions.
+//
+//   bench_export_writer [rows]
+#include "BenchData.hpp"
+#include "Compression.hpp"
+#include "ContactExport.hpp"
+#include "InMemoryStore.hpp"
+
+int main(int argc, char* argv[])
+{
+    const std::size_t rows = bench::row_count(argc, argv);
+    InMemoryStore store;
+    bench::fill(store, rows);
+    std::cout << "Export, " << rows << " rows\n";
+
+    std::vector<std::string> names = {"contacts-bench.csv", "contacts-bench.csv.gz",
+                                      "contacts-bench.jsonl", "contacts-bench.vcf"};
+    if (codec_available(Codec::zstd))
+        names.push_back("contacts-bench.csv.zst");
+
+    for (const auto& name : names) {
+        for (unsigned int partitions : {1u, 4u}) {
+            bench::TempFile out(name);
+            ExportOptions options;
+            options.format = format_for_path(name);
+            options.file.codec = codec_for_path(name);
+            options.partitions = partitions;
+            options.min_partition_rows = 1;
+            metrics::Stopwatch timer;
+            ExportProgress progress = ContactExporter(store, options).run(out.path());
+            bench::report("export." + name + "_" + std::to_string(partitions) + "p",
+                          timer.elapsed_ms(), progress.rows_written, progress.bytes_written);
+        }
+    }
+    return 0;
+}
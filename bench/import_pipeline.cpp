@@ -0,0 +1,38 @@
+// CSV import into an InMemoryStore: one stream over one handle, then the
+// chunked parallel pipeline. The store is in process, so this measures
+// parsing, validation and batching rather than a server.
+//
+//   bench_import_pipeline [rows]
+#include "BenchData.hpp"
+#include "ContactSource.hpp"
+#include "ImportPipeline.hpp"
+#include "InMemoryStore.hpp"
+#include "MappedFile.hpp"
+
+int main(int argc, char* argv[])
+{
+    const std::size_t rows = bench::row_count(argc, argv);
+    bench::TempFile csv("contacts-bench-import.csv");
+    bench::write_csv(csv.path(), rows);
+    MappedFile file(csv.path());
+    std::cout << "Import, " << rows << " rows, " << file.size() << " bytes\n";
+
+    {
+        InMemoryStore store;
+        CsvContactSource source(file);
+        metrics::Stopwatch timer;
+        std::size_t imported = store.import_stream(source);
+        bench::report("import.stream", timer.elapsed_ms(), imported, file.size());
+    }
+    for (unsigned int writers : {1u, 2u, 4u}) {
+        InMemoryStore store;
+        ImportOptions options;
+        options.writer_connections = writers;
+        MappedFile mapped(csv.path());
+        metrics::Stopwatch timer;
+        ImportProgress progress = ImportPipeline(store, options).run(mapped);
+        bench::report("import.pipeline_" + std::to_string(writers) + "w",
+                      timer.elapsed_ms(), progress.rows_imported, file.size());
+    }
+    return 0;
+}
@@ -0,0 +1,36 @@
+// JSON Lines reading: records decoded and validated into Contacts, then
+// the same file imported into an InMemoryStore as one stream.
+//
+//   bench_jsonl_scan [rows]
+#include "BenchData.hpp"
+#include "InMemoryStore.hpp"
+#include "Jsonl.hpp"
+#include "MappedFile.hpp"
+
+int main(int argc, char* argv[])
+{
+    const std::size_t rows = bench::row_count(argc, argv);
+    bench::TempFile jsonl("contacts-bench-scan.jsonl");
+    bench::write_jsonl(jsonl.path(), rows);
+    MappedFile file(jsonl.path());
+    std::cout << "JSON Lines scan, " << rows << " rows, " << file.size() << " bytes\n";
+
+    {
+        metrics::Stopwatch timer;
+        JsonlContactSource source(file);
+        Contact contact;
+        std::size_t decoded = 0;
+        while (source.next(contact))
+            ++decoded;
+        bench::report("jsonl_scan.contacts", timer.elapsed_ms(), decoded, file.size());
+    }
+    {
+        InMemoryStore store;
+        MappedFile mapped(jsonl.path());
+        JsonlContactSource source(mapped);
+        metrics::Stopwatch timer;
+        std::size_t imported = store.import_stream(source);
+        bench::report("jsonl_scan.import", timer.elapsed_ms(), imported, file.size());
+    }
+    return 0;
+}
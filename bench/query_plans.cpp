@@ -0,0 +1,41 @@
+// Query plans on a real server: fills a scratch database's contacts table
+// to rows contacts if it has fewer, then runs DB::check_query_plans() and
+// exits 1 if any list, page, sort or domain query would not walk its
+// index. Point it at a database it may write to, never a live one.
+//
+//   bench_query_plans host user password database [rows] (default 10,000)
+#include "BenchData.hpp"
+#include "DB.hpp"
+
+int main(int argc, char* argv[])
+{
+    if (argc < 5) {
+        std::cerr << "usage: " << argv[0] << " host user password database [rows]\n";
+        return 2;
+    }
+    const std::size_t rows = argc > 5 ? std::strtoull(argv[5], nullptr, 10) : 10000;
+
+    try {
+        DB db(argv[1], argv[2], argv[3], argv[4]);
+        db.initialize_schema();
+
+        const std::size_t existing = static_cast<std::size_t>(db.get_contact_count());
+        constexpr std::size_t kBatch = 10000;
+        for (std::size_t i = existing; i < rows; i += kBatch)
+            db.insert_batch(bench::make_contacts(i, std::min(kBatch, rows - i)));
+        std::cout << "Query plans, " << std::max(existing, rows) << " rows\n";
+
+        metrics::Stopwatch timer;
+        std::vector<std::string> problems = db.check_query_plans();
+        metrics::record("bench.query_plans", timer.elapsed_ms());
+        for (const auto& problem : problems)
+            std::cout << "  " << problem << "\n";
+        if (problems.empty())
+            std::cout << "  every plan walks its index\n";
+        return problems.empty() ? 0 : 1;
+    }
+    catch (const DBException& e) {
+        std::cerr << e.what() << "\n";
+        return 2;
+    }
+}
@@ -0,0 +1,92 @@
+// Heap allocations made by one InMemoryStore::search_contacts call: into a
+// std::vector<Contact>, then into a std::pmr::monotonic_buffer_resource.
+// A replacement operator new counts every allocation in the process, so
+// the resource's own chunks count too.
+//
+//   bench_search_allocations [rows] (default 10,000)
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "BenchData.hpp"
+#include "InMemoryStore.hpp"
+
+namespace {
+
+std::atomic<std::size_t> g_allocations{0};
+
+// Allocations made by fn
+template <class Fn>
+std::size_t count_allocations(Fn&& fn)
+{
+    const std::size_t before = g_allocations.load();
+    fn();
+    return g_allocations.load() - before;
+}
+
+} // namespace
+
+void* operator new(std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+// std::pmr::new_delete_resource allocates through the aligned forms
+void* operator new(std::size_t size, std::align_val_t align)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    const std::size_t alignment = std::max(static_cast<std::size_t>(align), sizeof(void*));
+    void* p = nullptr;
+    if (::posix_memalign(&p, alignment, size ? size : 1) == 0)
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+int main(int argc, char* argv[])
+{
+    const std::size_t rows = argc > 1 ? bench::row_count(argc, argv) : 10000;
+    InMemoryStore store;
+    bench::fill(store, rows);
+    const std::string query = "first1";
+    std::cout << "Search allocations, " << rows << " rows, query \"" << query << "\"\n";
+
+    std::size_t matched = 0;
+    std::size_t vector_allocations = count_allocations([&]() {
+        std::vector<Contact> found = store.search_contacts(query);
+        matched = found.size();
+    });
+    std::cout << "  std::vector<Contact>: " << matched << " rows, "
+              << vector_allocations << " allocations\n";
+
+    std::size_t pmr_allocations = count_allocations([&]() {
+        std::pmr::monotonic_buffer_resource arena;
+        std::pmr::vector<PmrContact> found = store.search_contacts(query, &arena);
+        matched = found.size();
+    });
+    std::cout << "  monotonic_buffer_resource: " << matched << " rows, "
+              << pmr_allocations << " allocations\n";
+    return 0;
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <glibmm/dispatcher.h>
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace detail {
+
+// State shared between a BackgroundTask and its worker threads. Outlives the
+// task object so a worker that finishes late never touches a dead widget.
+struct TaskShared {
+    std::mutex mutex;
+    std::deque<std::function<void()>> ready;
+    Glib::Dispatcher* dispatcher = nullptr;
+};
+
+} // namespace detail
+
+// Handed to the work function; lets it poll for cancellation and post
+// intermediate updates (e.g. progress) to the GTK main loop.
+class TaskContext {
+public:
+    bool cancelled() const { return m_cancel->load(); }
+
+    // Runs fn on the GTK main loop, unless the task is cancelled first
+    void post(std::function<void()> fn) const;
+
+private:
+    friend class BackgroundTask;
+    TaskContext(std::shared_ptr<detail::TaskShared> shared,
+                std::shared_ptr<std::atomic<bool>> cancel)
+    : m_shared(std::move(shared)), m_cancel(std::move(cancel)) {}
+
+    std::shared_ptr<detail::TaskShared> m_shared;
+    std::shared_ptr<std::atomic<bool>> m_cancel;
+};
+
+// Runs blocking work (database round trips) off the GTK thread and delivers
+// the result back on it. Starting a new run, cancel() or destroying the task
+// drops any result still pending; blocked workers are abandoned rather than
+// joined, so the UI never waits on a slow network call.
+class BackgroundTask {
+public:
+    BackgroundTask();
+    ~BackgroundTask();
+
+    BackgroundTask(const BackgroundTask&) = delete;
+    BackgroundTask& operator=(const BackgroundTask&) = delete;
+
+    // work(const TaskContext&) runs on a worker thread. on_done(result) or
+    // on_error(message) then runs on the GTK thread.
+    template <typename Work, typename Done>
+    void run(Work work, Done on_done,
+             std::function<void(const std::string&)> on_error = nullptr);
+
+    void cancel();
+
+private:
+    std::shared_ptr<detail::TaskShared> m_shared;
+    std::shared_ptr<std::atomic<bool>> m_cancel;
+    Glib::Dispatcher m_dispatcher;
+
+    void on_dispatch();
+};
+
+template <typename Work, typename Done>
+void BackgroundTask::run(Work work, Done on_done,
+                         std::function<void(const std::string&)> on_error)
+{
+    cancel();
+    m_cancel = std::make_shared<std::atomic<bool>>(false);
+    TaskContext ctx(m_shared, m_cancel);
+
+    std::thread([ctx, work = std::move(work), on_done = std::move(on_done),
+                 on_error = std::move(on_error)]() mutable {
+        using Result = std::invoke_result_t<Work&, const TaskContext&>;
+        try {
+            if constexpr (std::is_void_v<Result>) {
+                work(ctx);
+                ctx.post([on_done]() mutable { on_done(); });
+            } else {
+                auto result = std::make_shared<Result>(work(ctx));
+                ctx.post([on_done, result]() mutable { on_done(std::move(*result)); });
+            }
+        }
+        catch (const std::exception& e) {
+            std::string message = e.what();
+            if (on_error)
+                ctx.post([on_error, message]() { on_error(message); });
+        }
+    }).detach();
+}
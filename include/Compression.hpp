@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+// Compression formats, chosen by file extension: .gz and .zst. zstd is
+// available when the build found libzstd (CONTACTS_HAVE_ZSTD).
+enum class Codec { none, gzip, zstd };
+
+Codec codec_for_path(const std::string& path);
+bool codec_available(Codec codec);
+const char* codec_name(Codec codec);
+
+class CodecError : public std::runtime_error {
+public:
+    explicit CodecError(const std::string& msg) : std::runtime_error(msg) {}
+};
+
+// Compress one block into a self-contained gzip member or zstd frame.
+// Members and frames concatenate into a valid stream, which is what lets
+// blocks be compressed on separate threads. level 0 = codec default.
+std::string compress_block(Codec codec, const char* data, std::size_t size, int level = 0);
+
+// A forward-only stream of bytes, decompressed on the fly if need be
+class ByteSource {
+public:
+    virtual ~ByteSource() = default;
+
+    // Up to `capacity` bytes into buffer; 0 at end of stream. Throws
+    // std::system_error on I/O errors and CodecError on corrupt input.
+    virtual std::size_t read(char* buffer, std::size_t capacity) = 0;
+};
+
+// Opens path, decompressing according to its extension. Multi-member gzip
+// and multi-frame zstd files (as written by compress_block) are read whole.
+std::unique_ptr<ByteSource> open_byte_source(const std::string& path);
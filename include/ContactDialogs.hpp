@@ -1,22 +1,32 @@
 #pragma once
 #include <gtkmm.h>
 #include <functional>
-#include "DB.hpp"
+#include <memory>
+#include <optional>
+#include "ContactStore.hpp"
+#include "BackgroundTask.hpp"
 
 class ContactDialog : public Gtk::Dialog
 {
 public:
     ContactDialog(Gtk::Window& parent,
-                  DB& db,
-                  std::function<void()> on_saved = nullptr,
-                  bool editing = false,
-                  int contact_id = 0);
+                  std::shared_ptr<ContactStore> db,
+                  std::function<void(const Contact&)> on_saved = nullptr,
+                  std::optional<Contact> existing = std::nullopt,
+                  bool check_freshness = true);
 
 private:
-    DB& m_db;
-    std::function<void()> m_on_saved;
+    std::shared_ptr<ContactStore> m_db;
+    std::function<void(const Contact&)> m_on_saved;
     bool m_editing;
-    int m_contact_id;
+    ContactId m_contact_id = 0;
+    std::string m_updated_at;
+
+    // Edits are seeded from the caller's cached row; this task checks in the
+    // background whether the row changed on the server since it was loaded.
+    BackgroundTask m_freshness_check;
+    bool m_loading = false;
+    bool m_user_edited = false;
 
     Gtk::Box m_main_box{Gtk::Orientation::VERTICAL};
     Gtk::Grid grid;
@@ -34,7 +44,9 @@ private:
 
     void on_ok_clicked();
     void on_cancel_clicked();
-    void load_contact_data();
+    void load_contact_data(const Contact& contact);
+    void start_freshness_check();
+    void on_entry_changed();
     bool validate_input();
     void show_validation_error(const std::string& message);
     void clear_validation_error();
@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+#include "ContactFormat.hpp"
+#include "ContactStore.hpp"
+#include "FileWriter.hpp"
+
+struct ExportOptions {
+    std::size_t fetch_size = 4096;       // rows per server round trip
+    FileWriterOptions file;              // output buffer size, O_DIRECT, compression
+    ContactFormat format = ContactFormat::csv;
+    bool header = true;                  // CSV column names
+    unsigned int partitions = 4;         // upper bound on parallel connections
+    std::size_t min_partition_rows = 250000; // smaller tables export serially
+    bool consistent_snapshot = true;     // all partitions read the same state
+    bool part_files = false;             // keep one file per partition, unstitched
+    std::optional<ContactQuery> view;    // export only this search, in this order
+    bool id_order_ok = false;            // an unsearched view may come out in id order
+};
+
+struct ExportProgress {
+    std::size_t rows_written = 0;
+    std::size_t total_rows = 0;          // row count when the export started; 0 if unknown
+    std::uint64_t bytes_written = 0;
+    std::vector<std::string> files;      // what was written
+    bool id_order = false;               // partitioned, so in id order whatever the view's
+};
+
+// Streaming export to CSV or vCard.
+//
+// Rows are read from the server a fetch window at a time over a dedicated
+// connection and encoded straight into the output buffer, so memory use is
+// the same for ten rows or ten million. A cancelled or failed export
+// removes the partial output.
+//
+// With a view only its rows are exported, filtered and ordered by the
+// server. A full export in id order (no view, a view sorted by id, or an
+// unsearched view with id_order_ok) instead splits large tables into id
+// ranges, each read and formatted by its own thread and connection into a
+// part file. The parts are then concatenated in id order inside the kernel,
+// or kept as they are with part_files; compressed parts are whole gzip
+// members or zstd frames, so they concatenate just as well. For a coherent
+// result the partitions open their snapshots while the table is briefly
+// locked against writes.
+class ContactExporter {
+public:
+    using ProgressFn = std::function<void(const ExportProgress&)>;
+    using CancelFn = std::function<bool()>;
+
+    ContactExporter(const ContactStore& db, ExportOptions options = {});
+
+    // Throws DBException or std::system_error. On cancel the output is
+    // removed and the rows written so far are reported.
+    ExportProgress run(const std::string& path,
+                       const ProgressFn& on_progress = nullptr,
+                       const CancelFn& cancelled = nullptr);
+
+    // "dir/contacts.csv", 2 -> "dir/contacts.part002.csv"
+    static std::string part_path(const std::string& path, unsigned int index);
+
+private:
+    const ContactStore& m_db;
+    ExportOptions m_options;
+
+    ExportProgress run_serial(ContactStore& conn, const std::string& path, ExportProgress progress,
+                              const ProgressFn& on_progress, const CancelFn& cancelled);
+    ExportProgress run_partitioned(ContactStore& coordinator, const std::string& path,
+                                   const IdRange& bounds, unsigned int partitions,
+                                   ExportProgress progress,
+                                   const ProgressFn& on_progress, const CancelFn& cancelled);
+};
@@ -0,0 +1,236 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include "ContactStore.hpp"
+
+// The columns of the contacts table, declared once in kContactFields. SQL
+// column lists and statements, prepared-statement binding, row decoding,
+// the list view's columns, the CSV layout, the JSON Lines keys, the log
+// store's records and the snapshot's rows are generated from it at
+// compile time.
+//
+// Adding a column also takes, by hand:
+//   - the Contact member and the migration that creates it
+//   - the members of PmrContact (ContactStore.hpp), ContactTable::Field and
+//     ContactTable::Row, and LogStore's RowView, with their constructors
+//     and append/assign overloads
+//   - the vCard property it maps to, if any (VCard.cpp)
+//   - a new LogStore record and snapshot format version, as the old files
+//     hold one field less
+// The static_asserts beside those types catch a count that is out of step.
+namespace contact_fields {
+
+// What a column takes part in
+enum Flags : unsigned {
+    editable = 1u << 0,   // written by INSERT and UPDATE; shown, imported and exported
+    searchable = 1u << 1, // matched by the search box's LIKE
+    sortable = 1u << 2,   // accepted as an ORDER BY column
+    key = 1u << 3,        // the row's integer id; every other field is text
+};
+
+// name is the SQL column, title its heading in the list and in CSV files.
+// get returns the member on a Contact, or on any row type with the same
+// member names (PmrContact, ContactTable::Row).
+template <unsigned FieldFlags, typename Get>
+struct Field {
+    static constexpr unsigned flags = FieldFlags;
+    const char* name;
+    const char* title;
+    Get get;
+};
+
+template <unsigned FieldFlags, typename Get>
+constexpr Field<FieldFlags, Get> field(const char* name, const char* title, Get get)
+{
+    return {name, title, get};
+}
+
+// In SELECT order; Contact's members follow the same order
+inline constexpr auto kContactFields = std::make_tuple(
+    field<key | sortable>("id", "ID", [](auto& c) -> auto& { return c.id; }),
+    field<editable | searchable | sortable>("first_name", "First Name", [](auto& c) -> auto& { return c.first_name; }),
+    field<editable | searchable | sortable>("last_name", "Last Name", [](auto& c) -> auto& { return c.last_name; }),
+    field<editable | searchable | sortable>("email", "Email", [](auto& c) -> auto& { return c.email; }),
+    field<editable | searchable | sortable>("mobile", "Mobile", [](auto& c) -> auto& { return c.mobile; }),
+    field<0>("updated_at", "Updated", [](auto& c) -> auto& { return c.updated_at; }));
+
+// Calls fn(field) for each field having every flag in Mask, in order
+template <unsigned Mask = 0, typename Fn>
+constexpr void for_each(Fn&& fn)
+{
+    std::apply([&fn](const auto&... fields) {
+        auto visit = [&fn](const auto& f) {
+            if constexpr ((std::decay_t<decltype(f)>::flags & Mask) == Mask)
+                fn(f);
+        };
+        (visit(fields), ...);
+    }, kContactFields);
+}
+
+// Calls fn(field) for each text field, every one but id, in order
+template <typename Fn>
+constexpr void for_each_text(Fn&& fn)
+{
+    for_each([&fn](const auto& f) {
+        if constexpr ((std::decay_t<decltype(f)>::flags & key) == 0)
+            fn(f);
+    });
+}
+
+template <unsigned Mask = 0>
+constexpr std::size_t count()
+{
+    std::size_t n = 0;
+    for_each<Mask>([&n](const auto&) { ++n; });
+    return n;
+}
+
+constexpr std::size_t count_text()
+{
+    std::size_t n = 0;
+    for_each_text([&n](const auto&) { ++n; });
+    return n;
+}
+
+static_assert(sizeof(Contact) == sizeof(ContactId) + count_text() * sizeof(std::string),
+              "Contact out of step with kContactFields");
+static_assert(sizeof(PmrContact) == sizeof(ContactId) + count_text() * sizeof(std::pmr::string),
+              "PmrContact out of step with kContactFields");
+
+constexpr bool same_name(const char* a, std::string_view b)
+{
+    std::size_t i = 0;
+    for (; a[i] != '\0'; ++i) {
+        if (i == b.size() || a[i] != b[i])
+            return false;
+    }
+    return i == b.size();
+}
+
+// -----------------------------
+// Compile-time SQL text
+// -----------------------------
+
+// Generators write their text through a TextWriter twice: once without a
+// buffer to measure it, then into a buffer of exactly that size
+class TextWriter {
+public:
+    constexpr explicit TextWriter(char* out = nullptr) : m_out(out) {}
+
+    constexpr TextWriter& operator<<(const char* text)
+    {
+        for (; *text != '\0'; ++text, ++m_size) {
+            if (m_out)
+                m_out[m_size] = *text;
+        }
+        return *this;
+    }
+
+    constexpr std::size_t size() const { return m_size; }
+
+private:
+    char* m_out;
+    std::size_t m_size = 0;
+};
+
+template <std::size_t N>
+struct Text {
+    char chars[N + 1] = {};
+    constexpr const char* c_str() const { return chars; }
+};
+
+template <typename Gen>
+constexpr std::size_t text_size(const Gen& gen)
+{
+    TextWriter out;
+    gen(out);
+    return out.size();
+}
+
+template <std::size_t N, typename Gen>
+constexpr Text<N> render(const Gen& gen)
+{
+    Text<N> text{};
+    TextWriter out(text.chars);
+    gen(out);
+    return text;
+}
+
+// The text a generator writes, as a constant: sql_text<gen>.c_str()
+template <const auto& Gen>
+inline constexpr auto sql_text = render<text_size(Gen)>(Gen);
+
+// Writes before + name + after for each field having every flag in Mask,
+// separated by sep: list<editable>(out, "", "=?", ", ") -> "first_name=?, ..."
+template <unsigned Mask = 0>
+constexpr void list(TextWriter& out, const char* before, const char* after, const char* sep)
+{
+    bool first = true;
+    for_each<Mask>([&](const auto& f) {
+        if (!first)
+            out << sep;
+        first = false;
+        out << before << f.name << after;
+    });
+}
+
+// "?" once for each field having every flag in Mask, separated by sep
+template <unsigned Mask = 0>
+constexpr void placeholders(TextWriter& out, const char* sep)
+{
+    bool first = true;
+    for_each<Mask>([&](const auto&) {
+        if (!first)
+            out << sep;
+        first = false;
+        out << "?";
+    });
+}
+
+// "SELECT <every column> FROM contacts" then Tail
+template <const char* Tail>
+inline constexpr auto select_contacts = [](TextWriter& out) {
+    out << "SELECT ";
+    list(out, "", "", ", ");
+    out << " FROM contacts" << Tail;
+};
+
+// -----------------------------
+// Binding and decoding
+// -----------------------------
+template <typename Stmt>
+void bind(Stmt& stmt, int index, const std::string& value) { stmt.setString(index, value); }
+template <typename Stmt>
+void bind(Stmt& stmt, int index, ContactId value) { stmt.setUInt64(index, value); }
+
+// Binds row's editable fields to placeholders first, first + 1, ...;
+// returns the next placeholder
+template <typename Stmt, typename Row>
+int bind_editable(Stmt& stmt, const Row& row, int first = 1)
+{
+    int index = first;
+    for_each<editable>([&](const auto& f) { bind(stmt, index++, f.get(row)); });
+    return index;
+}
+
+template <typename ResultSet, typename String>
+void read(ResultSet& res, int index, String& out)
+{
+    auto value = res.getString(index);
+    out.assign(value.c_str(), value.length());
+}
+template <typename ResultSet>
+void read(ResultSet& res, int index, ContactId& out) { out = res.getUInt64(index); }
+
+// Decodes a row selected with every column, by position, into a Contact
+// or PmrContact; assigning into the existing strings reuses their capacity
+template <typename ResultSet, typename Row>
+void decode(ResultSet& res, Row& row)
+{
+    int index = 1;
+    for_each([&](const auto& f) { read(res, index++, f.get(row)); });
+}
+
+} // namespace contact_fields
@@ -0,0 +1,29 @@
+#pragma once
+#include <memory>
+#include <string>
+#include "ContactSource.hpp"
+#include "FileWriter.hpp"
+
+// File formats for import and export, chosen by extension after any
+// compression suffix: contacts.vcf.gz is a gzip-compressed vCard file.
+enum class ContactFormat { csv, vcard, jsonl };
+
+ContactFormat format_for_path(const std::string& path);
+// "CSV", "vCard" or "JSON Lines", for messages
+const char* format_name(ContactFormat format);
+
+// Serialises contacts into a FileWriter in one format
+class ContactWriter {
+public:
+    virtual ~ContactWriter() = default;
+
+    // Whatever precedes the first contact (a CSV header row)
+    virtual void begin() {}
+    virtual void write(const Contact& contact) = 0;
+};
+
+std::unique_ptr<ContactWriter> make_contact_writer(ContactFormat format, FileWriter& out);
+
+// Streaming, decompressing reader for any supported file. (Uncompressed CSV
+// and JSON Lines are faster read from a MappedFile.)
+std::unique_ptr<ContactSource> open_contact_source(const std::string& path);
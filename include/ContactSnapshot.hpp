@@ -0,0 +1,80 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ContactStore.hpp"
+#include "ContactTable.hpp"
+#include "MappedFile.hpp"
+
+// What changed in a store since a snapshot of it was written
+struct SnapshotDelta {
+    std::vector<Contact> changed;   // added or updated since, in no particular order
+    std::vector<ContactId> removed; // in the snapshot but gone from the store
+};
+
+// A read-only copy of the contact list kept in the user's cache directory,
+// so the next start can show rows before the server has answered. It is
+// written after each full load from the server and mapped, not parsed, on
+// open; the caller then catches it up with diff().
+//
+// Layout, in native byte order since the file never leaves the machine:
+//   header  magic, format version, row count, heap size, newest updated_at
+//   source  the store the rows came from, padded to 8 bytes
+//   rows    fixed-width records: heap offset, 64-bit id, five field lengths
+//   heap    the fields' bytes back to back, in row order
+class ContactSnapshot {
+public:
+    // Maps the snapshot kept for source. Returns nullptr if there is none,
+    // or it is from an older format, another source, or damaged.
+    static std::shared_ptr<const ContactSnapshot> open(const std::string& source);
+
+    // Replaces the snapshot for source with rows, in the order given.
+    // The file is swapped in by rename, so open mappings stay valid and a
+    // crash leaves the old snapshot. Throws std::system_error.
+    static void write(const std::string& source, const ContactTable& rows);
+    static void write(const std::string& source, const std::vector<Contact>& rows);
+
+    // Where source's snapshot lives: $XDG_CACHE_HOME/contacts-app, falling
+    // back to ~/.cache/contacts-app
+    static std::string path_for(const std::string& source);
+
+    std::size_t size() const { return m_count; }
+
+    // Appends rows [first, first + count), clamped to the end, to out
+    void contacts(std::size_t first, std::size_t count, ContactTable& out) const;
+
+    // Bound for ContactStore::get_contacts_updated_since; empty if the
+    // snapshot has no rows
+    const std::string& newest_updated_at() const { return m_newest_updated_at; }
+
+    // Compare against the store: updated_since is what the store returned
+    // for newest_updated_at(), live_ids every id it holds (ascending)
+    SnapshotDelta diff(std::vector<Contact> updated_since, const std::vector<ContactId>& live_ids) const;
+    // Live ids in neither the snapshot nor updated_since: rows committed
+    // with an updated_at older than newest_updated_at(), say by a long
+    // transaction. Fetch them and add them to updated_since before diff().
+    std::vector<ContactId> missing(const std::vector<Contact>& updated_since,
+                                   const std::vector<ContactId>& live_ids) const;
+
+    // The snapshot's rows with delta applied, ordered by last name like the
+    // rows it was written from, ready to write() back
+    std::vector<Contact> apply(const SnapshotDelta& delta) const;
+
+private:
+    struct Row;
+
+    ContactSnapshot(MappedFile file, std::size_t count, const Row* rows, const char* heap,
+                    std::string newest_updated_at);
+
+    Contact contact(std::size_t index) const;
+    // (id, row index) for every row, sorted by id
+    std::vector<std::pair<ContactId, std::size_t>> ids() const;
+
+    MappedFile m_file;
+    std::size_t m_count;
+    const Row* m_rows;
+    const char* m_heap;
+    std::string m_newest_updated_at;
+};
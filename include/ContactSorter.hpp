@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <locale>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Client-side sort engine for a locally cached contact list.
+//
+// Locale-aware collation keys (std::collate::transform) are computed once per
+// row and packed into a single buffer, so each comparison during the sort is
+// a plain byte compare. The sort itself runs over an index permutation on
+// several threads; rows are never moved, the view applies the permutation.
+class ContactSorter {
+public:
+    using ValueFn = std::function<std::string_view(std::size_t row)>;
+    using TieFn = std::function<bool(std::size_t a, std::size_t b)>;
+
+    // Uses the user's locale (LANG/LC_COLLATE), falling back to "C"
+    ContactSorter();
+    explicit ContactSorter(const std::locale& locale);
+
+    // Rebuild the key array for `count` rows; value_of(i) returns row i's text
+    void build_keys(std::size_t count, const ValueFn& value_of);
+
+    // Returns the permutation perm[new_position] = row index. Rows with
+    // equal keys are ordered by tie_less(a, b), which must be a strict weak
+    // order; without it they keep their original row order, so the result
+    // is a stable sort.
+    std::vector<std::size_t> sort(bool ascending, const TieFn& tie_less = nullptr) const;
+
+    // Locale-aware three-way compare, consistent with the generated keys
+    int compare(std::string_view a, std::string_view b) const;
+
+    std::size_t size() const { return m_offsets.empty() ? 0 : m_offsets.size() - 1; }
+    void clear();
+
+private:
+    std::locale m_locale;
+    const std::collate<char>* m_collate;
+
+    // Keys for row i live in m_heap[m_offsets[i], m_offsets[i + 1])
+    std::string m_heap;
+    std::vector<std::size_t> m_offsets;
+
+    std::string_view key(std::size_t row) const;
+    static unsigned int worker_count(std::size_t items);
+};
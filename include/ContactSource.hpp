@@ -0,0 +1,99 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+#include "Compression.hpp"
+#include "CsvParser.hpp"
+#include "ContactStore.hpp"
+#include "MappedFile.hpp"
+
+// A forward-only stream of contacts to import. Implementations decode one
+// row at a time so an import never needs the whole file in memory.
+class ContactSource {
+public:
+    virtual ~ContactSource() = default;
+
+    // Fills `contact` with the next importable row; false at end of input
+    virtual bool next(Contact& contact) = 0;
+
+    // Rows skipped so far because they failed validation
+    virtual std::size_t rejected() const { return 0; }
+
+    // Byte offsets for resumable imports: where the row last returned by
+    // next() starts, and where the following one will start. Sources that
+    // cannot seek keep the defaults and can only be imported from the top.
+    virtual std::uint64_t record_offset() const { return 0; }
+    virtual std::uint64_t position() const { return 0; }
+    virtual bool seek(std::uint64_t offset) { return offset == 0; }
+};
+
+// Map one CSV record (First Name, Last Name, Email, Mobile) to a Contact
+Contact contact_from_csv(const std::vector<CsvField>& fields);
+
+// Rows the importer accepts: a name, and a well-formed email if one is given
+bool is_importable(const Contact& contact);
+
+// Streams contacts out of a memory-mapped CSV file. Pages that have been
+// parsed are handed back to the kernel, so resident memory stays flat no
+// matter how large the file is.
+class CsvContactSource : public ContactSource {
+public:
+    explicit CsvContactSource(MappedFile& file, bool skip_header = true);
+
+    bool next(Contact& contact) override;
+    std::size_t rejected() const override { return m_rejected; }
+
+    std::uint64_t record_offset() const override { return m_record_offset; }
+    std::uint64_t position() const override { return m_reader.offset(); }
+    bool seek(std::uint64_t offset) override;
+
+    // Byte offset of the first record not yet returned
+    std::size_t offset() const { return m_reader.offset(); }
+
+private:
+    MappedFile& m_file;
+    CsvReader m_reader;
+    std::vector<CsvField> m_fields;
+    bool m_skip_header;
+    std::size_t m_rejected = 0;
+    std::size_t m_released = 0;
+    std::size_t m_record_offset = 0;
+};
+
+// Streams contacts out of any ByteSource, typically a decompressor. Input
+// is read into a window that is parsed up to its last complete record;
+// the unfinished tail moves to the front and the window is refilled, so
+// memory stays at about one window however large the input is.
+//
+// Offsets count bytes of the decoded stream. seek() only works before the
+// first row is read, and reaches the offset by decoding and discarding.
+class StreamingCsvContactSource : public ContactSource {
+public:
+    explicit StreamingCsvContactSource(std::unique_ptr<ByteSource> input,
+                                       bool skip_header = true,
+                                       std::size_t window_bytes = 4u << 20);
+
+    bool next(Contact& contact) override;
+    std::size_t rejected() const override { return m_rejected; }
+
+    std::uint64_t record_offset() const override { return m_record_offset; }
+    std::uint64_t position() const override;
+    bool seek(std::uint64_t offset) override;
+
+private:
+    std::unique_ptr<ByteSource> m_input;
+    std::vector<char> m_window;
+    std::size_t m_parsed = 0;            // window bytes handed to m_reader
+    std::size_t m_filled = 0;            // window bytes read from m_input
+    std::uint64_t m_base = 0;            // stream offset of m_window[0]
+    bool m_eof = false;
+    std::optional<CsvReader> m_reader;   // over m_window[0, m_parsed)
+    std::vector<CsvField> m_fields;
+    bool m_skip_header;
+    std::size_t m_rejected = 0;
+    std::uint64_t m_record_offset = 0;
+
+    bool refill();
+};
@@ -0,0 +1,251 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include "ImportJournal.hpp"
+
+// A contact's id: BIGINT UNSIGNED AUTO_INCREMENT in MariaDB, so deletes and
+// re-imports cannot run it out. Stores never hand out 0.
+using ContactId = std::uint64_t;
+
+struct Contact {
+    ContactId id;
+    std::string first_name;
+    std::string last_name;
+    std::string email;
+    std::string mobile;
+    std::string updated_at{}; // as returned by the store; empty if unknown
+
+    // Validation helper
+    bool is_valid() const {
+        return !first_name.empty() || !last_name.empty();
+    }
+};
+
+// A Contact whose strings live in a caller's memory_resource, for
+// short-lived query results: built in a monotonic buffer, a whole result
+// costs a few large allocations instead of several per row. It is
+// allocator-aware, so a std::pmr::vector hands its resource to each element.
+struct PmrContact {
+    using allocator_type = std::pmr::polymorphic_allocator<char>;
+
+    ContactId id = 0;
+    std::pmr::string first_name;
+    std::pmr::string last_name;
+    std::pmr::string email;
+    std::pmr::string mobile;
+    std::pmr::string updated_at;
+
+    explicit PmrContact(allocator_type alloc = {})
+    : first_name(alloc), last_name(alloc), email(alloc), mobile(alloc), updated_at(alloc) {}
+    PmrContact(const PmrContact& other, allocator_type alloc = {})
+    : id(other.id),
+      first_name(other.first_name, alloc),
+      last_name(other.last_name, alloc),
+      email(other.email, alloc),
+      mobile(other.mobile, alloc),
+      updated_at(other.updated_at, alloc) {}
+    PmrContact(PmrContact&& other, allocator_type alloc)
+    : id(other.id),
+      first_name(std::move(other.first_name), alloc),
+      last_name(std::move(other.last_name), alloc),
+      email(std::move(other.email), alloc),
+      mobile(std::move(other.mobile), alloc),
+      updated_at(std::move(other.updated_at), alloc) {}
+    PmrContact(PmrContact&&) noexcept = default;
+    PmrContact& operator=(const PmrContact&) = default;
+    PmrContact& operator=(PmrContact&&) = default;
+
+    allocator_type get_allocator() const { return first_name.get_allocator(); }
+
+    // Copy a Contact, or any row with the same member names, into this
+    // contact's resource
+    template <typename Row>
+    void assign(const Row& row)
+    {
+        id = row.id;
+        first_name.assign(row.first_name.data(), row.first_name.size());
+        last_name.assign(row.last_name.data(), row.last_name.size());
+        email.assign(row.email.data(), row.email.size());
+        mobile.assign(row.mobile.data(), row.mobile.size());
+        updated_at.assign(row.updated_at.data(), row.updated_at.size());
+    }
+
+    Contact to_contact() const
+    {
+        return Contact{id, std::string(first_name), std::string(last_name), std::string(email),
+                       std::string(mobile), std::string(updated_at)};
+    }
+};
+
+// Inclusive id interval; the default covers every id
+struct IdRange {
+    ContactId first = 0;
+    ContactId last = std::numeric_limits<ContactId>::max();
+};
+
+// A list view pushed down to the store: the search box's substring match
+// and the column sort, with the list's tie-breaks
+struct ContactQuery {
+    std::string search;                  // empty = every row
+    std::string sort_column = "last_name";
+    bool ascending = true;
+};
+
+// Limits for ContactStore::import_stream. A batch is committed when either
+// is reached, so memory use depends on these and not on the size of the input.
+struct StreamImportOptions {
+    std::size_t batch_rows = 5000;
+    std::size_t max_batch_bytes = 16u << 20;
+};
+
+class ContactSource;
+class ContactTable;
+
+class DBException : public std::runtime_error {
+public:
+    explicit DBException(const std::string& msg) : std::runtime_error(msg) {}
+};
+
+// Where contacts live. The UI, the dialogs and import/export only talk to
+// this interface; DB is the MariaDB backend and InMemoryStore keeps
+// everything in process, for benchmarks and offline use.
+//
+// Every handle is safe to share between threads, but long streams occupy
+// it, so workers take their own clone(). Failures surface as DBException,
+// except for reads, which log and return an empty result.
+class ContactStore {
+public:
+    virtual ~ContactStore() = default;
+
+    // An independent handle on the same data (for workers)
+    virtual std::unique_ptr<ContactStore> clone() const = 0;
+
+    virtual bool test_connection() = 0;
+    // Bring the storage up to date; cheap when it already is
+    virtual void initialize_schema() = 0;
+
+    // CRUD operations (insert/update return the row as stored)
+    virtual Contact insert_contact(const std::string& first,
+                                   const std::string& last,
+                                   const std::string& email,
+                                   const std::string& mobile) = 0;
+
+    virtual Contact update_contact(ContactId id,
+                                   const std::string& first,
+                                   const std::string& last,
+                                   const std::string& email,
+                                   const std::string& mobile) = 0;
+
+    virtual void delete_contact(ContactId id) = 0;
+
+    virtual std::optional<Contact> get_contact_by_id(ContactId id) = 0;
+    // Returns the current row only if its updated_at differs from the given one
+    virtual std::optional<Contact> get_contact_if_changed(ContactId id, const std::string& known_updated_at) = 0;
+    virtual std::vector<Contact> get_all_contacts() const = 0;
+    // Rows in list order (last name, first name); limit 0 means "to the end"
+    virtual std::vector<Contact> get_contacts_page(std::size_t offset, std::size_t limit) const = 0;
+    // As above, appending the rows to out: no allocations per row
+    virtual void get_contacts_page(std::size_t offset, std::size_t limit, ContactTable& out) const = 0;
+    // As above, built in mr; the rows are valid as long as mr is
+    virtual std::pmr::vector<PmrContact> get_contacts_page(std::size_t offset,
+                                                           std::size_t limit,
+                                                           std::pmr::memory_resource* mr) const = 0;
+    // Rows that follow after in list order, appended to out; limit 0 means
+    // "to the end". Only after's last name, first name and id are read. An
+    // offset skips or repeats rows when others are written between pages;
+    // reading on from the last row shown does not.
+    virtual void get_contacts_page_after(const Contact& after, std::size_t limit, ContactTable& out) const = 0;
+    // Visit every row in id order without holding the result in memory.
+    // visit returns false to stop. Throws DBException.
+    std::size_t stream_contacts(const std::function<bool(const Contact&)>& visit,
+                                std::size_t fetch_size = 4096) const;
+    // As above, for rows whose id lies in ids
+    virtual std::size_t stream_contacts(const IdRange& ids,
+                                        const std::function<bool(const Contact&)>& visit,
+                                        std::size_t fetch_size = 4096) const = 0;
+    // As above, for the rows of a list view in that view's order
+    virtual std::size_t stream_contacts(const ContactQuery& query,
+                                        const std::function<bool(const Contact&)>& visit,
+                                        std::size_t fetch_size = 4096) const = 0;
+    // Smallest and largest id, or nullopt for an empty table
+    virtual std::optional<IdRange> get_id_bounds() const = 0;
+    // Rows whose updated_at is at or after since, a value this store
+    // returned; with get_contact_ids() enough to catch a cached copy up.
+    // Inclusive, as rows written before updated_at had microseconds may
+    // share a second.
+    virtual std::vector<Contact> get_contacts_updated_since(const std::string& since) const = 0;
+    // Every id in the table, ascending
+    virtual std::vector<ContactId> get_contact_ids() const = 0;
+    // The rows with these ids, ascending by id; ids not in the table are
+    // skipped
+    virtual std::vector<Contact> get_contacts_by_ids(const std::vector<ContactId>& ids) const = 0;
+
+    // Consistent snapshots across handles: while one handle holds
+    // lock_contacts_for_read() no write can commit, so every handle that
+    // calls begin_snapshot() meanwhile reads the same state until end_snapshot()
+    virtual bool lock_contacts_for_read() = 0;
+    virtual void unlock_tables() = 0;
+    virtual void begin_snapshot() = 0;
+    virtual void end_snapshot() = 0;
+
+    // Search and filter
+    virtual std::vector<Contact> search_contacts(const std::string& query) const = 0;
+    // As above, built in mr; the rows are valid as long as mr is
+    virtual std::pmr::vector<PmrContact> search_contacts(const std::string& query,
+                                                         std::pmr::memory_resource* mr) const = 0;
+    virtual std::vector<Contact> get_contacts_sorted(const std::string& column, bool ascending = true) const = 0;
+    // Contacts whose email is at exactly domain ("example.com", or
+    // "@example.com"), ignoring case, in list order. The search box's
+    // "@example.com" facet matches the same rows.
+    virtual std::vector<Contact> get_contacts_by_domain(const std::string& domain) const = 0;
+
+    // Statistics
+    virtual int get_contact_count() const = 0;
+
+    // Bulk operations
+    virtual void delete_all_contacts() = 0;
+    bool import_contacts(const std::vector<Contact>& contacts);
+    // Insert all rows in one transaction; throws DBException and rolls back on failure
+    virtual void insert_batch(const std::vector<Contact>& contacts) = 0;
+    // As above, recording `range` of import job `job_key` in the same
+    // transaction. Returns false, writing nothing, if that batch was already
+    // committed by an earlier or concurrent run.
+    virtual bool insert_batch(const std::vector<Contact>& contacts,
+                              const std::string& job_key,
+                              const ImportBatchRange& range,
+                              std::uint64_t batch_no) = 0;
+    // Import rows from source in committed batches. on_batch(total_so_far) runs
+    // after each commit; returning false stops the import. Returns rows imported.
+    // With a job_key every batch is journaled, and an interrupted import of the
+    // same job resumes where the committed batches end.
+    std::size_t import_stream(ContactSource& source,
+                              const StreamImportOptions& options = {},
+                              const std::function<bool(std::size_t)>& on_batch = nullptr,
+                              const std::string& job_key = {});
+    // Committed batches of an unfinished import job
+    virtual ImportJournal load_import_journal(const std::string& job_key) const = 0;
+    // Forget a job's journal once its import has completed
+    virtual void finish_import_job(const std::string& job_key) = 0;
+
+    // Upkeep a store may owe rows written by older versions: fills in or
+    // re-keys the search keys of up to batch_rows such rows with ids above cursor and
+    // advances cursor past them. Start a pass with cursor 0 and repeat
+    // until it returns 0. Stores that match in process have none to do.
+    // Throws DBException.
+    virtual std::size_t backfill_search_keys(ContactId& /*cursor*/, std::size_t /*batch_rows*/ = 1000)
+    {
+        return 0;
+    }
+
+    // Email validation helper
+    static bool is_valid_email(const std::string& email);
+};
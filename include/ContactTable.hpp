@@ -0,0 +1,88 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ContactStore.hpp"
+
+// Contacts stored column by column: ids in one array, and for each text
+// field an array of offsets and one of lengths into a single character
+// arena that only ever grows at the end. A row costs no allocations of its
+// own, and a search or sort walks dense arrays instead of chasing five
+// heap pointers per Contact.
+//
+// Views handed out point into the arena, so they are valid until the next
+// append(), reserve() or clear(); rows are addressed by index, which stays
+// valid until clear().
+class ContactTable {
+public:
+    enum class Field { first_name, last_name, email, mobile, updated_at };
+    static constexpr std::size_t kFields = 5;
+
+    // One row as views, with the same member names as Contact, so the
+    // StoreSupport templates (matches_search, ContactLess) take it as is
+    struct Row {
+        ContactId id;
+        std::string_view first_name;
+        std::string_view last_name;
+        std::string_view email;
+        std::string_view mobile;
+        std::string_view updated_at;
+    };
+
+    ContactTable() = default;
+    explicit ContactTable(const std::vector<Contact>& contacts);
+
+    std::size_t size() const { return m_ids.size(); }
+    bool empty() const { return m_ids.empty(); }
+    // Bytes of field text held in the arena
+    std::size_t arena_bytes() const { return m_arena.size(); }
+
+    void reserve(std::size_t rows, std::size_t arena_bytes);
+    void clear();
+
+    void append(ContactId id,
+                std::string_view first,
+                std::string_view last,
+                std::string_view email,
+                std::string_view mobile,
+                std::string_view updated_at = {});
+    void append(const Contact& contact);
+    void append(const Row& row);
+
+    ContactId id(std::size_t row) const { return m_ids[row]; }
+    std::string_view field(std::size_t row, Field f) const
+    {
+        const Column& column = m_columns[static_cast<std::size_t>(f)];
+        return {m_arena.data() + column.offsets[row], column.lengths[row]};
+    }
+    std::string_view first_name(std::size_t row) const { return field(row, Field::first_name); }
+    std::string_view last_name(std::size_t row) const { return field(row, Field::last_name); }
+    std::string_view email(std::size_t row) const { return field(row, Field::email); }
+    std::string_view mobile(std::size_t row) const { return field(row, Field::mobile); }
+    std::string_view updated_at(std::size_t row) const { return field(row, Field::updated_at); }
+
+    Row row(std::size_t row) const;
+    // A copy that owns its strings
+    Contact contact(std::size_t row) const;
+    std::vector<Contact> contacts() const;
+
+    // Rows matching the search box's query, in table order
+    std::vector<std::size_t> search(const std::string& query) const;
+    // Row indexes in the order DB::order_by_clause gives for column
+    std::vector<std::size_t> sorted(const std::string& column, bool ascending = true) const;
+
+private:
+    struct Column {
+        std::vector<std::uint64_t> offsets;
+        std::vector<std::uint32_t> lengths;
+    };
+
+    std::vector<ContactId> m_ids;
+    std::array<Column, kFields> m_columns;
+    std::string m_arena;
+
+    void push_field(Field f, std::string_view value);
+};
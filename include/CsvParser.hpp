@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// One parsed CSV field. `raw` points into the parsed buffer and excludes the
+// surrounding quotes; quoted fields containing "" still need unescaping.
+struct CsvField {
+    std::string_view raw;
+    bool has_escapes = false;
+
+    // Field value with "" collapsed to ". Only allocates for the string itself.
+    std::string str() const;
+};
+
+// RFC 4180 reader over an in-memory buffer (typically a MappedFile).
+//
+// Handles quoted fields with embedded delimiters, quotes and line breaks,
+// CRLF/LF/CR line endings and a leading UTF-8 BOM. Quotes, delimiters and
+// line breaks are located 64 bytes at a time with SSE2/AVX2 compares
+// (chosen at run time, with a scalar fallback), so the parser only visits
+// the bytes that matter.
+class CsvReader {
+public:
+    explicit CsvReader(std::string_view data, char delimiter = ',');
+
+    // Reads the next record into `fields` (cleared first, capacity reused).
+    // Returns false once the input is exhausted.
+    bool next(std::vector<CsvField>& fields);
+
+    // Byte offset of the first record not yet returned
+    std::size_t offset() const { return m_pos; }
+
+    // Continue from a record boundary previously reported by offset()
+    void seek(std::size_t offset) { m_pos = offset < m_data.size() ? offset : m_data.size(); }
+
+    // Name of the scanning kernel in use ("avx2", "sse2" or "scalar")
+    static const char* simd_level();
+
+private:
+    using ScanFn = std::uint64_t (*)(const char* block, char delimiter);
+
+    std::string_view m_data;
+    char m_delimiter;
+    std::size_t m_pos = 0;
+
+    // Bitmask of special bytes in [m_block, m_block + 64)
+    std::size_t m_block = SIZE_MAX;
+    std::uint64_t m_mask = 0;
+    ScanFn m_scan;
+
+    std::size_t next_special(std::size_t from);
+    std::size_t next_quote(std::size_t from);
+    void load_block(std::size_t block);
+};
@@ -0,0 +1,55 @@
+#pragma once
+#include <string_view>
+#include "FileWriter.hpp"
+
+// RFC 4180 record writer: the counterpart of CsvReader. A field is quoted
+// only when it holds the delimiter, a quote or a line break, and embedded
+// quotes are doubled, so anything written here reads back unchanged.
+class CsvWriter {
+public:
+    explicit CsvWriter(FileWriter& out, char delimiter = ',')
+    : m_out(out),
+      m_delimiter(delimiter)
+    {
+    }
+
+    void field(std::string_view value)
+    {
+        if (m_fields++)
+            m_out.put(m_delimiter);
+
+        if (!needs_quotes(value)) {
+            m_out.write(value);
+            return;
+        }
+
+        m_out.put('"');
+        for (std::size_t quote; (quote = value.find('"')) != std::string_view::npos;) {
+            m_out.write(value.substr(0, quote + 1));
+            m_out.put('"');
+            value.remove_prefix(quote + 1);
+        }
+        m_out.write(value);
+        m_out.put('"');
+    }
+
+    void end_row()
+    {
+        m_out.put('\n');
+        m_fields = 0;
+    }
+
+private:
+    FileWriter& m_out;
+    char m_delimiter;
+    std::size_t m_fields = 0;
+
+    bool needs_quotes(std::string_view value) const
+    {
+        for (char c : value) {
+            if (c == m_delimiter || c == '"' || c == '\n' || c == '\r')
+                return true;
+        }
+        return false;
+    }
+};
@@ -1,79 +1,145 @@
 #pragma once
 
 #include <mariadb/conncpp.hpp>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <vector>
 #include <string>
-#include <stdexcept>
+#include "ContactStore.hpp"
 
-struct Contact {
-    int id;
-    std::string first_name;
-    std::string last_name;
-    std::string email;
-    std::string mobile;
-    
-    // Validation helper
-    bool is_valid() const {
-        return !first_name.empty() || !last_name.empty();
-    }
+// Connector timeouts; a connect to an unreachable host fails after connect_ms
+struct ConnectionTimeouts {
+    unsigned int connect_ms = 5000;
+    unsigned int read_ms = 30000;
 };
 
-class DBException : public std::runtime_error {
-public:
-    explicit DBException(const std::string& msg) : std::runtime_error(msg) {}
+struct ConnectionSettings {
+    std::string host;
+    unsigned int port = 3306;
+    std::string user;
+    std::string password;
+    std::string database = "Contacts";
+    ConnectionTimeouts timeouts;
 };
 
-class DB {
+// The MariaDB backend. Each DB owns one server connection.
+class DB : public ContactStore {
 public:
     // Constructor
     DB(const std::string& host,
        const std::string& user,
        const std::string& password,
        const std::string& db_name,
-       unsigned int port = 3306);
+       unsigned int port = 3306,
+       const ConnectionTimeouts& timeouts = {});
+
+    explicit DB(const ConnectionSettings& settings);
+
+    // Open an independent connection with the same settings (for workers)
+    std::unique_ptr<ContactStore> clone() const override;
 
     // Test connection
-    bool test_connection();
+    bool test_connection() override;
     
-    // Initialize database schema
-    void initialize_schema();
+    // Bring the schema up to date. Costs a single version read when it
+    // already is; otherwise applies the pending migrations in order.
+    void initialize_schema() override;
+    int schema_version() const;
+    static int latest_schema_version();
 
-    // CRUD operations
-    void insert_contact(const std::string& first,
-                        const std::string& last,
-                        const std::string& email,
-                        const std::string& mobile);
+    // EXPLAINs the list, page and default sort queries and returns one
+    // message for each that the server would not answer from idx_list
+    // alone, in index order: a filesort, another index, or a table scan.
+    // A domain lookup must be a range of idx_email_domain, and sorts by
+    // first name, email and mobile, either way, a walk of that column's
+    // index, likewise without a filesort. Empty when every plan is as
+    // intended. bench_query_plans runs it against a server. Throws
+    // DBException.
+    std::vector<std::string> check_query_plans() const;
 
-    void update_contact(int id,
-                        const std::string& first,
-                        const std::string& last,
-                        const std::string& email,
-                        const std::string& mobile);
+    // CRUD operations (insert/update return the row as stored)
+    Contact insert_contact(const std::string& first,
+                           const std::string& last,
+                           const std::string& email,
+                           const std::string& mobile) override;
 
-    void delete_contact(int id);
+    Contact update_contact(ContactId id,
+                           const std::string& first,
+                           const std::string& last,
+                           const std::string& email,
+                           const std::string& mobile) override;
 
-    std::optional<Contact> get_contact_by_id(int id);
-    std::vector<Contact> get_all_contacts() const;
+    void delete_contact(ContactId id) override;
+
+    std::optional<Contact> get_contact_by_id(ContactId id) override;
+    std::optional<Contact> get_contact_if_changed(ContactId id, const std::string& known_updated_at) override;
+    std::vector<Contact> get_all_contacts() const override;
+    std::vector<Contact> get_contacts_page(std::size_t offset, std::size_t limit) const override;
+    void get_contacts_page(std::size_t offset, std::size_t limit, ContactTable& out) const override;
+    std::pmr::vector<PmrContact> get_contacts_page(std::size_t offset,
+                                                   std::size_t limit,
+                                                   std::pmr::memory_resource* mr) const override;
+    void get_contacts_page_after(const Contact& after, std::size_t limit, ContactTable& out) const override;
+    // Streams occupy the connection until they return, so long exports
+    // should run on a clone()
+    using ContactStore::stream_contacts;
+    std::size_t stream_contacts(const IdRange& ids,
+                                const std::function<bool(const Contact&)>& visit,
+                                std::size_t fetch_size = 4096) const override;
+    std::size_t stream_contacts(const ContactQuery& query,
+                                const std::function<bool(const Contact&)>& visit,
+                                std::size_t fetch_size = 4096) const override;
+    std::optional<IdRange> get_id_bounds() const override;
+    std::vector<Contact> get_contacts_updated_since(const std::string& since) const override;
+    std::vector<ContactId> get_contact_ids() const override;
+    std::vector<Contact> get_contacts_by_ids(const std::vector<ContactId>& ids) const override;
+
+    // LOCK TABLES ... READ and START TRANSACTION WITH CONSISTENT SNAPSHOT
+    bool lock_contacts_for_read() override;
+    void unlock_tables() override;
+    void begin_snapshot() override;
+    void end_snapshot() override;
     
     // Search and filter
-    std::vector<Contact> search_contacts(const std::string& query) const;
-    std::vector<Contact> get_contacts_sorted(const std::string& column, bool ascending = true) const;
+    std::vector<Contact> search_contacts(const std::string& query) const override;
+    std::pmr::vector<PmrContact> search_contacts(const std::string& query,
+                                                 std::pmr::memory_resource* mr) const override;
+    std::vector<Contact> get_contacts_sorted(const std::string& column, bool ascending = true) const override;
+    // A range of idx_email_domain; the search box's facet runs the same query
+    std::vector<Contact> get_contacts_by_domain(const std::string& domain) const override;
     
     // Statistics
-    int get_contact_count() const;
+    int get_contact_count() const override;
     
     // Bulk operations
-    void delete_all_contacts();
-    bool import_contacts(const std::vector<Contact>& contacts);
-    
-    // Email validation helper
-    static bool is_valid_email(const std::string& email);
+    void delete_all_contacts() override;
+    void insert_batch(const std::vector<Contact>& contacts) override;
+    bool insert_batch(const std::vector<Contact>& contacts,
+                      const std::string& job_key,
+                      const ImportBatchRange& range,
+                      std::uint64_t batch_no) override;
+    ImportJournal load_import_journal(const std::string& job_key) const override;
+    void finish_import_job(const std::string& job_key) override;
+
+    // Keys rows that predate search_key, one transaction per batch. A pass
+    // that reaches the end is recorded, so later starts skip the scan.
+    std::size_t backfill_search_keys(ContactId& cursor, std::size_t batch_rows = 1000) override;
 
 private:
+    ConnectionSettings settings_;
     mutable std::shared_ptr<sql::Connection> conn_;
+    // Serialises use of conn_ so background tasks can share this connection
+    mutable std::recursive_mutex mutex_;
     
     void ensure_connection() const;
+    // Both expect the caller to hold mutex_ inside an open transaction
+    void insert_rows(const std::vector<Contact>& contacts);
+    void rollback_quietly();
+    // Logs check_query_plans() problems; unless any_size, only once the
+    // table is large enough for the optimizer to prefer the indexes
+    void log_query_plans(bool any_size) const;
     std::string sanitize_column_name(const std::string& column) const;
+    std::string order_by_clause(const std::string& column, bool ascending) const;
 };
@@ -1,15 +1,16 @@
 #pragma once
 #include <gtkmm.h>
 #include <functional>
+#include <optional>
 #include <string>
+#include "BackgroundTask.hpp"
+#include "DB.hpp"
 
 class DBConnectionDialog : public Gtk::Window
 {
 public:
-    DBConnectionDialog(std::function<void(const std::string& host,
-                                          unsigned int port,
-                                          const std::string& user,
-                                          const std::string& password)> on_connect);
+    DBConnectionDialog(std::function<void(const ConnectionSettings& settings)> on_connect);
+    ~DBConnectionDialog() override;
 
 private:
     Gtk::Box m_main_box{Gtk::Orientation::VERTICAL};
@@ -19,8 +20,12 @@ private:
     Gtk::Entry entry_user;
     Gtk::Entry entry_password;
     Gtk::Entry entry_database;
+    Gtk::SpinButton spin_connect_timeout;
+    Gtk::SpinButton spin_read_timeout;
     
     Gtk::CheckButton check_remember;
+    Gtk::Box m_status_row{Gtk::Orientation::HORIZONTAL};
+    Gtk::Spinner m_spinner;
     Gtk::Label m_status_label;
 
     Gtk::Box m_button_box{Gtk::Orientation::HORIZONTAL};
@@ -28,10 +33,18 @@ private:
     Gtk::Button cancel_button{"Cancel"};
     Gtk::Button test_button{"Test Connection"};
 
-    std::function<void(const std::string&, unsigned int, const std::string&, const std::string&)> m_on_connect;
+    std::function<void(const ConnectionSettings&)> m_on_connect;
+
+    // Connection test runs off the GTK thread; m_test_ticker updates the
+    // elapsed time shown while it is in flight.
+    BackgroundTask m_test_task;
+    sigc::connection m_test_ticker;
+    bool m_testing = false;
 
     void on_ok();
     void on_test_connection();
+    void finish_test(const std::string& message, bool is_error);
+    std::optional<ConnectionSettings> read_settings();
     void load_saved_credentials();
     void save_credentials();
     void show_status(const std::string& message, bool is_error);
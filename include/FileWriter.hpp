@@ -0,0 +1,100 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Compression.hpp"
+
+struct FileWriterOptions {
+    std::size_t buffer_bytes = 4u << 20; // rounded up to whole pages
+    bool direct_io = false;              // O_DIRECT, where the filesystem allows it (uncompressed only)
+    Codec codec = Codec::none;           // compress the file as it is written
+    int level = 0;                       // codec level; 0 = codec default
+    unsigned int blocks_in_flight = 0;   // buffers compressing at once; 0 = one per hardware thread
+};
+
+// Append-only file output through one large buffer. Small appends are a
+// memcpy; the file sees only buffer-sized write(2) calls. With direct_io the
+// page cache is bypassed, so a multi-gigabyte export neither evicts
+// everything else nor lingers in memory after it is done.
+//
+// With a codec each full buffer is handed, uncopied, to a process-wide
+// pool of compression threads (one per hardware thread, shared by every
+// writer) and becomes an independent gzip member or zstd frame; the
+// results are written in order. Writing goes on into a spare buffer, so
+// up to `blocks_in_flight` blocks compress at once.
+class FileWriter {
+public:
+    // Creates or truncates path. Throws std::system_error.
+    explicit FileWriter(const std::string& path, FileWriterOptions options = {});
+    // Closes without flushing; call finish() to keep the data
+    ~FileWriter();
+
+    FileWriter(const FileWriter&) = delete;
+    FileWriter& operator=(const FileWriter&) = delete;
+
+    void write(std::string_view bytes)
+    {
+        if (bytes.size() <= m_capacity - m_length) {
+            std::memcpy(m_buffer + m_length, bytes.data(), bytes.size());
+            m_length += bytes.size();
+        }
+        else {
+            write_slow(bytes);
+        }
+    }
+
+    void put(char c)
+    {
+        if (m_length == m_capacity)
+            flush_buffer();
+        m_buffer[m_length++] = c;
+    }
+
+    // Flush what is buffered and close the file. Throws std::system_error.
+    void finish();
+
+    // Bytes handed to write(), buffered or not
+    std::uint64_t bytes_written() const { return m_flushed + m_length; }
+    // Bytes that have reached the file, after compression
+    std::uint64_t bytes_stored() const { return m_stored; }
+    bool direct_io() const { return m_direct; }
+
+private:
+    int m_fd = -1;
+    char* m_buffer = nullptr;
+    std::size_t m_capacity = 0;
+    std::size_t m_length = 0;
+    std::uint64_t m_flushed = 0;
+    std::uint64_t m_stored = 0;
+    bool m_direct = false;
+    std::string m_path;
+
+    // A full buffer and its compressed bytes, once the pool is done
+    struct Block {
+        char* buffer;
+        std::future<std::string> compressed;
+    };
+
+    Codec m_codec;
+    int m_level;
+    unsigned int m_blocks_in_flight;
+    std::deque<Block> m_blocks;        // compressing, in file order
+    std::vector<char*> m_spare_buffers; // returned by written blocks
+
+    char* allocate_buffer();
+    void write_slow(std::string_view bytes);
+    void flush_buffer();
+    void compress_buffer();
+    void write_oldest_block();
+    void write_all(const char* data, std::size_t length);
+};
+
+// Append the contents of src to dest. The copy stays in the kernel
+// (copy_file_range, a reflink on filesystems that support it) and falls back
+// to read/write. Throws std::system_error.
+void append_file(const std::string& dest, const std::string& src);
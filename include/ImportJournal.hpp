@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Byte range [start, end) of the source file covered by one committed batch
+struct ImportBatchRange {
+    std::uint64_t start = 0;
+    std::uint64_t end = 0;
+    std::uint64_t rows = 0;
+};
+
+// The committed batches of one import job. A batch and its journal row are
+// written in the same transaction, so after a failure the journal says
+// exactly which records are already in the table: the import resumes at
+// resume_offset() and skips any record that contains() reports.
+class ImportJournal {
+public:
+    ImportJournal() = default;
+    explicit ImportJournal(std::vector<ImportBatchRange> ranges);
+
+    bool empty() const { return m_ranges.empty(); }
+
+    // End of the committed prefix that starts at offset 0
+    std::uint64_t resume_offset() const;
+
+    // True if the record starting at this offset was committed already
+    bool contains(std::uint64_t record_offset) const;
+
+    std::uint64_t rows_committed() const { return m_rows; }
+
+private:
+    std::vector<ImportBatchRange> m_ranges; // merged, sorted by start
+    std::uint64_t m_rows = 0;
+};
+
+// Stable identity of an import source: path, size and modification time.
+// Any change to the file yields a new key, so a stale journal is never reused.
+std::string import_job_key(const std::string& path);
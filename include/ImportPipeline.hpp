@@ -0,0 +1,72 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ContactSource.hpp"
+#include "CsvParser.hpp"
+#include "ContactStore.hpp"
+#include "MappedFile.hpp"
+
+struct ImportOptions {
+    unsigned int parser_threads = 0;     // 0 = one per hardware thread
+    unsigned int writer_connections = 2; // each writer works on its own store clone()
+    std::size_t chunk_bytes = 8u << 20;  // nominal size of a parse work unit
+    std::size_t batch_rows = 5000;       // rows per writer transaction
+    std::size_t queue_batches = 8;       // parsed batches allowed in flight
+    bool skip_header = true;
+    std::string job_key;                 // non-empty: journal batches, resume this job
+};
+
+struct ImportProgress {
+    std::size_t rows_imported = 0;
+    std::size_t rows_rejected = 0;
+    std::size_t bytes_parsed = 0;
+    std::size_t total_bytes = 0;
+    std::size_t rows_resumed = 0;        // committed by an earlier run of the same job
+};
+
+// Parallel CSV import.
+//
+// The input is cut into chunks at record boundaries (using quote parity, so
+// a newline inside a quoted field never splits a record). Parser threads
+// turn chunks into validated batches, which flow through a bounded queue to
+// one or more writer connections; when the writers fall behind the parsers
+// block, so memory stays at roughly queue_batches * batch_rows rows.
+//
+// Each batch commits on its own. A failure stops the pipeline and is
+// rethrown as DBException; batches already committed stay committed.
+// With a job_key each batch also journals the byte range it covers, in the
+// same transaction, and batches never span chunks. Running the same job
+// again after a crash or cancel starts at the end of the committed prefix
+// and skips records that later committed batches already hold.
+class ImportPipeline {
+public:
+    using ProgressFn = std::function<void(const ImportProgress&)>;
+    using CancelFn = std::function<bool()>;
+
+    ImportPipeline(const ContactStore& db, ImportOptions options = {});
+
+    // on_progress is called from worker threads after each committed batch
+    ImportProgress run(std::string_view csv,
+                       const ProgressFn& on_progress = nullptr,
+                       const CancelFn& cancelled = nullptr);
+
+    // As above, releasing each chunk's pages once it has been parsed so
+    // resident memory does not grow with the file
+    ImportProgress run(MappedFile& file,
+                       const ProgressFn& on_progress = nullptr,
+                       const CancelFn& cancelled = nullptr);
+
+    // Record-aligned chunk start offsets, ending with csv.size()
+    static std::vector<std::size_t> split_chunks(std::string_view csv,
+                                                 std::size_t chunk_bytes,
+                                                 unsigned int threads);
+
+private:
+    const ContactStore& m_db;
+    ImportOptions m_options;
+    MappedFile* m_release_file = nullptr;
+};
@@ -0,0 +1,100 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include "ContactStore.hpp"
+
+// A ContactStore held entirely in process memory.
+//
+// Rows sit in an array indexed by id, so lookups, updates and id-ordered
+// streams never search, and a name-ordered index is kept up to date on
+// every write for the list, paging and searches. Ids, validation, error
+// messages and ordering follow the MariaDB backend, including its
+// case-insensitive comparisons, so the UI and import/export can be timed
+// against it without a server. Nothing is persisted.
+//
+// clone() returns another handle on the same rows. Rows live in shared
+// chunks that writers copy before changing while a reader still holds them,
+// so a stream or a snapshot pins the rows it started with without holding
+// any lock, and a slow consumer never blocks writers. Only
+// lock_contacts_for_read() holds writers off, until unlock_tables().
+class InMemoryStore : public ContactStore {
+public:
+    InMemoryStore();
+    ~InMemoryStore() override;
+
+    std::unique_ptr<ContactStore> clone() const override;
+
+    bool test_connection() override { return true; }
+    void initialize_schema() override {}
+
+    Contact insert_contact(const std::string& first,
+                           const std::string& last,
+                           const std::string& email,
+                           const std::string& mobile) override;
+
+    Contact update_contact(ContactId id,
+                           const std::string& first,
+                           const std::string& last,
+                           const std::string& email,
+                           const std::string& mobile) override;
+
+    void delete_contact(ContactId id) override;
+
+    std::optional<Contact> get_contact_by_id(ContactId id) override;
+    std::optional<Contact> get_contact_if_changed(ContactId id, const std::string& known_updated_at) override;
+    std::vector<Contact> get_all_contacts() const override;
+    std::vector<Contact> get_contacts_page(std::size_t offset, std::size_t limit) const override;
+    void get_contacts_page(std::size_t offset, std::size_t limit, ContactTable& out) const override;
+    std::pmr::vector<PmrContact> get_contacts_page(std::size_t offset,
+                                                   std::size_t limit,
+                                                   std::pmr::memory_resource* mr) const override;
+    void get_contacts_page_after(const Contact& after, std::size_t limit, ContactTable& out) const override;
+    using ContactStore::stream_contacts;
+    std::size_t stream_contacts(const IdRange& ids,
+                                const std::function<bool(const Contact&)>& visit,
+                                std::size_t fetch_size = 4096) const override;
+    std::size_t stream_contacts(const ContactQuery& query,
+                                const std::function<bool(const Contact&)>& visit,
+                                std::size_t fetch_size = 4096) const override;
+    std::optional<IdRange> get_id_bounds() const override;
+    std::vector<Contact> get_contacts_updated_since(const std::string& since) const override;
+    std::vector<ContactId> get_contact_ids() const override;
+    std::vector<Contact> get_contacts_by_ids(const std::vector<ContactId>& ids) const override;
+
+    bool lock_contacts_for_read() override;
+    void unlock_tables() override;
+    void begin_snapshot() override;
+    void end_snapshot() override;
+
+    std::vector<Contact> search_contacts(const std::string& query) const override;
+    std::pmr::vector<PmrContact> search_contacts(const std::string& query,
+                                                 std::pmr::memory_resource* mr) const override;
+    std::vector<Contact> get_contacts_sorted(const std::string& column, bool ascending = true) const override;
+    std::vector<Contact> get_contacts_by_domain(const std::string& domain) const override;
+
+    int get_contact_count() const override;
+
+    void delete_all_contacts() override;
+    void insert_batch(const std::vector<Contact>& contacts) override;
+    bool insert_batch(const std::vector<Contact>& contacts,
+                      const std::string& job_key,
+                      const ImportBatchRange& range,
+                      std::uint64_t batch_no) override;
+    ImportJournal load_import_journal(const std::string& job_key) const override;
+    void finish_import_job(const std::string& job_key) override;
+
+private:
+    struct Table;
+    struct State;
+
+    explicit InMemoryStore(std::shared_ptr<State> state);
+
+    // The rows reads should see: the open snapshot, or the live rows now
+    std::shared_ptr<const Table> rows() const;
+
+    std::shared_ptr<State> m_state;
+    // Guards the per-handle state below
+    mutable std::mutex m_mutex;
+    std::shared_ptr<const Table> m_snapshot;
+    bool m_locked = false;
+};
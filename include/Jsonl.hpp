@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include "ContactFormat.hpp"
+#include "LineReader.hpp"
+#include "MappedFile.hpp"
+
+// A JSON string as it appears in the input. Like CsvField, it points into
+// the source buffer and is unescaped only when it holds escapes.
+struct JsonString {
+    std::string_view raw;                // between the quotes
+    bool has_escapes = false;
+
+    std::string str() const;
+};
+
+// Decode one JSON Lines record, {"first_name": "...", "last_name": "...",
+// "email": "...", "mobile": "..."}; camelCase keys are accepted too. Other
+// members, of any type, are skipped. Returns false on malformed JSON.
+bool parse_contact_json(std::string_view line, Contact& contact);
+
+// Streams contacts out of a JSON Lines (NDJSON) file, one object per line.
+// Over a MappedFile nothing is copied until a field becomes a Contact
+// string; over a ByteSource (compressed input) lines are views into the
+// reader's window. A leading UTF-8 BOM is skipped; malformed lines count
+// as rejected.
+class JsonlContactSource : public ContactSource {
+public:
+    explicit JsonlContactSource(MappedFile& file);
+    explicit JsonlContactSource(std::unique_ptr<ByteSource> input);
+
+    bool next(Contact& contact) override;
+    std::size_t rejected() const override { return m_rejected; }
+
+    std::uint64_t record_offset() const override { return m_record_offset; }
+    std::uint64_t position() const override;
+    bool seek(std::uint64_t offset) override;
+
+private:
+    MappedFile* m_file = nullptr;
+    std::size_t m_pos = 0;               // next line in m_file
+    std::size_t m_released = 0;
+    std::unique_ptr<ByteSource> m_input;
+    std::optional<LineReader> m_lines;
+    std::size_t m_rejected = 0;
+    std::uint64_t m_record_offset = 0;
+
+    bool next_line(std::string_view& line, std::uint64_t& start);
+};
+
+// Writes one compact JSON object per contact, including its id
+class JsonlWriter : public ContactWriter {
+public:
+    explicit JsonlWriter(FileWriter& out) : m_out(out) {}
+
+    void write(const Contact& contact) override;
+
+private:
+    FileWriter& m_out;
+
+    void string(std::string_view value);
+};
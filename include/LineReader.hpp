@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "Compression.hpp"
+
+// Splits a ByteSource into lines (LF, CRLF or lone CR) through a refilling
+// window, so line-oriented formats stream in constant memory. A line longer
+// than the window grows it.
+class LineReader {
+public:
+    explicit LineReader(ByteSource& input, std::size_t window_bytes = 1u << 20);
+
+    // Next line without its terminator. The view stays valid until the
+    // next call to next() or peek().
+    bool next(std::string_view& line);
+
+    // First byte of the next line without consuming it; -1 at end of input
+    int peek();
+
+    // Stream offset where the next line starts
+    std::uint64_t offset() const { return m_base + m_pos; }
+
+    // Discard bytes from the front of the stream; only before the first line
+    bool skip(std::uint64_t bytes);
+
+private:
+    ByteSource& m_input;
+    std::vector<char> m_window;
+    std::size_t m_pos = 0;               // next unread byte in m_window
+    std::size_t m_filled = 0;
+    std::uint64_t m_base = 0;            // stream offset of m_window[0]
+    bool m_eof = false;
+
+    // Move unread bytes to the front and read more; false if nothing was added
+    bool refill();
+};
@@ -0,0 +1,117 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "ContactStore.hpp"
+
+struct LogStoreOptions {
+    bool sync = true;                        // fdatasync before a write returns
+    double compact_garbage_ratio = 0.5;      // compact once dead bytes pass this share of the log
+    std::uint64_t compact_min_bytes = 64u << 20; // ...and the log is at least this large
+};
+
+// An embedded ContactStore for machines without a server: one directory
+// holding an append-only record log and its persisted indexes.
+//
+// Every write appends one checksummed record, so a batch commits or
+// vanishes as a whole: on open the log is replayed and a torn or corrupt
+// tail is cut off at the last good record. Rows are read straight out of
+// a shared mapping of the log, located through an id index that replay
+// rebuilds. The name and email orders are kept as sorted indexes, saved
+// next to the log on close and after compaction, so a restart only
+// re-sorts what was written since they were saved. Once enough of the log
+// is superseded rows it is compacted: the live rows are rewritten to a new
+// log that replaces the old one atomically.
+//
+// Handles from clone() share the open store. Streams and snapshots pin the
+// mapping and a copy of the id index, so they never hold writers up, and
+// a compaction underneath them does not disturb them. Only one process may
+// open a directory at a time.
+class LogStore : public ContactStore {
+public:
+    // Opens the store in dir, creating it if needed, and replays the log.
+    // Throws DBException.
+    explicit LogStore(const std::string& dir, LogStoreOptions options = {});
+    ~LogStore() override;
+
+    std::unique_ptr<ContactStore> clone() const override;
+
+    bool test_connection() override { return true; }
+    void initialize_schema() override {}
+
+    Contact insert_contact(const std::string& first,
+                           const std::string& last,
+                           const std::string& email,
+                           const std::string& mobile) override;
+
+    Contact update_contact(ContactId id,
+                           const std::string& first,
+                           const std::string& last,
+                           const std::string& email,
+                           const std::string& mobile) override;
+
+    void delete_contact(ContactId id) override;
+
+    std::optional<Contact> get_contact_by_id(ContactId id) override;
+    std::optional<Contact> get_contact_if_changed(ContactId id, const std::string& known_updated_at) override;
+    std::vector<Contact> get_all_contacts() const override;
+    std::vector<Contact> get_contacts_page(std::size_t offset, std::size_t limit) const override;
+    void get_contacts_page(std::size_t offset, std::size_t limit, ContactTable& out) const override;
+    std::pmr::vector<PmrContact> get_contacts_page(std::size_t offset,
+                                                   std::size_t limit,
+                                                   std::pmr::memory_resource* mr) const override;
+    void get_contacts_page_after(const Contact& after, std::size_t limit, ContactTable& out) const override;
+    using ContactStore::stream_contacts;
+    std::size_t stream_contacts(const IdRange& ids,
+                                const std::function<bool(const Contact&)>& visit,
+                                std::size_t fetch_size = 4096) const override;
+    std::size_t stream_contacts(const ContactQuery& query,
+                                const std::function<bool(const Contact&)>& visit,
+                                std::size_t fetch_size = 4096) const override;
+    std::optional<IdRange> get_id_bounds() const override;
+    std::vector<Contact> get_contacts_updated_since(const std::string& since) const override;
+    std::vector<ContactId> get_contact_ids() const override;
+    std::vector<Contact> get_contacts_by_ids(const std::vector<ContactId>& ids) const override;
+
+    bool lock_contacts_for_read() override;
+    void unlock_tables() override;
+    void begin_snapshot() override;
+    void end_snapshot() override;
+
+    std::vector<Contact> search_contacts(const std::string& query) const override;
+    std::pmr::vector<PmrContact> search_contacts(const std::string& query,
+                                                 std::pmr::memory_resource* mr) const override;
+    std::vector<Contact> get_contacts_sorted(const std::string& column, bool ascending = true) const override;
+    std::vector<Contact> get_contacts_by_domain(const std::string& domain) const override;
+
+    int get_contact_count() const override;
+
+    void delete_all_contacts() override;
+    void insert_batch(const std::vector<Contact>& contacts) override;
+    bool insert_batch(const std::vector<Contact>& contacts,
+                      const std::string& job_key,
+                      const ImportBatchRange& range,
+                      std::uint64_t batch_no) override;
+    ImportJournal load_import_journal(const std::string& job_key) const override;
+    void finish_import_job(const std::string& job_key) override;
+
+    // Rewrite the log with only the live rows now instead of waiting for
+    // the garbage threshold
+    void compact();
+
+private:
+    struct View;
+    struct State;
+
+    explicit LogStore(std::shared_ptr<State> state);
+
+    // What reads should see: the open snapshot, or the store as it is now
+    std::shared_ptr<const View> view() const;
+
+    std::shared_ptr<State> m_state;
+    // Guards the per-handle state below
+    mutable std::mutex m_mutex;
+    std::shared_ptr<const View> m_snapshot;
+    bool m_locked = false;
+};
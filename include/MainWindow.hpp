@@ -1,16 +1,49 @@
 #pragma once
 #include <gtkmm.h>
+#include <array>
+#include <functional>
 #include <memory>
-#include "DB.hpp"
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "ContactStore.hpp"
+#include "ContactFields.hpp"
 #include "ContactDialogs.hpp"
+#include "ContactSorter.hpp"
+#include "ContactTable.hpp"
+#include "BackgroundTask.hpp"
+#include "ImportPipeline.hpp"
+#include "ContactExport.hpp"
+#include "ContactSnapshot.hpp"
 
 class MainWindow : public Gtk::ApplicationWindow
 {
 public:
-    MainWindow(std::shared_ptr<DB> db);
+    // The window is built before the database is ready and shows a loading
+    // state until attach_database() hands it the first page of contacts.
+    MainWindow();
+
+    void show_loading(const std::string& message);
+    void set_on_cancel_loading(std::function<void()> on_cancel);
+    void attach_database(std::shared_ptr<ContactStore> db,
+                         ContactTable first_page,
+                         int total_contacts);
+
+    // Keep a ContactSnapshot of source's rows after each full load. Set
+    // before attach_database(); empty (the default) keeps none.
+    void set_snapshot_source(std::string source);
+    // Show the rows of the last session while the store is still opening.
+    // The list stays read-only until the attach_database() overload below.
+    void show_snapshot(std::shared_ptr<const ContactSnapshot> snapshot);
+    // Attach after show_snapshot(): apply what changed since the snapshot
+    // instead of loading the list again
+    void attach_database(std::shared_ptr<ContactStore> db,
+                         SnapshotDelta delta,
+                         int total_contacts);
 
 private:
-    std::shared_ptr<DB> m_db;
+    std::shared_ptr<ContactStore> m_db;
 
     // Layout
     Gtk::Box m_main_box{Gtk::Orientation::VERTICAL};
@@ -31,21 +64,39 @@ private:
     
     // Status bar
     Gtk::Label m_status_label;
+
+    // Loading state
+    Gtk::Box m_loading_box{Gtk::Orientation::HORIZONTAL};
+    Gtk::Spinner m_loading_spinner;
+    Gtk::Label m_loading_label;
+    Gtk::Button m_loading_cancel_button{"Cancel"};
+    std::function<void()> m_on_cancel_loading;
+    BackgroundTask m_list_loader;
+    BackgroundTask m_import_task;
+    BackgroundTask m_export_task;
+
+    // Cached copy of the list for the next start
+    std::string m_snapshot_source;
+    std::shared_ptr<const ContactSnapshot> m_snapshot;
+    bool m_snapshot_loading = false;             // rows still coming from m_snapshot
+    std::optional<SnapshotDelta> m_pending_delta; // applied once they have all arrived
+    BackgroundTask m_snapshot_writer;
     
     // Scrolled window for tree view
     Gtk::ScrolledWindow m_scrolled_window;
 
-    // TreeView model
+    // TreeView model: the hidden id and row of m_contacts, then one
+    // column per editable field
     struct ModelColumns : public Gtk::TreeModel::ColumnRecord {
         ModelColumns() {
-            add(col_id); add(col_first); add(col_last);
-            add(col_email); add(col_mobile);
+            add(col_id);
+            add(col_row);
+            for (auto& col : col_fields)
+                add(col);
         }
-        Gtk::TreeModelColumn<int> col_id;
-        Gtk::TreeModelColumn<std::string> col_first;
-        Gtk::TreeModelColumn<std::string> col_last;
-        Gtk::TreeModelColumn<std::string> col_email;
-        Gtk::TreeModelColumn<std::string> col_mobile;
+        Gtk::TreeModelColumn<guint64> col_id;
+        Gtk::TreeModelColumn<guint64> col_row;
+        std::array<Gtk::TreeModelColumn<std::string>, contact_fields::count<contact_fields::editable>()> col_fields;
     };
 
     ModelColumns m_columns;
@@ -59,6 +110,22 @@ private:
     std::string m_sort_column = "last_name";
     bool m_sort_ascending = true;
 
+    // Rows loaded into the list store, in the order the DB returned them,
+    // then rows saved since; each store row holds its index here in
+    // col_row. A removed or replaced row stays in the table, unshown,
+    // until the next full load.
+    ContactTable m_contacts;
+    std::vector<bool> m_shown;
+    ContactSorter m_sorter;
+    std::string m_sorter_column; // column m_sorter's keys were built for
+    // The store's order came from m_sorter rather than from the DB's
+    bool m_client_sorted = false;
+
+    // Store row of each loaded contact; ListStore iterators stay valid
+    // across inserts and removals, so single rows can be patched in place.
+    std::unordered_map<ContactId, Gtk::TreeModel::iterator> m_rows_by_id;
+    int m_total_contacts = 0;
+
     // Event handlers
     void on_add_contact();
     void on_edit_contact();
@@ -67,15 +134,39 @@ private:
     void on_clear_search();
     void on_import_csv();
     void on_export_csv();
+    static void add_format_filters(Gtk::FileChooserDialog& dialog);
+    void start_import(const std::string& path);
+    void show_import_progress(const ImportProgress& progress);
+    void start_export(const std::string& path);
+    void show_export_progress(const ExportProgress& progress);
     void on_column_clicked(const std::string& column);
     void on_row_activated([[maybe_unused]] const Gtk::TreeModel::Path& path,
                       [[maybe_unused]] Gtk::TreeViewColumn* column);
     
     // Helpers
+    void finish_loading();
+    void apply_delta(const SnapshotDelta& delta);
     void refresh_list();
+    void show_rows(ContactTable contacts);
+    // Shows contacts' rows from first on
+    void append_rows(ContactTable contacts, std::size_t first = 0);
+    void set_controls_sensitive(bool sensitive);
     void update_status();
+    void adjust_status(int delta);
+    void on_contact_saved(const Contact& contact, bool is_new);
+    void upsert_row(const Contact& contact);
+    void remove_row(ContactId id);
+    std::size_t sorted_position(std::size_t row) const;
+    bool sorts_before(std::size_t row_a, std::size_t row_b) const;
+    std::size_t row_at(std::size_t position) const;
+    void set_row_values(Gtk::TreeModel::Row& row, std::size_t index);
+    static bool matches_search(const Contact& c, const std::string& query);
     void show_error(const std::string& message);
     void show_info(const std::string& message);
-    std::optional<int> get_selected_id();
+    std::optional<ContactId> get_selected_id();
+    std::optional<Contact> get_selected_contact();
     void setup_tree_view_columns();
+    void apply_sort();
+    void update_sort_indicators();
+    static std::string_view contact_field(const ContactTable::Row& c, const std::string& column);
 };
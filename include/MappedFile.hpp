@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Read-only memory mapping of a whole file. Parsers work directly on the
+// mapped bytes, so fields can be handed out as string_views without copying.
+class MappedFile {
+public:
+    // Throws std::system_error if the file cannot be opened or mapped
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view data() const { return {m_data, m_size}; }
+    std::size_t size() const { return m_size; }
+
+    // Hint that the file will be read front to back
+    void advise_sequential();
+
+    // Drop the resident pages wholly inside [offset, offset + length). The
+    // bytes stay readable; touching them again faults them back in.
+    void release(std::size_t offset, std::size_t length);
+
+private:
+    const char* m_data = nullptr;
+    std::size_t m_size = 0;
+
+    void unmap();
+};
@@ -0,0 +1,25 @@
+#pragma once
+#include <chrono>
+#include <string>
+
+// Lightweight timing metrics. Each sample is logged to stdout and, when the
+// CONTACTS_METRICS_FILE environment variable names a file, appended to it as
+// "<unix time> <name> <milliseconds>" so runs can be compared over time.
+namespace metrics {
+
+class Stopwatch {
+public:
+    Stopwatch() : m_start(std::chrono::steady_clock::now()) {}
+
+    double elapsed_ms() const {
+        return std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - m_start).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point m_start;
+};
+
+void record(const std::string& name, double milliseconds);
+
+} // namespace metrics
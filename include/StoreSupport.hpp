@@ -0,0 +1,135 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "ContactFields.hpp"
+#include "ContactStore.hpp"
+
+// Helpers shared by the backends that run queries in process rather than
+// on a server, so they validate, match and order rows exactly alike.
+
+// ASCII case folding, close enough to utf8mb4_general_ci for ordering and
+// for the LIKE '%query%' searches
+inline unsigned char fold_ascii(unsigned char c)
+{
+    return (c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c + ('a' - 'A')) : c;
+}
+int compare_ci(std::string_view a, std::string_view b);
+// The first eight bytes of a field, case-folded and packed big-endian, so
+// comparing prefixes orders rows as compare_ci would, except for ties
+inline std::uint64_t folded_prefix(std::string_view field)
+{
+    std::uint64_t prefix = 0;
+    for (std::size_t i = 0; i < 8; ++i) {
+        prefix <<= 8;
+        if (i < field.size())
+            prefix |= fold_ascii(static_cast<unsigned char>(field[i]));
+    }
+    return prefix;
+}
+// Search folding: letters of every script case-folded by Unicode simple
+// case folding ("Σ" and "ς" -> "σ"), then the accented letters of Latin-1
+// and Latin Extended-A reduced to their base letters ("Ø" -> "o", "ß" ->
+// "ss"). Everything else, invalid UTF-8 included, is kept as is.
+void append_folded(std::string& out, std::string_view text);
+std::string fold_search(std::string_view text);
+// Whether field contains query once both are search-folded
+bool contains_ci(std::string_view field, std::string_view query);
+
+// Joins the fields of a search key; no field or query is expected to
+// contain it, so a match never spans two fields
+constexpr char kSearchKeySeparator = '\x1f';
+
+// The search_key DB keeps with each row: the searchable fields, folded,
+// joined by kSearchKeySeparator. A search for q is then one binary
+// substring test of fold_search(q) against it.
+template <typename Row>
+std::string search_key(const Row& row)
+{
+    std::string key;
+    bool first = true;
+    contact_fields::for_each<contact_fields::searchable>([&](const auto& f) {
+        if (!first)
+            key += kSearchKeySeparator;
+        first = false;
+        append_folded(key, f.get(row));
+    });
+    return key;
+}
+
+// The part of email after its last '@', or empty if it has none; what DB
+// stores as email_domain
+std::string_view email_domain(std::string_view email);
+// The search box's domain facet: "@example.com" alone names the contacts
+// whose email is at exactly that domain. Returns the domain, or empty when
+// query is an ordinary search.
+std::string_view domain_facet(std::string_view query);
+
+// The search box's match: a domain facet compares the email's domain,
+// ignoring case; anything else is a substring of any field, under search
+// folding. Empty matches all. Row is a Contact or anything with the same
+// field names.
+template <typename Row>
+bool matches_search(const Row& c, const std::string& query)
+{
+    std::string_view domain = domain_facet(query);
+    if (!domain.empty())
+        return compare_ci(email_domain(c.email), domain) == 0;
+    bool found = query.empty();
+    contact_fields::for_each<contact_fields::searchable>([&](const auto& f) {
+        found = found || contains_ci(f.get(c), query);
+    });
+    return found;
+}
+
+// The insert/update checks DB applies, with the same messages; throws DBException
+void validate_contact(const std::string& first, const std::string& last, const std::string& email);
+
+// The order DB::order_by_clause produces: the column, first name after last
+// name, then id, all in the same direction. Unknown columns sort by last name.
+// Compares Contacts or anything with the same field names.
+class ContactLess {
+public:
+    enum class Column { id, first_name, last_name, email, mobile };
+
+    ContactLess(const std::string& column, bool ascending);
+
+    Column column() const { return m_column; }
+    bool ascending() const { return m_ascending; }
+
+    template <typename RowA, typename RowB>
+    bool operator()(const RowA& a, const RowB& b) const
+    {
+        int cmp = 0;
+        switch (m_column) {
+        case Column::id:         cmp = (a.id > b.id) - (a.id < b.id); break;
+        case Column::first_name: cmp = compare_ci(a.first_name, b.first_name); break;
+        case Column::email:      cmp = compare_ci(a.email, b.email); break;
+        case Column::mobile:     cmp = compare_ci(a.mobile, b.mobile); break;
+        case Column::last_name:
+            cmp = compare_ci(a.last_name, b.last_name);
+            if (cmp == 0)
+                cmp = compare_ci(a.first_name, b.first_name);
+            break;
+        }
+        if (cmp == 0)
+            cmp = (a.id > b.id) - (a.id < b.id);
+        return m_ascending ? cmp < 0 : cmp > 0;
+    }
+
+private:
+    Column m_column = Column::last_name;
+    bool m_ascending;
+};
+
+// updated_at values for rows written in process: TIMESTAMP(6) strings in
+// UTC that move on every call, even twice within the same microsecond.
+// Not thread-safe; callers hold their write lock.
+class UpdateClock {
+public:
+    std::string next();
+
+private:
+    std::chrono::system_clock::time_point m_last;
+};
@@ -0,0 +1,50 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <string_view>
+#include "ContactFormat.hpp"
+#include "LineReader.hpp"
+
+// Streams contacts out of a vCard file (2.1, 3.0 or 4.0), one card at a
+// time, so a million-card export from a phone imports in constant memory.
+//
+// Folded lines are unfolded, quoted-printable values (2.1) decoded and
+// Latin-1 charsets converted to UTF-8. A card maps to a Contact through N
+// (falling back to FN), its preferred EMAIL and its preferred mobile TEL.
+// Offsets are those of BEGIN:VCARD lines, so imports are resumable.
+class VCardContactSource : public ContactSource {
+public:
+    explicit VCardContactSource(std::unique_ptr<ByteSource> input);
+
+    bool next(Contact& contact) override;
+    std::size_t rejected() const override { return m_rejected; }
+
+    std::uint64_t record_offset() const override { return m_record_offset; }
+    std::uint64_t position() const override { return m_lines.offset(); }
+    bool seek(std::uint64_t offset) override { return m_lines.skip(offset); }
+
+private:
+    std::unique_ptr<ByteSource> m_input;
+    LineReader m_lines;
+    std::string m_line;                  // current unfolded line
+    std::size_t m_rejected = 0;
+    std::uint64_t m_record_offset = 0;
+
+    bool next_line();
+};
+
+// Writes contacts as vCard 3.0 (the version every address book reads) or
+// 4.0, with CRLF line ends and lines folded at 75 octets
+class VCardWriter : public ContactWriter {
+public:
+    explicit VCardWriter(FileWriter& out, int version = 3);
+
+    void write(const Contact& contact) override;
+
+private:
+    FileWriter& m_out;
+    int m_version;
+    std::string m_line;
+
+    void property(std::string_view name, std::string_view value);
+};
@@ -6,17 +6,83 @@ USE Contacts;
 
 -- Create contacts table
 CREATE TABLE IF NOT EXISTS contacts (
-    id INT AUTO_INCREMENT PRIMARY KEY,
+    id BIGINT UNSIGNED NOT NULL AUTO_INCREMENT PRIMARY KEY,
     first_name VARCHAR(100),
     last_name VARCHAR(100),
     email VARCHAR(255),
     mobile VARCHAR(50),
     created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
-    updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP ON UPDATE CURRENT_TIMESTAMP,
-    INDEX idx_name (first_name, last_name),
-    INDEX idx_email (email)
+    -- Microseconds, so two edits within one second still differ
+    updated_at TIMESTAMP(6) DEFAULT CURRENT_TIMESTAMP(6) ON UPDATE CURRENT_TIMESTAMP(6),
+    -- The searchable fields case-folded, Latin accents removed, joined by 0x1F;
+    -- written by the application, NULL for rows it has not keyed yet
+    search_key VARCHAR(1024) CHARACTER SET utf8mb4 COLLATE utf8mb4_bin NULL,
+    -- Everything after the last '@' of email, lower-cased; kept by the server
+    email_domain VARCHAR(255) AS
+        (LOWER(IF(LOCATE('@', email) > 0, SUBSTRING_INDEX(email, '@', -1), NULL))) STORED,
+    -- Covers the list and its pages in their order: no filesort, no row lookups
+    INDEX idx_list (last_name, first_name, id, email, mobile, updated_at),
+    INDEX idx_first_name (first_name),
+    INDEX idx_email (email),
+    INDEX idx_mobile (mobile),
+    -- "All contacts at a domain", in list order
+    INDEX idx_email_domain (email_domain, last_name, first_name, id),
+    INDEX idx_updated_at (updated_at)
 ) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4;
 
+-- Journal of committed import batches, so an interrupted import can resume
+CREATE TABLE IF NOT EXISTS import_batches (
+    job_key CHAR(16) NOT NULL,
+    start_offset BIGINT UNSIGNED NOT NULL,
+    end_offset BIGINT UNSIGNED NOT NULL,
+    batch_no BIGINT UNSIGNED NOT NULL,
+    row_count INT UNSIGNED NOT NULL,
+    committed_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
+    PRIMARY KEY (job_key, start_offset)
+) ENGINE=InnoDB;
+
+-- One row per finished one-off task (the search_key backfill), so the
+-- application does not start it again on every launch
+CREATE TABLE IF NOT EXISTS maintenance_tasks (
+    name VARCHAR(64) NOT NULL PRIMARY KEY,
+    finished_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
+) ENGINE=InnoDB;
+
+-- Schema version bookkeeping used by the application's migration runner.
+-- Version 1 is the contacts table above, version 2 the import journal,
+-- version 3 the updated_at index used to catch cached copies up, version 4
+-- the widening of contacts.id to BIGINT UNSIGNED, version 5 idx_list, which
+-- replaced idx_name (first_name, last_name), version 6 search_key, version 7
+-- email_domain and its index, version 8 maintenance_tasks, version 9 the
+-- re-keying of search_key for case folding beyond Latin, version 10
+-- microsecond updated_at, version 11 idx_mobile.
+--
+-- The application applies versions 4, 7 and 10 with ALTER TABLE ... LOCK=SHARED,
+-- which blocks writes while the table is copied. To change a large table
+-- without that pause, run the same ALTER through an online schema change
+-- tool (pt-online-schema-change, gh-ost) and then record the version by
+-- hand so the application skips it, for example:
+--   INSERT INTO schema_version (version, description)
+--   VALUES (4, 'Widen contact ids to BIGINT UNSIGNED');
+CREATE TABLE IF NOT EXISTS schema_version (
+    version INT PRIMARY KEY,
+    description VARCHAR(255),
+    applied_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4;
+
+INSERT IGNORE INTO schema_version (version, description) VALUES
+    (1, 'Create contacts table'),
+    (2, 'Journal committed import batches'),
+    (3, 'Index updated_at for incremental sync'),
+    (4, 'Widen contact ids to BIGINT UNSIGNED'),
+    (5, 'Cover the list order with idx_list'),
+    (6, 'Keep a folded search_key on each contact'),
+    (7, 'Index contacts by email domain'),
+    (8, 'Record finished maintenance tasks'),
+    (9, 'Re-key search_key with full case folding'),
+    (10, 'Store updated_at to the microsecond'),
+    (11, 'Index mobile for sorting');
+
 -- Grant privileges
 GRANT ALL PRIVILEGES ON Contacts.* TO 'root'@'localhost';
 FLUSH PRIVILEGES;
@@ -0,0 +1,47 @@
+#include "BackgroundTask.hpp"
+
+void TaskContext::post(std::function<void()> fn) const
+{
+    std::lock_guard<std::mutex> lock(m_shared->mutex);
+    if (!m_shared->dispatcher || m_cancel->load())
+        return;
+
+    // Cancellation is re-checked on the GTK thread, where cancel() is called
+    m_shared->ready.push_back([cancel = m_cancel, fn = std::move(fn)]() {
+        if (!cancel->load())
+            fn();
+    });
+    m_shared->dispatcher->emit();
+}
+
+BackgroundTask::BackgroundTask()
+: m_shared(std::make_shared<detail::TaskShared>()),
+  m_cancel(std::make_shared<std::atomic<bool>>(false))
+{
+    m_shared->dispatcher = &m_dispatcher;
+    m_dispatcher.connect(sigc::mem_fun(*this, &BackgroundTask::on_dispatch));
+}
+
+BackgroundTask::~BackgroundTask()
+{
+    cancel();
+    std::lock_guard<std::mutex> lock(m_shared->mutex);
+    m_shared->dispatcher = nullptr;
+    m_shared->ready.clear();
+}
+
+void BackgroundTask::cancel()
+{
+    m_cancel->store(true);
+}
+
+void BackgroundTask::on_dispatch()
+{
+    std::deque<std::function<void()>> ready;
+    {
+        std::lock_guard<std::mutex> lock(m_shared->mutex);
+        ready.swap(m_shared->ready);
+    }
+    for (auto& fn : ready)
+        fn();
+}
@@ -0,0 +1,274 @@
+#include "Compression.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <system_error>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+#ifdef CONTACTS_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+bool ends_with(const std::string& s, const char* suffix)
+{
+    std::string tail(suffix);
+    return s.size() >= tail.size() && s.compare(s.size() - tail.size(), tail.size(), tail) == 0;
+}
+
+// Compressed input is read in pieces this large
+constexpr std::size_t kInputChunk = 1u << 20;
+
+// -----------------------------
+// Plain file
+// -----------------------------
+class FileByteSource : public ByteSource {
+public:
+    explicit FileByteSource(const std::string& path)
+    : m_path(path)
+    {
+        m_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (m_fd < 0)
+            throw std::system_error(errno, std::generic_category(), "Cannot open " + path);
+#ifdef POSIX_FADV_SEQUENTIAL
+        ::posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    }
+
+    ~FileByteSource() override
+    {
+        ::close(m_fd);
+    }
+
+    std::size_t read(char* buffer, std::size_t capacity) override
+    {
+        for (;;) {
+            ssize_t n = ::read(m_fd, buffer, capacity);
+            if (n >= 0)
+                return static_cast<std::size_t>(n);
+            if (errno != EINTR)
+                throw std::system_error(errno, std::generic_category(), "Cannot read " + m_path);
+        }
+    }
+
+private:
+    int m_fd = -1;
+    std::string m_path;
+};
+
+// -----------------------------
+// gzip
+// -----------------------------
+class GzipByteSource : public ByteSource {
+public:
+    explicit GzipByteSource(const std::string& path)
+    : m_file(path),
+      m_input(kInputChunk)
+    {
+        // 16 + MAX_WBITS: expect a gzip header and trailer
+        if (inflateInit2(&m_stream, 16 + MAX_WBITS) != Z_OK)
+            throw CodecError("gzip: cannot initialise decoder");
+    }
+
+    ~GzipByteSource() override
+    {
+        inflateEnd(&m_stream);
+    }
+
+    std::size_t read(char* buffer, std::size_t capacity) override
+    {
+        m_stream.next_out = reinterpret_cast<Bytef*>(buffer);
+        m_stream.avail_out = static_cast<uInt>(std::min<std::size_t>(capacity, UINT32_MAX));
+
+        while (m_stream.avail_out > 0) {
+            if (m_stream.avail_in == 0) {
+                if (m_eof)
+                    break;
+                std::size_t n = m_file.read(m_input.data(), m_input.size());
+                if (n == 0) {
+                    m_eof = true;
+                    if (m_in_member)
+                        throw CodecError("gzip: unexpected end of file");
+                    break;
+                }
+                m_stream.next_in = reinterpret_cast<Bytef*>(m_input.data());
+                m_stream.avail_in = static_cast<uInt>(n);
+            }
+
+            m_in_member = true;
+            int rc = inflate(&m_stream, Z_NO_FLUSH);
+            if (rc == Z_STREAM_END) {
+                // Another member may follow; parallel writers produce many
+                m_in_member = false;
+                inflateReset(&m_stream);
+            }
+            else if (rc != Z_OK && rc != Z_BUF_ERROR) {
+                throw CodecError(std::string("gzip: ") + (m_stream.msg ? m_stream.msg : "corrupt data"));
+            }
+        }
+        return capacity - m_stream.avail_out;
+    }
+
+private:
+    FileByteSource m_file;
+    std::vector<char> m_input;
+    z_stream m_stream{};
+    bool m_eof = false;
+    bool m_in_member = false;
+};
+
+#ifdef CONTACTS_HAVE_ZSTD
+// -----------------------------
+// zstd
+// -----------------------------
+class ZstdByteSource : public ByteSource {
+public:
+    explicit ZstdByteSource(const std::string& path)
+    : m_file(path),
+      m_input(ZSTD_DStreamInSize()),
+      m_stream(ZSTD_createDStream())
+    {
+        if (!m_stream)
+            throw CodecError("zstd: cannot initialise decoder");
+        ZSTD_initDStream(m_stream);
+    }
+
+    ~ZstdByteSource() override
+    {
+        ZSTD_freeDStream(m_stream);
+    }
+
+    std::size_t read(char* buffer, std::size_t capacity) override
+    {
+        ZSTD_outBuffer out{buffer, capacity, 0};
+        while (out.pos < out.size) {
+            if (m_in.pos == m_in.size) {
+                if (m_eof)
+                    break;
+                std::size_t n = m_file.read(m_input.data(), m_input.size());
+                if (n == 0) {
+                    m_eof = true;
+                    if (m_pending != 0)
+                        throw CodecError("zstd: unexpected end of file");
+                    break;
+                }
+                m_in = ZSTD_inBuffer{m_input.data(), n, 0};
+            }
+            // Returns 0 at the end of each frame and continues into the next
+            m_pending = ZSTD_decompressStream(m_stream, &out, &m_in);
+            if (ZSTD_isError(m_pending))
+                throw CodecError(std::string("zstd: ") + ZSTD_getErrorName(m_pending));
+        }
+        return out.pos;
+    }
+
+private:
+    FileByteSource m_file;
+    std::vector<char> m_input;
+    ZSTD_DStream* m_stream;
+    ZSTD_inBuffer m_in{nullptr, 0, 0};
+    std::size_t m_pending = 0;
+    bool m_eof = false;
+};
+#endif
+
+} // namespace
+
+// -----------------------------
+// Codec selection
+// -----------------------------
+Codec codec_for_path(const std::string& path)
+{
+    if (ends_with(path, ".gz"))
+        return Codec::gzip;
+    if (ends_with(path, ".zst"))
+        return Codec::zstd;
+    return Codec::none;
+}
+
+bool codec_available(Codec codec)
+{
+#ifndef CONTACTS_HAVE_ZSTD
+    if (codec == Codec::zstd)
+        return false;
+#endif
+    (void)codec;
+    return true;
+}
+
+const char* codec_name(Codec codec)
+{
+    switch (codec) {
+    case Codec::gzip: return "gzip";
+    case Codec::zstd: return "zstd";
+    case Codec::none: break;
+    }
+    return "none";
+}
+
+// -----------------------------
+// Block compression
+// -----------------------------
+std::string compress_block(Codec codec, const char* data, std::size_t size, int level)
+{
+    std::string out;
+
+    if (codec == Codec::gzip) {
+        z_stream stream{};
+        // Level 6 is gzip's own default: most of the ratio at a fraction of 9's cost
+        if (deflateInit2(&stream, level ? level : 6, Z_DEFLATED, 16 + MAX_WBITS, 8,
+                         Z_DEFAULT_STRATEGY) != Z_OK)
+            throw CodecError("gzip: cannot initialise encoder");
+
+        out.resize(deflateBound(&stream, static_cast<uLong>(size)));
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        stream.avail_in = static_cast<uInt>(size);
+        stream.next_out = reinterpret_cast<Bytef*>(out.data());
+        stream.avail_out = static_cast<uInt>(out.size());
+        int rc = deflate(&stream, Z_FINISH);
+        out.resize(stream.total_out);
+        deflateEnd(&stream);
+        if (rc != Z_STREAM_END)
+            throw CodecError("gzip: compression failed");
+        return out;
+    }
+
+#ifdef CONTACTS_HAVE_ZSTD
+    if (codec == Codec::zstd) {
+        out.resize(ZSTD_compressBound(size));
+        std::size_t n = ZSTD_compress(out.data(), out.size(), data, size,
+                                      level ? level : ZSTD_CLEVEL_DEFAULT);
+        if (ZSTD_isError(n))
+            throw CodecError(std::string("zstd: ") + ZSTD_getErrorName(n));
+        out.resize(n);
+        return out;
+    }
+#endif
+
+    if (codec != Codec::none)
+        throw CodecError(std::string(codec_name(codec)) + " support is not built in");
+    return std::string(data, size);
+}
+
+// -----------------------------
+// Decoding
+// -----------------------------
+std::unique_ptr<ByteSource> open_byte_source(const std::string& path)
+{
+    switch (codec_for_path(path)) {
+    case Codec::gzip:
+        return std::make_unique<GzipByteSource>(path);
+    case Codec::zstd:
+#ifdef CONTACTS_HAVE_ZSTD
+        return std::make_unique<ZstdByteSource>(path);
+#else
+        throw CodecError("zstd support is not built in");
+#endif
+    case Codec::none:
+        break;
+    }
+    return std::make_unique<FileByteSource>(path);
+}
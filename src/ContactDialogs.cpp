@@ -1,14 +1,14 @@
 #include "ContactDialogs.hpp"
 #include <iostream>
 
-ContactDialog::ContactDialog(Gtk::Window& parent, DB& db,
-                             std::function<void()> on_saved,
-                             bool editing, int contact_id)
+ContactDialog::ContactDialog(Gtk::Window& parent, std::shared_ptr<ContactStore> db,
+                             std::function<void(const Contact&)> on_saved,
+                             std::optional<Contact> existing,
+                             bool check_freshness)
 : Gtk::Dialog(),
-  m_db(db),
+  m_db(std::move(db)),
   m_on_saved(on_saved),
-  m_editing(editing),
-  m_contact_id(contact_id),
+  m_editing(existing.has_value()),
   m_ok_button("Save"),
   m_cancel_button("Cancel")
 {
@@ -89,13 +89,16 @@ ContactDialog::ContactDialog(Gtk::Window& parent, DB& db,
     );
     
     // Clear validation on input
-    entry_first.signal_changed().connect([this]() { clear_validation_error(); });
-    entry_last.signal_changed().connect([this]() { clear_validation_error(); });
-    entry_email.signal_changed().connect([this]() { clear_validation_error(); });
-    entry_mobile.signal_changed().connect([this]() { clear_validation_error(); });
-
-    if (m_editing)
-        load_contact_data();
+    entry_first.signal_changed().connect([this]() { on_entry_changed(); });
+    entry_last.signal_changed().connect([this]() { on_entry_changed(); });
+    entry_email.signal_changed().connect([this]() { on_entry_changed(); });
+    entry_mobile.signal_changed().connect([this]() { on_entry_changed(); });
+
+    if (m_editing) {
+        load_contact_data(*existing);
+        if (check_freshness)
+            start_freshness_check();
+    }
 }
 
 void ContactDialog::on_ok_clicked()
@@ -111,14 +114,12 @@ void ContactDialog::on_ok_clicked()
     std::string mobile = trim(entry_mobile.get_text());
     
     try {
-        if (m_editing) {
-            m_db.update_contact(m_contact_id, first, last, email, mobile);
-        } else {
-            m_db.insert_contact(first, last, email, mobile);
-        }
+        Contact saved = m_editing
+            ? m_db->update_contact(m_contact_id, first, last, email, mobile)
+            : m_db->insert_contact(first, last, email, mobile);
 
         if (m_on_saved)
-            m_on_saved();
+            m_on_saved(saved);
             
         hide(); // This will trigger signal_hide() in MainWindow
     }
@@ -132,16 +133,47 @@ void ContactDialog::on_cancel_clicked()
     hide(); // This will trigger signal_hide() in MainWindow
 }
 
-void ContactDialog::load_contact_data()
+void ContactDialog::load_contact_data(const Contact& contact)
+{
+    m_loading = true;
+    m_contact_id = contact.id;
+    m_updated_at = contact.updated_at;
+
+    entry_first.set_text(contact.first_name);
+    entry_last.set_text(contact.last_name);
+    entry_email.set_text(contact.email);
+    entry_mobile.set_text(contact.mobile);
+    m_loading = false;
+}
+
+void ContactDialog::start_freshness_check()
 {
-    auto contact = m_db.get_contact_by_id(m_contact_id);
-    if (!contact)
-        return;
-
-    entry_first.set_text(contact->first_name);
-    entry_last.set_text(contact->last_name);
-    entry_email.set_text(contact->email);
-    entry_mobile.set_text(contact->mobile);
+    // The worker may outlive the dialog, so it holds its own reference
+    auto db = m_db;
+    ContactId id = m_contact_id;
+    std::string updated_at = m_updated_at;
+
+    m_freshness_check.run(
+        [db, id, updated_at](const TaskContext&) {
+            return db->get_contact_if_changed(id, updated_at);
+        },
+        [this](std::optional<Contact> latest) {
+            if (!latest)
+                return;
+            // Never overwrite what the user has already typed
+            if (m_user_edited) {
+                show_validation_error("This contact was changed elsewhere since the list was loaded");
+                return;
+            }
+            load_contact_data(*latest);
+        });
+}
+
+void ContactDialog::on_entry_changed()
+{
+    if (!m_loading)
+        m_user_edited = true;
+    clear_validation_error();
 }
 
 std::string ContactDialog::trim(const std::string& str)
@@ -170,7 +202,7 @@ bool ContactDialog::validate_input()
     }
     
     // Validate email if provided
-    if (!email.empty() && !DB::is_valid_email(email)) {
+    if (!email.empty() && !ContactStore::is_valid_email(email)) {
         show_validation_error("Please enter a valid email address");
         return false;
     }
@@ -0,0 +1,262 @@
+#include "ContactExport.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+// Report progress (and poll for cancel) this often
+constexpr std::size_t kProgressStride = 16384;
+
+void remove_files(const std::vector<std::string>& paths)
+{
+    for (const auto& path : paths)
+        std::remove(path.c_str());
+}
+
+} // namespace
+
+ContactExporter::ContactExporter(const ContactStore& db, ExportOptions options)
+: m_db(db),
+  m_options(options)
+{
+}
+
+std::string ContactExporter::part_path(const std::string& path, unsigned int index)
+{
+    std::filesystem::path p(path);
+    char suffix[16];
+    std::snprintf(suffix, sizeof(suffix), ".part%03u", index);
+    return (p.parent_path() / (p.stem().string() + suffix + p.extension().string())).string();
+}
+
+ExportProgress ContactExporter::run(const std::string& path,
+                                    const ProgressFn& on_progress,
+                                    const CancelFn& cancelled)
+{
+    // The result stream holds its connection for the whole export
+    auto conn = m_db.clone();
+
+    // A search is answered by the server's filtered stream; counting it
+    // first would cost a second pass over the table
+    const auto& view = m_options.view;
+    const bool filtered = view && !view->search.empty();
+    const bool unordered = !view || (!filtered && ((view->sort_column == "id" && view->ascending) ||
+                                                   m_options.id_order_ok));
+
+    ExportProgress progress;
+    if (!filtered)
+        progress.total_rows = static_cast<std::size_t>(conn->get_contact_count());
+
+    // Only an id-ordered dump can be cut into ranges and stitched back
+    if (unordered) {
+        const std::size_t per_partition = std::max<std::size_t>(1, m_options.min_partition_rows);
+        const auto partitions = static_cast<unsigned int>(
+            std::clamp<std::size_t>(progress.total_rows / per_partition, 1, std::max(1u, m_options.partitions)));
+
+        auto bounds = conn->get_id_bounds();
+        progress.id_order = partitions > 1 && bounds;
+        if (progress.id_order)
+            return run_partitioned(*conn, path, *bounds, partitions, progress, on_progress, cancelled);
+    }
+    return run_serial(*conn, path, progress, on_progress, cancelled);
+}
+
+ExportProgress ContactExporter::run_serial(ContactStore& conn, const std::string& path, ExportProgress progress,
+                                           const ProgressFn& on_progress, const CancelFn& cancelled)
+{
+    bool stopped = false;
+    try {
+        FileWriter file(path, m_options.file);
+        auto writer = make_contact_writer(m_options.format, file);
+        if (m_options.header)
+            writer->begin();
+
+        auto visit = [&](const Contact& c) {
+            writer->write(c);
+            if (++progress.rows_written % kProgressStride == 0) {
+                progress.bytes_written = file.bytes_written();
+                if (on_progress)
+                    on_progress(progress);
+                if (cancelled && cancelled()) {
+                    stopped = true;
+                    return false;
+                }
+            }
+            return true;
+        };
+        if (m_options.view)
+            conn.stream_contacts(*m_options.view, visit, m_options.fetch_size);
+        else
+            conn.stream_contacts(visit, m_options.fetch_size);
+
+        if (!stopped)
+            file.finish();
+        progress.bytes_written = file.bytes_written();
+    }
+    catch (...) {
+        std::remove(path.c_str());
+        throw;
+    }
+
+    if (stopped)
+        std::remove(path.c_str());
+    else
+        progress.files = {path};
+    return progress;
+}
+
+ExportProgress ContactExporter::run_partitioned(ContactStore& coordinator, const std::string& path,
+                                                const IdRange& bounds, unsigned int partitions,
+                                                ExportProgress progress,
+                                                const ProgressFn& on_progress, const CancelFn& cancelled)
+{
+    // Equal id spans; ids are mostly dense, so rows split about evenly.
+    // bounds were read before the snapshots opened, so the outer ranges are
+    // left open: a row committed in between still falls in some range.
+    std::vector<IdRange> ranges;
+    const ContactId span = (bounds.last - bounds.first) / partitions + 1;
+    for (ContactId lo = bounds.first; ranges.size() < partitions; lo += span) {
+        // Written to stay clear of overflow near the top of the id space
+        ContactId hi = bounds.last - lo < span - 1 ? bounds.last : lo + span - 1;
+        ranges.push_back(IdRange{lo, hi});
+        if (hi == bounds.last)
+            break;
+    }
+    ranges.front().first = IdRange{}.first;
+    ranges.back().last = IdRange{}.last;
+
+    // The writers share one pool of compression threads; this only bounds
+    // the buffers each keeps in flight, and so memory. Two per writer keep
+    // its partition producing while a block compresses.
+    FileWriterOptions file_options = m_options.file;
+    if (file_options.codec != Codec::none && file_options.blocks_in_flight == 0) {
+        file_options.blocks_in_flight = std::max(2u, std::thread::hardware_concurrency() /
+                                                     static_cast<unsigned int>(ranges.size()));
+    }
+
+    std::vector<std::unique_ptr<ContactStore>> connections;
+    std::vector<std::string> parts;
+    for (unsigned int i = 0; i < ranges.size(); ++i) {
+        connections.push_back(m_db.clone());
+        parts.push_back(part_path(path, i));
+    }
+
+    // Writers are held off only while the snapshots open, not for the export
+    if (m_options.consistent_snapshot) {
+        bool locked = coordinator.lock_contacts_for_read();
+        if (!locked)
+            std::cerr << "Export: cannot lock contacts; partitions may see slightly different data\n";
+        try {
+            for (auto& conn : connections)
+                conn->begin_snapshot();
+            // What the snapshots hold, not what the table held before them
+            if (locked)
+                progress.total_rows = static_cast<std::size_t>(coordinator.get_contact_count());
+        }
+        catch (...) {
+            if (locked)
+                coordinator.unlock_tables();
+            throw;
+        }
+        if (locked)
+            coordinator.unlock_tables();
+    }
+
+    std::atomic<std::size_t> rows{0};
+    std::atomic<std::uint64_t> bytes{0};
+    std::atomic<bool> failed{false};
+    std::atomic<bool> stopped{false};
+    std::mutex report_mutex;
+    std::string error;
+
+    auto stopping = [&]() {
+        if (!stopped && cancelled && cancelled())
+            stopped = true;
+        return failed.load() || stopped.load();
+    };
+
+    auto worker = [&](std::size_t i) {
+        try {
+            FileWriter file(parts[i], file_options);
+            auto writer = make_contact_writer(m_options.format, file);
+            if (i == 0 && m_options.header)
+                writer->begin();
+
+            std::size_t local = 0;
+            std::uint64_t reported_bytes = 0;
+            connections[i]->stream_contacts(ranges[i], [&](const Contact& c) {
+                writer->write(c);
+                if (++local % kProgressStride != 0)
+                    return true;
+
+                rows += kProgressStride;
+                bytes += file.bytes_written() - reported_bytes;
+                reported_bytes = file.bytes_written();
+                if (on_progress) {
+                    std::lock_guard<std::mutex> lock(report_mutex);
+                    ExportProgress snapshot = progress;
+                    snapshot.rows_written = rows.load();
+                    snapshot.bytes_written = bytes.load();
+                    on_progress(snapshot);
+                }
+                return !stopping();
+            }, m_options.fetch_size);
+            connections[i]->end_snapshot();
+
+            if (!stopping())
+                file.finish();
+            rows += local % kProgressStride;
+            bytes += file.bytes_written() - reported_bytes;
+        }
+        catch (const std::exception& e) {
+            std::lock_guard<std::mutex> lock(report_mutex);
+            if (error.empty())
+                error = e.what();
+            failed = true;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 1; i < ranges.size(); ++i)
+        threads.emplace_back(worker, i);
+    worker(0);
+    for (auto& t : threads)
+        t.join();
+
+    progress.rows_written = rows.load();
+    progress.bytes_written = bytes.load();
+
+    if (failed || stopped) {
+        remove_files(parts);
+        if (failed)
+            throw DBException("Export error: " + error);
+        return progress;
+    }
+
+    if (m_options.part_files) {
+        progress.files = parts;
+        return progress;
+    }
+
+    // Stitch in id order: part 0 becomes the output, the rest are appended
+    try {
+        std::filesystem::rename(parts[0], path);
+        for (std::size_t i = 1; i < parts.size(); ++i) {
+            append_file(path, parts[i]);
+            std::remove(parts[i].c_str());
+        }
+    }
+    catch (...) {
+        remove_files(parts);
+        std::remove(path.c_str());
+        throw;
+    }
+    progress.files = {path};
+    return progress;
+}
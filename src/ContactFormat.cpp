@@ -0,0 +1,95 @@
+#include "ContactFormat.hpp"
+#include "ContactFields.hpp"
+#include "CsvWriter.hpp"
+#include "Jsonl.hpp"
+#include "VCard.hpp"
+#include <cctype>
+
+namespace {
+
+class CsvContactWriter : public ContactWriter {
+public:
+    explicit CsvContactWriter(FileWriter& out) : m_csv(out) {}
+
+    void begin() override
+    {
+        contact_fields::for_each<contact_fields::editable>([this](const auto& f) { m_csv.field(f.title); });
+        m_csv.end_row();
+    }
+
+    void write(const Contact& c) override
+    {
+        contact_fields::for_each<contact_fields::editable>([&](const auto& f) { m_csv.field(f.get(c)); });
+        m_csv.end_row();
+    }
+
+private:
+    CsvWriter m_csv;
+};
+
+// Extension after dropping a compression suffix, lower-cased: "a.VCF.gz" -> ".vcf"
+std::string base_extension(std::string path)
+{
+    if (codec_for_path(path) != Codec::none)
+        path.erase(path.rfind('.'));
+    std::size_t dot = path.rfind('.');
+    std::size_t slash = path.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        return {};
+    std::string ext = path.substr(dot);
+    for (auto& c : ext)
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return ext;
+}
+
+} // namespace
+
+ContactFormat format_for_path(const std::string& path)
+{
+    std::string ext = base_extension(path);
+    if (ext == ".vcf" || ext == ".vcard")
+        return ContactFormat::vcard;
+    if (ext == ".jsonl" || ext == ".ndjson")
+        return ContactFormat::jsonl;
+    return ContactFormat::csv;
+}
+
+const char* format_name(ContactFormat format)
+{
+    switch (format) {
+    case ContactFormat::vcard:
+        return "vCard";
+    case ContactFormat::jsonl:
+        return "JSON Lines";
+    case ContactFormat::csv:
+        break;
+    }
+    return "CSV";
+}
+
+std::unique_ptr<ContactWriter> make_contact_writer(ContactFormat format, FileWriter& out)
+{
+    switch (format) {
+    case ContactFormat::vcard:
+        return std::make_unique<VCardWriter>(out);
+    case ContactFormat::jsonl:
+        return std::make_unique<JsonlWriter>(out);
+    case ContactFormat::csv:
+        break;
+    }
+    return std::make_unique<CsvContactWriter>(out);
+}
+
+std::unique_ptr<ContactSource> open_contact_source(const std::string& path)
+{
+    auto input = open_byte_source(path);
+    switch (format_for_path(path)) {
+    case ContactFormat::vcard:
+        return std::make_unique<VCardContactSource>(std::move(input));
+    case ContactFormat::jsonl:
+        return std::make_unique<JsonlContactSource>(std::move(input));
+    case ContactFormat::csv:
+        break;
+    }
+    return std::make_unique<StreamingCsvContactSource>(std::move(input));
+}
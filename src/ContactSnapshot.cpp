@@ -0,0 +1,328 @@
+#include "ContactSnapshot.hpp"
+#include "ContactFields.hpp"
+#include "FileWriter.hpp"
+#include "StoreSupport.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <system_error>
+#include <unordered_set>
+#include <pwd.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char kMagic[8] = {'C', 'N', 'T', 'S', 'N', 'A', 'P', '\0'};
+// Bump when the layout changes; older files are then ignored and rewritten
+constexpr std::uint32_t kVersion = 2;
+
+struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t source_size;
+    std::uint64_t count;
+    std::uint64_t heap_size;
+    char newest_updated_at[32]; // NUL-terminated
+};
+static_assert(sizeof(Header) == 64, "snapshot header layout");
+
+// Every text field, in kContactFields order, which ContactTable::Field follows
+constexpr std::size_t kFields = contact_fields::count_text();
+static_assert(kFields == ContactTable::kFields, "snapshot fields out of step with ContactTable");
+
+std::size_t rows_offset(std::size_t source_size)
+{
+    return (sizeof(Header) + source_size + 7) / 8 * 8;
+}
+
+} // namespace
+
+struct ContactSnapshot::Row {
+    std::uint64_t offset;        // of the first field in the heap
+    std::uint64_t id;
+    std::uint32_t size[kFields]; // first, last, email, mobile, updated_at
+    std::uint32_t reserved;      // keeps rows 8-byte aligned
+};
+
+// -----------------------------
+// Opening
+// -----------------------------
+std::string ContactSnapshot::path_for(const std::string& source)
+{
+    const char* cache = std::getenv("XDG_CACHE_HOME");
+    std::string dir;
+    if (cache && *cache) {
+        dir = cache;
+    } else {
+        // HOME can be unset under systemd or in a minimal environment
+        const char* home = std::getenv("HOME");
+        const passwd* user = home && *home ? nullptr : ::getpwuid(::getuid());
+        dir = std::string(home && *home ? home : user ? user->pw_dir : "/tmp") + "/.cache";
+    }
+
+    // FNV-1a: stable across runs and platforms, unlike std::hash
+    std::uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : source) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.snapshot", static_cast<unsigned long long>(hash));
+    return dir + "/contacts-app/" + name;
+}
+
+std::shared_ptr<const ContactSnapshot> ContactSnapshot::open(const std::string& source)
+{
+    std::string path = path_for(source);
+    if (!std::filesystem::exists(path))
+        return nullptr;
+
+    try {
+        MappedFile file(path);
+        std::string_view data = file.data();
+        if (data.size() < sizeof(Header))
+            return nullptr;
+
+        Header header;
+        std::memcpy(&header, data.data(), sizeof(Header));
+        if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+            header.newest_updated_at[sizeof(header.newest_updated_at) - 1] != '\0')
+            return nullptr;
+        if (data.substr(sizeof(Header), header.source_size) != source)
+            return nullptr;
+
+        std::size_t rows_at = rows_offset(header.source_size);
+        if (data.size() < rows_at || header.count > (data.size() - rows_at) / sizeof(Row) ||
+            data.size() - rows_at - header.count * sizeof(Row) != header.heap_size)
+            return nullptr;
+
+        // Check every row once here so the accessors need no bounds checks
+        const Row* rows = reinterpret_cast<const Row*>(data.data() + rows_at);
+        for (std::size_t i = 0; i < header.count; ++i) {
+            std::uint64_t size = 0;
+            for (std::uint32_t field : rows[i].size)
+                size += field;
+            if (rows[i].offset > header.heap_size || size > header.heap_size - rows[i].offset)
+                return nullptr;
+        }
+
+        const char* heap = data.data() + rows_at + header.count * sizeof(Row);
+        return std::shared_ptr<const ContactSnapshot>(new ContactSnapshot(
+            std::move(file), static_cast<std::size_t>(header.count), rows, heap, header.newest_updated_at));
+    }
+    catch (const std::system_error& e) {
+        std::cerr << "Ignoring contact snapshot: " << e.what() << "\n";
+        return nullptr;
+    }
+}
+
+ContactSnapshot::ContactSnapshot(MappedFile file, std::size_t count, const Row* rows, const char* heap,
+                                 std::string newest_updated_at)
+: m_file(std::move(file)),
+  m_count(count),
+  m_rows(rows),
+  m_heap(heap),
+  m_newest_updated_at(std::move(newest_updated_at))
+{
+}
+
+// -----------------------------
+// Writing
+// -----------------------------
+void ContactSnapshot::write(const std::string& source, const std::vector<Contact>& rows)
+{
+    write(source, ContactTable(rows));
+}
+
+void ContactSnapshot::write(const std::string& source, const ContactTable& rows)
+{
+    static_assert(sizeof(Row) == 40, "snapshot row layout");
+    namespace fs = std::filesystem;
+    std::string path = path_for(source);
+    fs::create_directories(fs::path(path).parent_path());
+
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.source_size = static_cast<std::uint32_t>(source.size());
+    header.count = rows.size();
+
+    // The row table needs every heap offset, so size the heap first
+    std::vector<Row> table(rows.size());
+    std::string newest;
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+        table[i].offset = header.heap_size;
+        table[i].id = rows.id(i);
+        for (std::size_t f = 0; f < kFields; ++f) {
+            std::size_t size = rows.field(i, static_cast<ContactTable::Field>(f)).size();
+            table[i].size[f] = static_cast<std::uint32_t>(size);
+            header.heap_size += size;
+        }
+        if (rows.updated_at(i) > newest)
+            newest = rows.updated_at(i);
+    }
+    std::strncpy(header.newest_updated_at, newest.c_str(), sizeof(header.newest_updated_at) - 1);
+
+    // Write beside the old file and swap it in
+    std::string temp = path + ".tmp." + std::to_string(::getpid());
+    try {
+        FileWriter out(temp);
+        out.write(std::string_view(reinterpret_cast<const char*>(&header), sizeof(header)));
+        out.write(source);
+        out.write(std::string(rows_offset(source.size()) - sizeof(Header) - source.size(), '\0'));
+        out.write(std::string_view(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(Row)));
+        for (std::size_t i = 0; i < rows.size(); ++i) {
+            for (std::size_t f = 0; f < kFields; ++f)
+                out.write(rows.field(i, static_cast<ContactTable::Field>(f)));
+        }
+        out.finish();
+        fs::rename(temp, path);
+    }
+    catch (...) {
+        std::error_code ignored;
+        fs::remove(temp, ignored);
+        throw;
+    }
+}
+
+// -----------------------------
+// Reading
+// -----------------------------
+Contact ContactSnapshot::contact(std::size_t index) const
+{
+    const Row& row = m_rows[index];
+    const char* p = m_heap + row.offset;
+    auto field = [&p](std::uint32_t size) {
+        std::string value(p, size);
+        p += size;
+        return value;
+    };
+
+    Contact c;
+    c.id = row.id;
+    std::size_t f = 0;
+    contact_fields::for_each_text([&](const auto& text) { text.get(c) = field(row.size[f++]); });
+    return c;
+}
+
+void ContactSnapshot::contacts(std::size_t first, std::size_t count, ContactTable& out) const
+{
+    if (first >= m_count)
+        return;
+    count = std::min(count, m_count - first);
+
+    // Size the arena from the row table so the copy never reallocates
+    std::size_t bytes = 0;
+    for (std::size_t i = first; i < first + count; ++i) {
+        for (std::uint32_t size : m_rows[i].size)
+            bytes += size;
+    }
+    out.reserve(out.size() + count, out.arena_bytes() + bytes);
+    for (std::size_t i = first; i < first + count; ++i) {
+        const Row& row = m_rows[i];
+        std::string_view fields[kFields];
+        const char* p = m_heap + row.offset;
+        for (std::size_t f = 0; f < kFields; ++f) {
+            fields[f] = std::string_view(p, row.size[f]);
+            p += row.size[f];
+        }
+        out.append(row.id, fields[0], fields[1], fields[2], fields[3], fields[4]);
+    }
+}
+
+std::vector<std::pair<ContactId, std::size_t>> ContactSnapshot::ids() const
+{
+    std::vector<std::pair<ContactId, std::size_t>> ids(m_count);
+    for (std::size_t i = 0; i < m_count; ++i)
+        ids[i] = {m_rows[i].id, i};
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+// -----------------------------
+// Reconciling
+// -----------------------------
+SnapshotDelta ContactSnapshot::diff(std::vector<Contact> updated_since, const std::vector<ContactId>& live_ids) const
+{
+    SnapshotDelta delta;
+    auto cached = ids();
+
+    // The since bound is inclusive, so the store sends back rows sharing
+    // the snapshot's newest updated_at too; keep only real changes
+    for (auto& c : updated_since) {
+        auto it = std::lower_bound(cached.begin(), cached.end(), std::make_pair(c.id, std::size_t{0}));
+        if (it != cached.end() && it->first == c.id) {
+            Contact old = contact(it->second);
+            bool same = true;
+            contact_fields::for_each([&](const auto& f) { same = same && f.get(old) == f.get(c); });
+            if (same)
+                continue;
+        }
+        delta.changed.push_back(std::move(c));
+    }
+
+    // Both lists are ascending: one merge pass finds the deleted ids
+    auto live = live_ids.begin();
+    for (const auto& [id, index] : cached) {
+        while (live != live_ids.end() && *live < id)
+            ++live;
+        if (live == live_ids.end() || *live != id)
+            delta.removed.push_back(id);
+    }
+    return delta;
+}
+
+std::vector<ContactId> ContactSnapshot::missing(const std::vector<Contact>& updated_since,
+                                                const std::vector<ContactId>& live_ids) const
+{
+    auto cached = ids();
+    std::vector<ContactId> changed;
+    changed.reserve(updated_since.size());
+    for (const auto& c : updated_since)
+        changed.push_back(c.id);
+    std::sort(changed.begin(), changed.end());
+
+    // live_ids and cached are ascending: one merge pass over each
+    std::vector<ContactId> out;
+    auto cached_it = cached.begin();
+    for (ContactId id : live_ids) {
+        while (cached_it != cached.end() && cached_it->first < id)
+            ++cached_it;
+        if (cached_it != cached.end() && cached_it->first == id)
+            continue;
+        if (!std::binary_search(changed.begin(), changed.end(), id))
+            out.push_back(id);
+    }
+    return out;
+}
+
+std::vector<Contact> ContactSnapshot::apply(const SnapshotDelta& delta) const
+{
+    std::unordered_set<ContactId> replaced(delta.removed.begin(), delta.removed.end());
+    for (const auto& c : delta.changed)
+        replaced.insert(c.id);
+
+    std::vector<Contact> kept;
+    kept.reserve(m_count);
+    for (std::size_t i = 0; i < m_count; ++i) {
+        if (!replaced.count(m_rows[i].id))
+            kept.push_back(contact(i));
+    }
+
+    // The snapshot is in the server's collation order; the changed rows
+    // are merged in by the closest in-process equivalent
+    ContactLess less("last_name", true);
+    std::vector<Contact> changed = delta.changed;
+    std::sort(changed.begin(), changed.end(), less);
+
+    std::vector<Contact> rows;
+    rows.reserve(kept.size() + changed.size());
+    std::merge(std::make_move_iterator(kept.begin()), std::make_move_iterator(kept.end()),
+               std::make_move_iterator(changed.begin()), std::make_move_iterator(changed.end()),
+               std::back_inserter(rows), less);
+    return rows;
+}
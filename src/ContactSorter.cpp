@@ -0,0 +1,201 @@
+#include "ContactSorter.hpp"
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+// Below this many rows the thread start-up cost outweighs the gain
+constexpr std::size_t kParallelThreshold = 16384;
+
+std::locale user_locale()
+{
+    try {
+        return std::locale("");
+    }
+    catch (const std::runtime_error&) {
+        return std::locale::classic();
+    }
+}
+
+} // namespace
+
+// -----------------------------
+// Constructors
+// -----------------------------
+ContactSorter::ContactSorter()
+: ContactSorter(user_locale())
+{
+}
+
+ContactSorter::ContactSorter(const std::locale& locale)
+: m_locale(locale),
+  m_collate(&std::use_facet<std::collate<char>>(m_locale))
+{
+}
+
+// -----------------------------
+// Key generation
+// -----------------------------
+void ContactSorter::build_keys(std::size_t count, const ValueFn& value_of)
+{
+    clear();
+    if (count == 0) {
+        return;
+    }
+
+    // Each worker transforms a contiguous row range into its own heap, the
+    // pieces are then concatenated into the packed key array.
+    unsigned int workers = worker_count(count);
+    std::size_t per_worker = (count + workers - 1) / workers;
+
+    std::vector<std::string> heaps(workers);
+    std::vector<std::vector<std::size_t>> ends(workers);
+
+    auto transform_range = [&](unsigned int w) {
+        std::size_t begin = w * per_worker;
+        std::size_t end = std::min(count, begin + per_worker);
+        if (begin >= end) {
+            return;
+        }
+        auto& heap = heaps[w];
+        auto& row_ends = ends[w];
+        row_ends.reserve(end - begin);
+        for (std::size_t row = begin; row < end; ++row) {
+            std::string_view value = value_of(row);
+            heap += m_collate->transform(value.data(), value.data() + value.size());
+            row_ends.push_back(heap.size());
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned int w = 1; w < workers; ++w) {
+        threads.emplace_back(transform_range, w);
+    }
+    transform_range(0);
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    std::size_t total = 0;
+    for (const auto& heap : heaps) {
+        total += heap.size();
+    }
+    m_heap.reserve(total);
+    m_offsets.reserve(count + 1);
+    m_offsets.push_back(0);
+
+    for (unsigned int w = 0; w < workers; ++w) {
+        std::size_t base = m_heap.size();
+        m_heap += heaps[w];
+        for (std::size_t end : ends[w]) {
+            m_offsets.push_back(base + end);
+        }
+        std::string().swap(heaps[w]);
+    }
+}
+
+void ContactSorter::clear()
+{
+    m_heap.clear();
+    m_offsets.clear();
+}
+
+// -----------------------------
+// Sort
+// -----------------------------
+std::vector<std::size_t> ContactSorter::sort(bool ascending, const TieFn& tie_less) const
+{
+    const std::size_t count = size();
+    std::vector<std::size_t> perm(count);
+    std::iota(perm.begin(), perm.end(), std::size_t{0});
+    if (count < 2) {
+        return perm;
+    }
+
+    // Without tie_less, ties are broken on row index so the parallel sort
+    // is deterministic and matches a stable sort of the original order.
+    auto less = [this, ascending, &tie_less](std::size_t a, std::size_t b) {
+        int cmp = key(a).compare(key(b));
+        if (cmp != 0) {
+            return ascending ? cmp < 0 : cmp > 0;
+        }
+        if (tie_less) {
+            return tie_less(a, b);
+        }
+        return a < b;
+    };
+
+    unsigned int workers = worker_count(count);
+    if (workers == 1) {
+        std::sort(perm.begin(), perm.end(), less);
+        return perm;
+    }
+
+    // Sort one run per worker, then merge neighbouring runs pairwise,
+    // doubling the run width each round.
+    std::vector<std::size_t> bounds;
+    std::size_t per_worker = (count + workers - 1) / workers;
+    for (std::size_t b = 0; b < count; b += per_worker) {
+        bounds.push_back(b);
+    }
+    bounds.push_back(count);
+
+    std::vector<std::thread> threads;
+    for (std::size_t r = 0; r + 1 < bounds.size(); ++r) {
+        threads.emplace_back([&, r]() {
+            std::sort(perm.begin() + bounds[r], perm.begin() + bounds[r + 1], less);
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    std::vector<std::size_t> scratch(count);
+    while (bounds.size() > 2) {
+        std::vector<std::size_t> merged_bounds;
+        threads.clear();
+        for (std::size_t r = 0; r + 1 < bounds.size(); r += 2) {
+            std::size_t lo = bounds[r];
+            std::size_t mid = bounds[r + 1];
+            std::size_t hi = (r + 2 < bounds.size()) ? bounds[r + 2] : mid;
+            merged_bounds.push_back(lo);
+            threads.emplace_back([&, lo, mid, hi]() {
+                std::merge(perm.begin() + lo, perm.begin() + mid,
+                           perm.begin() + mid, perm.begin() + hi,
+                           scratch.begin() + lo, less);
+            });
+        }
+        merged_bounds.push_back(count);
+        for (auto& t : threads) {
+            t.join();
+        }
+        perm.swap(scratch);
+        bounds.swap(merged_bounds);
+    }
+    return perm;
+}
+
+int ContactSorter::compare(std::string_view a, std::string_view b) const
+{
+    return m_collate->compare(a.data(), a.data() + a.size(),
+                              b.data(), b.data() + b.size());
+}
+
+// -----------------------------
+// Private helpers
+// -----------------------------
+std::string_view ContactSorter::key(std::size_t row) const
+{
+    return std::string_view(m_heap).substr(m_offsets[row], m_offsets[row + 1] - m_offsets[row]);
+}
+
+unsigned int ContactSorter::worker_count(std::size_t items)
+{
+    if (items < kParallelThreshold) {
+        return 1;
+    }
+    unsigned int hw = std::thread::hardware_concurrency();
+    return std::max(1u, std::min(hw, 16u));
+}
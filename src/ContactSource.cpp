@@ -0,0 +1,195 @@
+#include "ContactSource.hpp"
+#include "ContactFields.hpp"
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace {
+
+// Give parsed pages back once this much has been consumed since the last time
+constexpr std::size_t kReleaseStride = 32u << 20;
+
+// End of the last complete record in [data, data + size), which starts on a
+// record boundary: just past the last line break outside quotes, or 0
+std::size_t complete_prefix(const char* data, std::size_t size)
+{
+    std::size_t quotes = static_cast<std::size_t>(std::count(data, data + size, '"'));
+    // Walk back over line breaks until one has an even number of quotes before it
+    for (std::size_t i = size; i > 0; --i) {
+        char c = data[i - 1];
+        if (c == '"')
+            --quotes;
+        else if ((c == '\n' || c == '\r') && quotes % 2 == 0)
+            return i;
+    }
+    return 0;
+}
+
+} // namespace
+
+// -----------------------------
+// Row mapping
+// -----------------------------
+// Columns are the editable fields in kContactFields order, as exported
+Contact contact_from_csv(const std::vector<CsvField>& fields)
+{
+    Contact contact{};
+    std::size_t i = 0;
+    contact_fields::for_each<contact_fields::editable>([&](const auto& f) {
+        if (i < fields.size())
+            f.get(contact) = fields[i].str();
+        ++i;
+    });
+    return contact;
+}
+
+bool is_importable(const Contact& contact)
+{
+    return contact.is_valid() &&
+           (contact.email.empty() || ContactStore::is_valid_email(contact.email));
+}
+
+// -----------------------------
+// CsvContactSource
+// -----------------------------
+CsvContactSource::CsvContactSource(MappedFile& file, bool skip_header)
+: m_file(file),
+  m_reader(file.data()),
+  m_skip_header(skip_header)
+{
+    m_file.advise_sequential();
+}
+
+bool CsvContactSource::next(Contact& contact)
+{
+    for (;;) {
+        std::size_t record_start = m_reader.offset();
+        if (!m_reader.next(m_fields))
+            break;
+        if (m_skip_header) {
+            m_skip_header = false;
+            continue;
+        }
+        if (m_fields.size() == 1 && m_fields[0].raw.empty())
+            continue; // blank line
+
+        std::size_t offset = m_reader.offset();
+        if (offset - m_released >= kReleaseStride) {
+            m_file.release(m_released, offset - m_released);
+            m_released = offset;
+        }
+
+        contact = contact_from_csv(m_fields);
+        if (is_importable(contact)) {
+            m_record_offset = record_start;
+            return true;
+        }
+        ++m_rejected;
+    }
+    return false;
+}
+
+bool CsvContactSource::seek(std::uint64_t offset)
+{
+    if (offset > m_file.size())
+        return false;
+    // A resume point is past the header by construction
+    if (offset > 0)
+        m_skip_header = false;
+    m_reader.seek(static_cast<std::size_t>(offset));
+    m_released = static_cast<std::size_t>(offset);
+    return true;
+}
+
+// -----------------------------
+// StreamingCsvContactSource
+// -----------------------------
+StreamingCsvContactSource::StreamingCsvContactSource(std::unique_ptr<ByteSource> input,
+                                                     bool skip_header,
+                                                     std::size_t window_bytes)
+: m_input(std::move(input)),
+  m_window(std::max<std::size_t>(window_bytes, 4096)),
+  m_skip_header(skip_header)
+{
+}
+
+bool StreamingCsvContactSource::next(Contact& contact)
+{
+    for (;;) {
+        if (m_reader) {
+            std::size_t record_start = m_reader->offset();
+            if (m_reader->next(m_fields)) {
+                if (m_skip_header) {
+                    m_skip_header = false;
+                    continue;
+                }
+                if (m_fields.size() == 1 && m_fields[0].raw.empty())
+                    continue; // blank line
+
+                contact = contact_from_csv(m_fields);
+                if (is_importable(contact)) {
+                    m_record_offset = m_base + record_start;
+                    return true;
+                }
+                ++m_rejected;
+                continue;
+            }
+            m_reader.reset();
+        }
+        if (!refill())
+            return false;
+    }
+}
+
+bool StreamingCsvContactSource::refill()
+{
+    // Keep the unparsed tail: the start of a record cut off by the window
+    std::size_t tail = m_filled - m_parsed;
+    std::memmove(m_window.data(), m_window.data() + m_parsed, tail);
+    m_base += m_parsed;
+    m_filled = tail;
+    m_parsed = 0;
+
+    for (;;) {
+        while (!m_eof && m_filled < m_window.size()) {
+            std::size_t n = m_input->read(m_window.data() + m_filled, m_window.size() - m_filled);
+            if (n == 0)
+                m_eof = true;
+            m_filled += n;
+        }
+
+        m_parsed = m_eof ? m_filled : complete_prefix(m_window.data(), m_filled);
+        if (m_parsed > 0)
+            break;
+        if (m_eof)
+            return false;
+        // A single record larger than the window: grow until it fits
+        m_window.resize(m_window.size() * 2);
+    }
+
+    m_reader.emplace(std::string_view(m_window.data(), m_parsed));
+    return true;
+}
+
+std::uint64_t StreamingCsvContactSource::position() const
+{
+    return m_base + (m_reader ? m_reader->offset() : m_parsed);
+}
+
+bool StreamingCsvContactSource::seek(std::uint64_t offset)
+{
+    if (m_base != 0 || m_filled != 0)
+        return offset == position();
+
+    // Decode and drop everything before the resume point
+    while (m_base < offset) {
+        std::size_t want = static_cast<std::size_t>(std::min<std::uint64_t>(m_window.size(), offset - m_base));
+        std::size_t n = m_input->read(m_window.data(), want);
+        if (n == 0)
+            return false;
+        m_base += n;
+    }
+    if (offset > 0)
+        m_skip_header = false;
+    return true;
+}
@@ -0,0 +1,149 @@
+#include "ContactStore.hpp"
+#include "ContactSource.hpp"
+#include <algorithm>
+#include <iostream>
+
+// -----------------------------
+// Stream contacts
+// -----------------------------
+std::size_t ContactStore::stream_contacts(const std::function<bool(const Contact&)>& visit,
+                                          std::size_t fetch_size) const
+{
+    return stream_contacts(IdRange{}, visit, fetch_size);
+}
+
+// -----------------------------
+// Import contacts
+// -----------------------------
+bool ContactStore::import_contacts(const std::vector<Contact>& contacts)
+{
+    try {
+        insert_batch(contacts);
+        std::cout << "Imported " << contacts.size() << " contacts\n";
+        return true;
+    }
+    catch (const DBException& e) {
+        std::cerr << e.what() << "\n";
+        return false;
+    }
+}
+
+// -----------------------------
+// Streaming import
+// -----------------------------
+std::size_t ContactStore::import_stream(ContactSource& source,
+                                        const StreamImportOptions& options,
+                                        const std::function<bool(std::size_t)>& on_batch,
+                                        const std::string& job_key)
+{
+    const std::size_t batch_rows = std::max<std::size_t>(1, options.batch_rows);
+    const bool journaled = !job_key.empty();
+
+    // Resume after the committed prefix; later committed batches (left by a
+    // parallel import) are skipped record by record
+    ImportJournal journal;
+    if (journaled) {
+        journal = load_import_journal(job_key);
+        if (!source.seek(journal.resume_offset()))
+            throw DBException("Import error: this source cannot resume a partial import");
+    }
+
+    std::vector<Contact> batch;
+    batch.reserve(std::min<std::size_t>(batch_rows, 65536));
+    std::size_t batch_bytes = 0;
+    std::uint64_t batch_start = 0;
+    std::uint64_t batch_no = 0;
+    // Batches start where the previous one ended, so rejected rows leave no
+    // gaps in the journal, unless a committed record was skipped since; then
+    // that point may already be a batch key and the first row starts it
+    std::uint64_t cursor = journal.resume_offset();
+    bool contiguous = true;
+    std::size_t imported = 0;
+
+    // Returns false when the caller asked to stop
+    auto flush = [&]() {
+        bool committed = true;
+        if (journaled) {
+            ImportBatchRange range{batch_start, source.position(), batch.size()};
+            committed = insert_batch(batch, job_key, range, batch_no++);
+        }
+        else {
+            insert_batch(batch);
+        }
+        if (committed)
+            imported += batch.size();
+        cursor = source.position();
+        contiguous = true;
+        batch.clear();
+        batch_bytes = 0;
+        return !on_batch || on_batch(imported);
+    };
+
+    Contact contact;
+    while (source.next(contact)) {
+        if (journaled && journal.contains(source.record_offset())) {
+            contiguous = false;
+            continue;
+        }
+        if (batch.empty())
+            batch_start = contiguous ? cursor : source.record_offset();
+
+        batch_bytes += sizeof(Contact) + contact.first_name.size() + contact.last_name.size() +
+                       contact.email.size() + contact.mobile.size();
+        batch.push_back(std::move(contact));
+        if (batch.size() >= batch_rows || batch_bytes >= options.max_batch_bytes) {
+            if (!flush()) {
+                return imported;
+            }
+        }
+    }
+    if (!batch.empty() && !flush()) {
+        return imported;
+    }
+    if (journaled) {
+        finish_import_job(job_key);
+    }
+    std::cout << "Imported " << imported << " contacts\n";
+    return imported;
+}
+
+// -----------------------------
+// Email validation
+// -----------------------------
+bool ContactStore::is_valid_email(const std::string& email)
+{
+    // Hand-rolled equivalent of
+    //   [a-zA-Z0-9._%+-]+@[a-zA-Z0-9.-]+\.[a-zA-Z]{2,}
+    // std::regex is far too slow for per-row validation during imports.
+    auto is_alpha = [](char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); };
+    auto is_alnum = [&](char c) { return is_alpha(c) || (c >= '0' && c <= '9'); };
+
+    std::size_t at = email.find('@');
+    if (at == std::string::npos || at == 0) {
+        return false;
+    }
+    for (std::size_t i = 0; i < at; ++i) {
+        char c = email[i];
+        if (!is_alnum(c) && c != '.' && c != '_' && c != '%' && c != '+' && c != '-') {
+            return false;
+        }
+    }
+
+    // The TLD must follow the last dot, so the domain splits there
+    std::size_t dot = email.rfind('.');
+    if (dot == std::string::npos || dot <= at + 1 || email.size() - dot - 1 < 2) {
+        return false;
+    }
+    for (std::size_t i = at + 1; i < dot; ++i) {
+        char c = email[i];
+        if (!is_alnum(c) && c != '.' && c != '-') {
+            return false;
+        }
+    }
+    for (std::size_t i = dot + 1; i < email.size(); ++i) {
+        if (!is_alpha(email[i])) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,170 @@
+#include "ContactTable.hpp"
+#include "ContactFields.hpp"
+#include "StoreSupport.hpp"
+#include <algorithm>
+#include <numeric>
+
+// Field is the text fields in kContactFields order; Row has one view for each
+static_assert(ContactTable::kFields == contact_fields::count_text(),
+              "ContactTable::Field out of step with kContactFields");
+static_assert(sizeof(ContactTable::Row) ==
+                  sizeof(ContactId) + contact_fields::count_text() * sizeof(std::string_view),
+              "ContactTable::Row out of step with kContactFields");
+
+ContactTable::ContactTable(const std::vector<Contact>& contacts)
+{
+    std::size_t bytes = 0;
+    for (const auto& c : contacts)
+        contact_fields::for_each_text([&](const auto& f) { bytes += f.get(c).size(); });
+    reserve(contacts.size(), bytes);
+    for (const auto& c : contacts)
+        append(c);
+}
+
+void ContactTable::reserve(std::size_t rows, std::size_t arena_bytes)
+{
+    m_ids.reserve(rows);
+    for (auto& column : m_columns) {
+        column.offsets.reserve(rows);
+        column.lengths.reserve(rows);
+    }
+    m_arena.reserve(arena_bytes);
+}
+
+void ContactTable::clear()
+{
+    m_ids.clear();
+    for (auto& column : m_columns) {
+        column.offsets.clear();
+        column.lengths.clear();
+    }
+    m_arena.clear();
+}
+
+// -----------------------------
+// Appending
+// -----------------------------
+void ContactTable::push_field(Field f, std::string_view value)
+{
+    Column& column = m_columns[static_cast<std::size_t>(f)];
+    column.offsets.push_back(m_arena.size());
+    column.lengths.push_back(static_cast<std::uint32_t>(value.size()));
+    m_arena.append(value);
+}
+
+void ContactTable::append(ContactId id,
+                          std::string_view first,
+                          std::string_view last,
+                          std::string_view email,
+                          std::string_view mobile,
+                          std::string_view updated_at)
+{
+    m_ids.push_back(id);
+    push_field(Field::first_name, first);
+    push_field(Field::last_name, last);
+    push_field(Field::email, email);
+    push_field(Field::mobile, mobile);
+    push_field(Field::updated_at, updated_at);
+}
+
+void ContactTable::append(const Contact& contact)
+{
+    append(contact.id, contact.first_name, contact.last_name, contact.email, contact.mobile, contact.updated_at);
+}
+
+void ContactTable::append(const Row& row)
+{
+    append(row.id, row.first_name, row.last_name, row.email, row.mobile, row.updated_at);
+}
+
+// -----------------------------
+// Reading
+// -----------------------------
+ContactTable::Row ContactTable::row(std::size_t row) const
+{
+    return Row{m_ids[row], first_name(row), last_name(row), email(row), mobile(row), updated_at(row)};
+}
+
+Contact ContactTable::contact(std::size_t row) const
+{
+    return Contact{m_ids[row],
+                   std::string(first_name(row)),
+                   std::string(last_name(row)),
+                   std::string(email(row)),
+                   std::string(mobile(row)),
+                   std::string(updated_at(row))};
+}
+
+std::vector<Contact> ContactTable::contacts() const
+{
+    std::vector<Contact> out;
+    out.reserve(size());
+    for (std::size_t i = 0; i < size(); ++i)
+        out.push_back(contact(i));
+    return out;
+}
+
+// -----------------------------
+// Search and order
+// -----------------------------
+std::vector<std::size_t> ContactTable::search(const std::string& query) const
+{
+    std::vector<std::size_t> rows;
+    for (std::size_t i = 0; i < size(); ++i) {
+        if (matches_search(row(i), query))
+            rows.push_back(i);
+    }
+    return rows;
+}
+
+std::vector<std::size_t> ContactTable::sorted(const std::string& column, bool ascending) const
+{
+    ContactLess less(column, ascending);
+    std::vector<std::size_t> order(size());
+    std::iota(order.begin(), order.end(), std::size_t{0});
+    if (less.column() == ContactLess::Column::id) {
+        std::sort(order.begin(), order.end(), [this, ascending](std::size_t a, std::size_t b) {
+            return ascending ? m_ids[a] < m_ids[b] : m_ids[a] > m_ids[b];
+        });
+        return order;
+    }
+
+    // Sort small self-contained keys rather than row indexes: the folded
+    // prefix settles most comparisons without touching the arena at all
+    struct Key {
+        std::uint64_t prefix;
+        std::string_view field;
+        std::string_view tie; // first name, when ordering by last name
+        ContactId id;
+        std::uint32_t row;
+    };
+    Field field = less.column() == ContactLess::Column::first_name ? Field::first_name
+                : less.column() == ContactLess::Column::email      ? Field::email
+                : less.column() == ContactLess::Column::mobile     ? Field::mobile
+                                                                   : Field::last_name;
+    bool by_name = field == Field::last_name;
+
+    std::vector<Key> keys(size());
+    for (std::size_t i = 0; i < size(); ++i) {
+        std::string_view value = this->field(i, field);
+        keys[i] = Key{folded_prefix(value), value, by_name ? first_name(i) : std::string_view{},
+                      m_ids[i], static_cast<std::uint32_t>(i)};
+    }
+
+    // Same order as ContactLess: the field, first name after last name,
+    // then id, all in the requested direction
+    std::sort(keys.begin(), keys.end(), [ascending](const Key& a, const Key& b) {
+        int cmp = (a.prefix > b.prefix) - (a.prefix < b.prefix);
+        if (cmp == 0)
+            cmp = compare_ci(a.field, b.field);
+        if (cmp == 0)
+            cmp = compare_ci(a.tie, b.tie);
+        if (cmp == 0)
+            cmp = (a.id > b.id) - (a.id < b.id);
+        return ascending ? cmp < 0 : cmp > 0;
+    });
+
+    for (std::size_t i = 0; i < keys.size(); ++i)
+        order[i] = keys[i].row;
+    return order;
+}
@@ -0,0 +1,259 @@
+#include "CsvParser.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#include <immintrin.h>
+#define CSV_HAVE_SSE2 1
+#if defined(__GNUC__)
+#define CSV_HAVE_AVX2 1
+#endif
+#endif
+
+namespace {
+
+constexpr std::size_t kBlock = 64;
+
+inline unsigned count_trailing_zeros(std::uint64_t mask)
+{
+#if defined(__GNUC__)
+    return static_cast<unsigned>(__builtin_ctzll(mask));
+#else
+    unsigned n = 0;
+    while (!(mask & 1)) { mask >>= 1; ++n; }
+    return n;
+#endif
+}
+
+inline bool is_special(char c, char delimiter)
+{
+    return c == '"' || c == delimiter || c == '\n' || c == '\r';
+}
+
+std::uint64_t scan_scalar(const char* block, char delimiter)
+{
+    std::uint64_t mask = 0;
+    for (std::size_t i = 0; i < kBlock; ++i) {
+        if (is_special(block[i], delimiter))
+            mask |= std::uint64_t{1} << i;
+    }
+    return mask;
+}
+
+#ifdef CSV_HAVE_SSE2
+std::uint64_t scan_sse2(const char* block, char delimiter)
+{
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i delim = _mm_set1_epi8(delimiter);
+    const __m128i lf = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+
+    std::uint64_t mask = 0;
+    for (int i = 0; i < 4; ++i) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i * 16));
+        __m128i hit = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, delim)),
+            _mm_or_si128(_mm_cmpeq_epi8(v, lf), _mm_cmpeq_epi8(v, cr)));
+        mask |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm_movemask_epi8(hit)) & 0xFFFFu) << (i * 16);
+    }
+    return mask;
+}
+#endif
+
+#ifdef CSV_HAVE_AVX2
+__attribute__((target("avx2")))
+std::uint64_t scan_avx2(const char* block, char delimiter)
+{
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i delim = _mm256_set1_epi8(delimiter);
+    const __m256i lf = _mm256_set1_epi8('\n');
+    const __m256i cr = _mm256_set1_epi8('\r');
+
+    std::uint64_t mask = 0;
+    for (int i = 0; i < 2; ++i) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + i * 32));
+        __m256i hit = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, delim)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, lf), _mm256_cmpeq_epi8(v, cr)));
+        mask |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(hit))) << (i * 32);
+    }
+    return mask;
+}
+#endif
+
+using ScanFn = std::uint64_t (*)(const char*, char);
+
+// CONTACTS_CSV_SCAN=scalar|sse2 forces a narrower kernel for comparison runs
+ScanFn select_scanner()
+{
+    const char* forced = std::getenv("CONTACTS_CSV_SCAN");
+    std::string_view level = forced ? forced : "";
+    if (level == "scalar")
+        return scan_scalar;
+#ifdef CSV_HAVE_AVX2
+    if (level != "sse2" && __builtin_cpu_supports("avx2"))
+        return scan_avx2;
+#endif
+#ifdef CSV_HAVE_SSE2
+    return scan_sse2;
+#else
+    return scan_scalar;
+#endif
+}
+
+const ScanFn g_scanner = select_scanner();
+
+} // namespace
+
+// -----------------------------
+// CsvField
+// -----------------------------
+std::string CsvField::str() const
+{
+    if (!has_escapes)
+        return std::string(raw);
+
+    std::string out;
+    out.reserve(raw.size());
+    for (std::size_t i = 0; i < raw.size(); ++i) {
+        out.push_back(raw[i]);
+        if (raw[i] == '"' && i + 1 < raw.size() && raw[i + 1] == '"')
+            ++i;
+    }
+    return out;
+}
+
+// -----------------------------
+// CsvReader
+// -----------------------------
+CsvReader::CsvReader(std::string_view data, char delimiter)
+: m_data(data),
+  m_delimiter(delimiter),
+  m_scan(g_scanner)
+{
+    // Skip a UTF-8 byte order mark
+    if (m_data.size() >= 3 && std::memcmp(m_data.data(), "\xEF\xBB\xBF", 3) == 0)
+        m_pos = 3;
+}
+
+const char* CsvReader::simd_level()
+{
+#ifdef CSV_HAVE_AVX2
+    if (g_scanner == scan_avx2)
+        return "avx2";
+#endif
+#ifdef CSV_HAVE_SSE2
+    if (g_scanner == scan_sse2)
+        return "sse2";
+#endif
+    return "scalar";
+}
+
+bool CsvReader::next(std::vector<CsvField>& fields)
+{
+    fields.clear();
+    const std::size_t size = m_data.size();
+    if (m_pos >= size)
+        return false;
+
+    std::size_t p = m_pos;
+    for (;;) {
+        CsvField field;
+
+        if (p < size && m_data[p] == '"') {
+            // Quoted field: runs to the next quote not followed by another one
+            std::size_t start = p + 1;
+            std::size_t q = start;
+            for (;;) {
+                q = next_quote(q);
+                if (q >= size) {
+                    // Unterminated quote: take the rest of the input
+                    field.raw = m_data.substr(start);
+                    p = size;
+                    break;
+                }
+                if (q + 1 < size && m_data[q + 1] == '"') {
+                    field.has_escapes = true;
+                    q += 2;
+                    continue;
+                }
+                field.raw = m_data.substr(start, q - start);
+                p = q + 1;
+                break;
+            }
+            // Be lenient about junk between the closing quote and the delimiter
+            while (p < size && m_data[p] != m_delimiter && m_data[p] != '\n' && m_data[p] != '\r')
+                p = next_special(p + 1);
+        } else {
+            // Unquoted field: stray quotes inside it are taken literally
+            std::size_t end = next_special(p);
+            while (end < size && m_data[end] == '"')
+                end = next_special(end + 1);
+            field.raw = m_data.substr(p, end - p);
+            p = end;
+        }
+
+        fields.push_back(field);
+
+        if (p >= size) {
+            m_pos = size;
+            return true;
+        }
+        if (m_data[p] == m_delimiter) {
+            ++p;
+            continue;
+        }
+        // Record separator: CRLF, LF or a lone CR
+        if (m_data[p] == '\r' && p + 1 < size && m_data[p + 1] == '\n')
+            p += 2;
+        else
+            ++p;
+        m_pos = p;
+        return true;
+    }
+}
+
+// -----------------------------
+// Private helpers
+// -----------------------------
+std::size_t CsvReader::next_special(std::size_t from)
+{
+    const std::size_t size = m_data.size();
+    while (from < size) {
+        std::size_t block = from & ~(kBlock - 1);
+        if (block != m_block)
+            load_block(block);
+
+        std::uint64_t mask = m_mask & (~std::uint64_t{0} << (from - block));
+        if (mask)
+            return block + count_trailing_zeros(mask);
+        from = block + kBlock;
+    }
+    return size;
+}
+
+std::size_t CsvReader::next_quote(std::size_t from)
+{
+    const std::size_t size = m_data.size();
+    std::size_t q = next_special(from);
+    while (q < size && m_data[q] != '"')
+        q = next_special(q + 1);
+    return q;
+}
+
+void CsvReader::load_block(std::size_t block)
+{
+    m_block = block;
+    if (block + kBlock <= m_data.size()) {
+        m_mask = m_scan(m_data.data() + block, m_delimiter);
+        return;
+    }
+
+    // Final partial block: scan a zero-padded copy so loads stay in bounds
+    char tail[kBlock] = {};
+    std::memcpy(tail, m_data.data() + block, m_data.size() - block);
+    m_mask = m_scan(tail, m_delimiter);
+    if (m_delimiter == '\0')
+        m_mask &= (std::uint64_t{1} << (m_data.size() - block)) - 1;
+}
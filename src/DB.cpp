@@ -1,7 +1,161 @@
 #include "DB.hpp"
+#include "ContactFields.hpp"
+#include "ContactTable.hpp"
+#include "StoreSupport.hpp"
 #include <iostream>
-#include <regex>
 #include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <string_view>
+
+namespace {
+
+using namespace contact_fields;
+
+// Statement texts, generated from kContactFields at compile time
+constexpr char kWhereId[] = " WHERE id=?";
+constexpr char kWhereIdIfChanged[] = " WHERE id=? AND CAST(updated_at AS CHAR) <> ?";
+constexpr char kByName[] = " ORDER BY last_name, first_name, id";
+constexpr char kIdRange[] = " WHERE id BETWEEN ? AND ? ORDER BY id";
+constexpr char kUpdatedSince[] = " WHERE updated_at >= ?";
+constexpr char kPage[] = " ORDER BY last_name, first_name, id LIMIT ? OFFSET ?";
+// Rows past (last_name, first_name, id); the leading bound makes it a range of idx_list
+constexpr char kPageAfter[] = " WHERE last_name >= ? AND (last_name > ? OR (last_name = ? AND "
+                              "(first_name > ? OR (first_name = ? AND id > ?)))) "
+                              "ORDER BY last_name, first_name, id LIMIT ?";
+constexpr char kByDomain[] = " WHERE email_domain = ? ORDER BY last_name, first_name, id";
+// Rows with no search_key, or one with multi-byte characters that an older
+// version may have folded as Latin only
+constexpr char kUnkeyed[] = " WHERE id > ? AND (search_key IS NULL OR "
+                            "LENGTH(search_key) <> CHAR_LENGTH(search_key)) ORDER BY id LIMIT ?";
+constexpr char kNoTail[] = "";
+
+// maintenance_tasks row written once a pass has keyed every row
+constexpr char kSearchKeyBackfill[] = "search_key_backfill";
+
+// Writes also store the row's search_key (see bind_row)
+constexpr auto insert_contact_sql = [](TextWriter& out) {
+    out << "INSERT INTO contacts (";
+    list<editable>(out, "", "", ",");
+    out << ",search_key) VALUES (";
+    placeholders<editable>(out, ",");
+    out << ",?)";
+};
+
+constexpr auto update_contact_sql = [](TextWriter& out) {
+    out << "UPDATE contacts SET ";
+    list<editable>(out, "", "=?", ", ");
+    out << ", search_key=? WHERE id=?";
+};
+
+// Substring match used by searches: one binary LIKE on the folded
+// search_key, or on each field for rows not keyed yet. Bind with
+// bind_search.
+constexpr auto search_predicate = [](TextWriter& out) {
+    out << "(search_key LIKE ? OR (search_key IS NULL AND (";
+    list<searchable>(out, "", " LIKE ?", " OR ");
+    out << ")))";
+};
+constexpr int kSearchPlaceholders = static_cast<int>(count<searchable>());
+
+constexpr auto search_sql = [](TextWriter& out) {
+    select_contacts<kNoTail>(out);
+    out << " WHERE ";
+    search_predicate(out);
+    out << kByName;
+};
+
+// Decode a row selected with every column of kContactFields
+Contact read_contact(sql::ResultSet& res)
+{
+    Contact contact{};
+    decode(res, contact);
+    return contact;
+}
+
+// As read_contact, into the table's arena. scratch keeps its capacity from
+// row to row, so decoding allocates nothing once it has warmed up.
+void read_contact(sql::ResultSet& res, ContactTable& out, Contact& scratch)
+{
+    decode(res, scratch);
+    out.append(scratch);
+}
+
+// As read_contact, into a contact whose strings live in a caller's resource
+void read_contact(sql::ResultSet& res, PmrContact& out)
+{
+    decode(res, out);
+}
+
+void bind_search(sql::PreparedStatement& stmt, const std::string& query)
+{
+    stmt.setString(1, "%" + fold_search(query) + "%");
+    std::string search_pattern = "%" + query + "%";
+    for (int i = 2; i <= kSearchPlaceholders + 1; ++i)
+        stmt.setString(i, search_pattern);
+}
+
+// Binds row's editable fields, then its search_key; returns the next
+// placeholder
+int bind_row(sql::PreparedStatement& stmt, const Contact& row)
+{
+    int next = bind_editable(stmt, row);
+    stmt.setString(next, search_key(row));
+    return next + 1;
+}
+
+// The row as stored, updated_at included; writers call it inside their
+// transaction so it reads back exactly what they wrote
+std::optional<Contact> read_stored(sql::Connection& conn, ContactId id)
+{
+    auto stmt = std::unique_ptr<sql::PreparedStatement>(
+        conn.prepareStatement(sql_text<select_contacts<kWhereId>>.c_str())
+    );
+    stmt->setUInt64(1, id);
+    auto res = std::unique_ptr<sql::ResultSet>(stmt->executeQuery());
+    if (!res->next())
+        return std::nullopt;
+    return read_contact(*res);
+}
+
+// The list view's page: by name, with id breaking ties so consecutive pages
+// never overlap or skip rows. limit 0 means "to the end".
+std::unique_ptr<sql::PreparedStatement> prepare_page(sql::Connection& conn, std::size_t offset, std::size_t limit)
+{
+    auto stmt = std::unique_ptr<sql::PreparedStatement>(
+        conn.prepareStatement(sql_text<select_contacts<kPage>>.c_str())
+    );
+    stmt->setUInt64(1, limit == 0 ? UINT64_MAX : static_cast<uint64_t>(limit));
+    stmt->setUInt64(2, static_cast<uint64_t>(offset));
+    return stmt;
+}
+
+// Contacts at one email domain, in list order: a range of idx_email_domain
+std::unique_ptr<sql::PreparedStatement> prepare_domain(sql::Connection& conn, std::string_view domain)
+{
+    auto stmt = std::unique_ptr<sql::PreparedStatement>(
+        conn.prepareStatement(sql_text<select_contacts<kByDomain>>.c_str())
+    );
+    stmt->setString(1, std::string(domain));
+    return stmt;
+}
+
+// The search box's query, in list order. A domain facet ("@example.com")
+// is looked up by email_domain rather than matched as a substring.
+std::unique_ptr<sql::PreparedStatement> prepare_search(sql::Connection& conn, const std::string& query)
+{
+    std::string_view domain = domain_facet(query);
+    if (!domain.empty())
+        return prepare_domain(conn, domain);
+
+    auto stmt = std::unique_ptr<sql::PreparedStatement>(
+        conn.prepareStatement(sql_text<search_sql>.c_str())
+    );
+    bind_search(*stmt, query);
+    return stmt;
+}
+
+} // namespace
 
 // -----------------------------
 // Constructor
@@ -10,7 +164,9 @@ DB::DB(const std::string& host,
        const std::string& user,
        const std::string& password,
        const std::string& db_name,
-       unsigned int port)
+       unsigned int port,
+       const ConnectionTimeouts& timeouts)
+: settings_{host, port, user, password, db_name, timeouts}
 {
     try {
         // Build connection string
@@ -19,6 +175,8 @@ DB::DB(const std::string& host,
         sql::Properties connection_properties;
         connection_properties["user"] = user;
         connection_properties["password"] = password;
+        connection_properties["connectTimeout"] = std::to_string(timeouts.connect_ms);
+        connection_properties["socketTimeout"] = std::to_string(timeouts.read_ms);
 
         conn_ = std::shared_ptr<sql::Connection>(
             sql::mariadb::get_driver_instance()->connect(conn_string, connection_properties)
@@ -35,11 +193,27 @@ DB::DB(const std::string& host,
     }
 }
 
+DB::DB(const ConnectionSettings& settings)
+: DB(settings.host, settings.user, settings.password, settings.database,
+     settings.port, settings.timeouts)
+{
+}
+
+// -----------------------------
+// Clone
+// -----------------------------
+std::unique_ptr<ContactStore> DB::clone() const
+{
+    return std::make_unique<DB>(settings_);
+}
+
 // -----------------------------
 // Test connection
 // -----------------------------
 bool DB::test_connection()
 {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
     try {
         ensure_connection();
         auto stmt = std::unique_ptr<sql::PreparedStatement>(
@@ -53,43 +227,356 @@ bool DB::test_connection()
     }
 }
 
+// -----------------------------
+// Schema migrations
+// -----------------------------
+namespace {
+
+// Each entry moves the schema from version - 1 to version. Append new steps
+// at the end; never edit one that has shipped.
+struct Migration {
+    int version;
+    const char* description;
+    std::vector<const char*> statements;
+};
+
+const std::vector<Migration>& migrations()
+{
+    static const std::vector<Migration> steps = {
+        {1, "Create contacts table", {
+            "CREATE TABLE IF NOT EXISTS contacts ("
+            "id INT AUTO_INCREMENT PRIMARY KEY, "
+            "first_name VARCHAR(100), "
+            "last_name VARCHAR(100), "
+            "email VARCHAR(255), "
+            "mobile VARCHAR(50), "
+            "created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
+            "updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP ON UPDATE CURRENT_TIMESTAMP, "
+            "INDEX idx_name (first_name, last_name), "
+            "INDEX idx_email (email)"
+            ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4"
+        }},
+        {2, "Journal committed import batches", {
+            "CREATE TABLE IF NOT EXISTS import_batches ("
+            "job_key CHAR(16) NOT NULL, "
+            "start_offset BIGINT UNSIGNED NOT NULL, "
+            "end_offset BIGINT UNSIGNED NOT NULL, "
+            "batch_no BIGINT UNSIGNED NOT NULL, "
+            "row_count INT UNSIGNED NOT NULL, "
+            "committed_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
+            "PRIMARY KEY (job_key, start_offset)"
+            ") ENGINE=InnoDB"
+        }},
+        {3, "Index updated_at for incremental sync", {
+            "CREATE INDEX idx_updated_at ON contacts (updated_at)"
+        }},
+        // Changing the key's type rebuilds the table. LOCK=SHARED keeps it
+        // readable meanwhile; writers wait for the copy to finish. Every
+        // secondary index grows by 4 bytes per row for the wider key.
+        {4, "Widen contact ids to BIGINT UNSIGNED", {
+            "ALTER TABLE contacts "
+            "MODIFY id BIGINT UNSIGNED NOT NULL AUTO_INCREMENT, "
+            "ALGORITHM=COPY, LOCK=SHARED"
+        }},
+        // The list is ordered by last name, then first name, then id, which
+        // idx_name (first_name, last_name) could not serve. idx_list holds
+        // every selected column in that order, so the list and its pages
+        // are an index walk with no filesort and no row lookups; sorting by
+        // first name uses idx_first_name, which InnoDB extends with the id.
+        {5, "Cover the list order with idx_list", {
+            "ALTER TABLE contacts "
+            "ADD INDEX idx_list (last_name, first_name, id, email, mobile, updated_at), "
+            "ADD INDEX idx_first_name (first_name), "
+            "DROP INDEX idx_name, "
+            "ALGORITHM=INPLACE, LOCK=NONE"
+        }},
+        // Searches test one folded, binary-collated column instead of four
+        // case-insensitive ones. Writers keep it current; NULL marks rows
+        // written before it existed, which backfill_search_keys() fills in
+        // and which searches match field by field meanwhile.
+        {6, "Keep a folded search_key on each contact", {
+            "ALTER TABLE contacts "
+            "ADD COLUMN search_key VARCHAR(1024) CHARACTER SET utf8mb4 COLLATE utf8mb4_bin NULL, "
+            "LOCK=NONE"
+        }},
+        // "All contacts at example.com" was email LIKE '%@example.com', a
+        // scan idx_email cannot serve. The server derives email_domain from
+        // email on every write, so no client can let it go stale, and
+        // idx_email_domain makes a domain an index range already in list
+        // order. Adding a stored column rebuilds the table, as version 4 did.
+        {7, "Index contacts by email domain", {
+            "ALTER TABLE contacts "
+            "ADD COLUMN email_domain VARCHAR(255) AS "
+            "(LOWER(IF(LOCATE('@', email) > 0, SUBSTRING_INDEX(email, '@', -1), NULL))) STORED, "
+            "ADD INDEX idx_email_domain (email_domain, last_name, first_name, id), "
+            "ALGORITHM=COPY, LOCK=SHARED"
+        }},
+        // One row per finished one-off task, such as the search_key
+        // backfill, so it is not started again on every launch
+        {8, "Record finished maintenance tasks", {
+            "CREATE TABLE IF NOT EXISTS maintenance_tasks ("
+            "name VARCHAR(64) NOT NULL PRIMARY KEY, "
+            "finished_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP"
+            ") ENGINE=InnoDB"
+        }},
+        // Keys used to fold case for Latin letters only. Clearing the
+        // marker runs the backfill again, which re-keys every key with a
+        // multi-byte character in id-ordered batches rather than one
+        // table-wide UPDATE. Until it reaches a row, searches match that
+        // row by its old key.
+        {9, "Re-key search_key with full case folding", {
+            "DELETE FROM maintenance_tasks WHERE name = 'search_key_backfill'"
+        }},
+        // At one-second resolution a second edit within the same second
+        // left updated_at as it was, so get_contact_if_changed saw no
+        // change and the editor opened on stale data. Microseconds match
+        // what the in-process stores write. Changing the column's type
+        // rebuilds the table, as version 4 did.
+        {10, "Store updated_at to the microsecond", {
+            "ALTER TABLE contacts "
+            "MODIFY updated_at TIMESTAMP(6) DEFAULT CURRENT_TIMESTAMP(6) ON UPDATE CURRENT_TIMESTAMP(6), "
+            "ALGORITHM=COPY, LOCK=SHARED"
+        }},
+        // Sorting by mobile had no index to walk, so the server sorted the
+        // whole table before the first row came back. InnoDB extends the
+        // index with the id, which covers the tie-break in either direction.
+        {11, "Index mobile for sorting", {
+            "ALTER TABLE contacts ADD INDEX idx_mobile (mobile), ALGORITHM=INPLACE, LOCK=NONE"
+        }},
+    };
+    return steps;
+}
+
+constexpr int kErrNoSuchTable = 1146;
+constexpr int kPlanCheckMinRows = 10000;
+constexpr int kErrDuplicateKey = 1062;
+
+} // namespace
+
+int DB::latest_schema_version()
+{
+    return migrations().back().version;
+}
+
+int DB::schema_version() const
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+    try {
+        ensure_connection();
+        auto stmt = std::unique_ptr<sql::PreparedStatement>(
+            conn_->prepareStatement("SELECT COALESCE(MAX(version), 0) FROM schema_version")
+        );
+        auto res = std::unique_ptr<sql::ResultSet>(stmt->executeQuery());
+        return res->next() ? res->getInt(1) : 0;
+    }
+    catch (const sql::SQLException& e) {
+        if (e.getErrorCode() == kErrNoSuchTable) {
+            return 0;
+        }
+        throw DBException("Schema version error: " + std::string(e.what()));
+    }
+}
+
+// -----------------------------
+// Query plans
+// -----------------------------
+std::vector<std::string> DB::check_query_plans() const
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+    std::vector<std::string> problems;
+    try {
+        ensure_connection();
+
+        // covering: the plan must also read nothing outside the index
+        auto explain = [&](const std::string& name, sql::PreparedStatement& stmt,
+                           const std::string& index = "idx_list", bool covering = true) {
+            auto res = std::unique_ptr<sql::ResultSet>(stmt.executeQuery());
+            auto column = [&res](const char* name) {
+                sql::SQLString value = res->getString(name);
+                return std::string(value.c_str(), value.length());
+            };
+            while (res->next()) {
+                std::string key = column("key");
+                std::string extra = column("Extra");
+                if (key != index)
+                    problems.push_back(name + ": uses " + (key.empty() ? std::string("a table scan") : key));
+                if (extra.find("filesort") != std::string::npos)
+                    problems.push_back(name + ": sorts with a filesort");
+                if (covering && extra.find("Using index") == std::string::npos)
+                    problems.push_back(name + ": reads rows outside " + index);
+            }
+        };
+
+        auto list = std::unique_ptr<sql::PreparedStatement>(conn_->prepareStatement(
+            std::string("EXPLAIN ") + sql_text<select_contacts<kByName>>.c_str()));
+        explain("list", *list);
+
+        // The statement prepare_page runs, for a page in the middle
+        auto page = std::unique_ptr<sql::PreparedStatement>(conn_->prepareStatement(
+            std::string("EXPLAIN ") + sql_text<select_contacts<kPage>>.c_str()));
+        page->setUInt64(1, 200);
+        page->setUInt64(2, 10000);
+        explain("page", *page);
+
+        // The statement the window reads the rest of the list with
+        auto after = std::unique_ptr<sql::PreparedStatement>(conn_->prepareStatement(
+            std::string("EXPLAIN ") + sql_text<select_contacts<kPageAfter>>.c_str()));
+        for (int i = 1; i <= 5; ++i)
+            after->setString(i, "M");
+        after->setUInt64(6, 0);
+        after->setUInt64(7, UINT64_MAX);
+        explain("page after a row", *after);
+
+        // Every column header's sort, both ways: an index walk, forwards or
+        // backwards, so the first rows stream back at once
+        struct SortPlan {
+            const char* column;
+            const char* index;
+        };
+        static constexpr SortPlan kSorts[] = {
+            {"last_name", "idx_list"},
+            {"first_name", "idx_first_name"},
+            {"email", "idx_email"},
+            {"mobile", "idx_mobile"},
+        };
+        for (const auto& sort : kSorts) {
+            for (bool ascending : {true, false}) {
+                auto sorted = std::unique_ptr<sql::PreparedStatement>(conn_->prepareStatement(
+                    std::string("EXPLAIN ") + sql_text<select_contacts<kNoTail>>.c_str() +
+                    " ORDER BY " + order_by_clause(sort.column, ascending)));
+                explain(std::string("sort by ") + sort.column + (ascending ? "" : " descending"),
+                        *sorted, sort.index, sort.index == std::string_view("idx_list"));
+            }
+        }
+
+        auto domain = std::unique_ptr<sql::PreparedStatement>(conn_->prepareStatement(
+            std::string("EXPLAIN ") + sql_text<select_contacts<kByDomain>>.c_str()));
+        domain->setString(1, "example.com");
+        explain("email domain", *domain, "idx_email_domain", false);
+    }
+    catch (const sql::SQLException& e) {
+        throw DBException("Query plan error: " + std::string(e.what()));
+    }
+    return problems;
+}
+
 // -----------------------------
 // Initialize schema
 // -----------------------------
 void DB::initialize_schema()
 {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+    // CONTACTS_CHECK_PLANS=1 checks the query plans on every start, on a
+    // table of any size, rather than only after migrating a large one
+    const char* check_plans = std::getenv("CONTACTS_CHECK_PLANS");
+    const bool always_check_plans = check_plans && std::string(check_plans) == "1";
+
+    // Fast path: one indexed read, no DDL and no metadata locks
+    if (schema_version() >= latest_schema_version()) {
+        if (always_check_plans)
+            log_query_plans(true);
+        return;
+    }
+
     try {
-        auto stmt = std::unique_ptr<sql::PreparedStatement>(
-            conn_->prepareStatement(
-                "CREATE TABLE IF NOT EXISTS contacts ("
-                "id INT AUTO_INCREMENT PRIMARY KEY, "
-                "first_name VARCHAR(100), "
-                "last_name VARCHAR(100), "
-                "email VARCHAR(255), "
-                "mobile VARCHAR(50), "
-                "created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
-                "updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP ON UPDATE CURRENT_TIMESTAMP, "
-                "INDEX idx_name (first_name, last_name), "
-                "INDEX idx_email (email)"
-                ")"
-            )
+        // Serialise migrations between clients starting at the same time
+        auto get_lock = std::unique_ptr<sql::PreparedStatement>(
+            conn_->prepareStatement("SELECT GET_LOCK('contacts_schema_migration', 30)")
         );
-        stmt->execute();
+        auto lock_res = std::unique_ptr<sql::ResultSet>(get_lock->executeQuery());
+        if (!lock_res->next() || lock_res->getInt(1) != 1) {
+            throw DBException("Schema initialization error: timed out waiting for migration lock");
+        }
+
+        auto release = [this]() {
+            auto stmt = std::unique_ptr<sql::PreparedStatement>(
+                conn_->prepareStatement("SELECT RELEASE_LOCK('contacts_schema_migration')")
+            );
+            stmt->executeQuery();
+        };
+
+        try {
+            auto create = std::unique_ptr<sql::Statement>(conn_->createStatement());
+            create->execute(
+                "CREATE TABLE IF NOT EXISTS schema_version ("
+                "version INT PRIMARY KEY, "
+                "description VARCHAR(255), "
+                "applied_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP"
+                ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4"
+            );
+
+            // Re-read under the lock; another client may have migrated already
+            int current = schema_version();
+            for (const auto& step : migrations()) {
+                if (step.version <= current) {
+                    continue;
+                }
+                for (const char* sql_text : step.statements) {
+                    create->execute(sql_text);
+                }
+                auto record = std::unique_ptr<sql::PreparedStatement>(
+                    conn_->prepareStatement(
+                        "INSERT INTO schema_version (version, description) VALUES (?, ?)"
+                    )
+                );
+                record->setInt(1, step.version);
+                record->setString(2, step.description);
+                record->executeUpdate();
+                std::cout << "Applied schema migration " << step.version
+                          << ": " << step.description << "\n";
+            }
+        }
+        catch (...) {
+            release();
+            throw;
+        }
+        release();
         std::cout << "Database schema initialized\n";
+        log_query_plans(always_check_plans);
     }
     catch (const sql::SQLException& e) {
         throw DBException("Schema initialization error: " + std::string(e.what()));
     }
 }
 
+void DB::log_query_plans(bool any_size) const
+{
+    // Advisory, so a surprising plan is logged rather than fatal. On a
+    // small table the optimizer rightly prefers a scan and sort; the
+    // probe finds out cheaply whether the table is past that size.
+    try {
+        if (!any_size) {
+            auto probe = std::unique_ptr<sql::Statement>(conn_->createStatement());
+            auto res = std::unique_ptr<sql::ResultSet>(probe->executeQuery(
+                "SELECT 1 FROM contacts LIMIT 1 OFFSET " + std::to_string(kPlanCheckMinRows - 1)));
+            if (!res->next())
+                return;
+        }
+        for (const auto& problem : check_query_plans()) {
+            std::cerr << "Query plan: " << problem << "\n";
+        }
+    }
+    catch (const sql::SQLException& e) {
+        std::cerr << "Query plan error: " << e.what() << "\n";
+    }
+    catch (const DBException& e) {
+        std::cerr << e.what() << "\n";
+    }
+}
+
 // -----------------------------
 // Insert contact
 // -----------------------------
-void DB::insert_contact(const std::string& first,
-                        const std::string& last,
-                        const std::string& email,
-                        const std::string& mobile)
+Contact DB::insert_contact(const std::string& first,
+                           const std::string& last,
+                           const std::string& email,
+                           const std::string& mobile)
 {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
     if (first.empty() && last.empty()) {
         throw DBException("At least first name or last name must be provided");
     }
@@ -100,21 +587,37 @@ void DB::insert_contact(const std::string& first,
     
     try {
         ensure_connection();
+        // One transaction, so the row read back is the one just written
+        conn_->setAutoCommit(false);
         auto stmt = std::unique_ptr<sql::PreparedStatement>(
-            conn_->prepareStatement(
-                "INSERT INTO contacts (first_name,last_name,email,mobile) VALUES (?,?,?,?)"
-            )
+            conn_->prepareStatement(sql_text<insert_contact_sql>.c_str())
         );
 
-        stmt->setString(1, first);
-        stmt->setString(2, last);
-        stmt->setString(3, email);
-        stmt->setString(4, mobile);
-
+        Contact saved{0, first, last, email, mobile};
+        bind_row(*stmt, saved);
         stmt->executeUpdate();
+
+        // LAST_INSERT_ID() is per-connection, so this is our row's id
+        auto id_stmt = std::unique_ptr<sql::PreparedStatement>(
+            conn_->prepareStatement("SELECT LAST_INSERT_ID()")
+        );
+        auto res = std::unique_ptr<sql::ResultSet>(id_stmt->executeQuery());
+        std::optional<Contact> stored;
+        if (res->next()) {
+            stored = read_stored(*conn_, res->getUInt64(1));
+        }
+        if (!stored) {
+            rollback_quietly();
+            throw DBException("Insert error: could not read back the new contact");
+        }
+
+        conn_->commit();
+        conn_->setAutoCommit(true);
         std::cout << "Inserted contact: " << first << " " << last << "\n";
+        return *stored;
     }
     catch (const sql::SQLException& e) {
+        rollback_quietly();
         throw DBException("Insert error: " + std::string(e.what()));
     }
 }
@@ -122,12 +625,14 @@ void DB::insert_contact(const std::string& first,
 // -----------------------------
 // Update contact
 // -----------------------------
-void DB::update_contact(int id,
-                        const std::string& first,
-                        const std::string& last,
-                        const std::string& email,
-                        const std::string& mobile)
+Contact DB::update_contact(ContactId id,
+                           const std::string& first,
+                           const std::string& last,
+                           const std::string& email,
+                           const std::string& mobile)
 {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
     if (first.empty() && last.empty()) {
         throw DBException("At least first name or last name must be provided");
     }
@@ -138,25 +643,29 @@ void DB::update_contact(int id,
     
     try {
         ensure_connection();
+        // One transaction, so the row read back is the one just written
+        conn_->setAutoCommit(false);
         auto stmt = std::unique_ptr<sql::PreparedStatement>(
-            conn_->prepareStatement(
-                "UPDATE contacts SET first_name=?, last_name=?, email=?, mobile=? WHERE id=?"
-            )
+            conn_->prepareStatement(sql_text<update_contact_sql>.c_str())
         );
 
-        stmt->setString(1, first);
-        stmt->setString(2, last);
-        stmt->setString(3, email);
-        stmt->setString(4, mobile);
-        stmt->setInt(5, id);
+        Contact saved{id, first, last, email, mobile};
+        stmt->setUInt64(bind_row(*stmt, saved), id);
 
-        int rows = stmt->executeUpdate();
-        if (rows == 0) {
+        stmt->executeUpdate();
+        std::optional<Contact> stored = read_stored(*conn_, id);
+        if (!stored) {
+            rollback_quietly();
             throw DBException("Contact not found with ID: " + std::to_string(id));
         }
+
+        conn_->commit();
+        conn_->setAutoCommit(true);
         std::cout << "Updated contact ID: " << id << "\n";
+        return *stored;
     }
     catch (const sql::SQLException& e) {
+        rollback_quietly();
         throw DBException("Update error: " + std::string(e.what()));
     }
 }
@@ -164,15 +673,17 @@ void DB::update_contact(int id,
 // -----------------------------
 // Delete contact
 // -----------------------------
-void DB::delete_contact(int id)
+void DB::delete_contact(ContactId id)
 {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
     try {
         ensure_connection();
         auto stmt = std::unique_ptr<sql::PreparedStatement>(
             conn_->prepareStatement("DELETE FROM contacts WHERE id=?")
         );
 
-        stmt->setInt(1, id);
+        stmt->setUInt64(1, id);
         int rows = stmt->executeUpdate();
         if (rows == 0) {
             throw DBException("Contact not found with ID: " + std::to_string(id));
@@ -187,27 +698,47 @@ void DB::delete_contact(int id)
 // -----------------------------
 // Get contact by ID
 // -----------------------------
-std::optional<Contact> DB::get_contact_by_id(int id)
+std::optional<Contact> DB::get_contact_by_id(ContactId id)
 {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
     try {
         ensure_connection();
         auto stmt = std::unique_ptr<sql::PreparedStatement>(
-            conn_->prepareStatement(
-                "SELECT id, first_name, last_name, email, mobile FROM contacts WHERE id=?"
-            )
+            conn_->prepareStatement(sql_text<select_contacts<kWhereId>>.c_str())
         );
-        stmt->setInt(1, id);
+        stmt->setUInt64(1, id);
 
         auto res = std::unique_ptr<sql::ResultSet>(stmt->executeQuery());
         if (res->next()) {
-            Contact c{
-                res->getInt("id"),
-                res->getString("first_name").c_str(),
-                res->getString("last_name").c_str(),
-                res->getString("email").c_str(),
-                res->getString("mobile").c_str()
-            };
-            return c;
+            return read_contact(*res);
+        }
+    }
+    catch (const sql::SQLException& e) {
+        std::cerr << "Query error: " << e.what() << "\n";
+    }
+    return std::nullopt;
+}
+
+// -----------------------------
+// Get contact if changed
+// -----------------------------
+std::optional<Contact> DB::get_contact_if_changed(ContactId id, const std::string& known_updated_at)
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+    try {
+        ensure_connection();
+        // One round trip: the row only comes back if its timestamp moved
+        auto stmt = std::unique_ptr<sql::PreparedStatement>(
+            conn_->prepareStatement(sql_text<select_contacts<kWhereIdIfChanged>>.c_str())
+        );
+        stmt->setUInt64(1, id);
+        stmt->setString(2, known_updated_at);
+
+        auto res = std::unique_ptr<sql::ResultSet>(stmt->executeQuery());
+        if (res->next()) {
+            return read_contact(*res);
         }
     }
     catch (const sql::SQLException& e) {
@@ -221,29 +752,356 @@ std::optional<Contact> DB::get_contact_by_id(int id)
 // -----------------------------
 std::vector<Contact> DB::get_all_contacts() const
 {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
     std::vector<Contact> contacts;
     try {
         ensure_connection();
         auto stmt = std::unique_ptr<sql::PreparedStatement>(
-            conn_->prepareStatement(
-                "SELECT id, first_name, last_name, email, mobile FROM contacts ORDER BY last_name, first_name"
-            )
+            conn_->prepareStatement(sql_text<select_contacts<kByName>>.c_str())
+        );
+
+        auto res = std::unique_ptr<sql::ResultSet>(stmt->executeQuery());
+        while (res->next()) {
+            contacts.push_back(read_contact(*res));
+        }
+    }
+    catch (const sql::SQLException& e) {
+        std::cerr << "Query error: " << e.what() << "\n";
+    }
+    return contacts;
+}
+
+// -----------------------------
+// Stream contacts
+// -----------------------------
+std::size_t DB::stream_contacts(const IdRange& ids,
+                                const std::function<bool(const Contact&)>& visit,
+                                std::size_t fetch_size) const
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+    std::size_t visited = 0;
+    try {
+        ensure_connection();
+        // Primary key order is an index walk, so the first row arrives
+        // at once instead of after a server-side sort of the whole table
+        auto stmt = std::unique_ptr<sql::PreparedStatement>(
+            conn_->prepareStatement(sql_text<select_contacts<kIdRange>>.c_str())
         );
+        stmt->setUInt64(1, ids.first);
+        stmt->setUInt64(2, ids.last);
+        // A fetch size makes the connector read the result a window at a
+        // time instead of buffering all of it on the client
+        stmt->setFetchSize(static_cast<int32_t>(std::max<std::size_t>(1, fetch_size)));
+
+        auto res = std::unique_ptr<sql::ResultSet>(stmt->executeQuery());
+        while (res->next()) {
+            ++visited;
+            if (!visit(read_contact(*res)))
+                break;
+        }
+    }
+    catch (const sql::SQLException& e) {
+        throw DBException("Export error: " + std::string(e.what()));
+    }
+    return visited;
+}
+
+std::size_t DB::stream_contacts(const ContactQuery& query,
+                                const std::function<bool(const Contact&)>& visit,
+                                std::size_t fetch_size) const
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+    std::size_t visited = 0;
+    try {
+        ensure_connection();
+        std::string_view domain = domain_facet(query.search);
+        std::string text = sql_text<select_contacts<kNoTail>>.c_str();
+        if (!domain.empty())
+            text += " WHERE email_domain = ?";
+        else if (!query.search.empty())
+            text += std::string(" WHERE ") + sql_text<search_predicate>.c_str();
+        text += " ORDER BY " + order_by_clause(query.sort_column, query.ascending);
+
+        auto stmt = std::unique_ptr<sql::PreparedStatement>(conn_->prepareStatement(text));
+        if (!domain.empty())
+            stmt->setString(1, std::string(domain));
+        else if (!query.search.empty())
+            bind_search(*stmt, query.search);
+        stmt->setFetchSize(static_cast<int32_t>(std::max<std::size_t>(1, fetch_size)));
 
         auto res = std::unique_ptr<sql::ResultSet>(stmt->executeQuery());
         while (res->next()) {
-            contacts.push_back(Contact{
-                res->getInt("id"),
-                res->getString("first_name").c_str(),
-                res->getString("last_name").c_str(),
-                res->getString("email").c_str(),
-                res->getString("mobile").c_str()
-            });
+            ++visited;
+            if (!visit(read_contact(*res)))
+                break;
+        }
+    }
+    catch (const sql::SQLException& e) {
+        throw DBException("Export error: " + std::string(e.what()));
+    }
+    return visited;
+}
+
+std::optional<IdRange> DB::get_id_bounds() const
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+    try {
+        ensure_connection();
+        auto stmt = std::unique_ptr<sql::PreparedStatement>(
+            conn_->prepareStatement("SELECT MIN(id) AS first_id, MAX(id) AS last_id FROM contacts")
+        );
+        auto res = std::unique_ptr<sql::ResultSet>(stmt->executeQuery());
+        if (res->next() && !res->isNull(1)) {
+            return IdRange{res->getUInt64("first_id"), res->getUInt64("last_id")};
         }
     }
     catch (const sql::SQLException& e) {
         std::cerr << "Query error: " << e.what() << "\n";
     }
+    return std::nullopt;
+}
+
+// -----------------------------
+// Incremental sync
+// -----------------------------
+std::vector<Contact> DB::get_contacts_updated_since(const std::string& since) const
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+    std::vector<Contact> contacts;
+    try {
+        ensure_connection();
+        // A range scan of idx_updated_at, so only the changed rows are read
+        auto stmt = std::unique_ptr<sql::PreparedStatement>(
+            conn_->prepareStatement(sql_text<select_contacts<kUpdatedSince>>.c_str())
+        );
+        stmt->setString(1, since);
+
+        auto res = std::unique_ptr<sql::ResultSet>(stmt->executeQuery());
+        while (res->next()) {
+            contacts.push_back(read_contact(*res));
+        }
+    }
+    catch (const sql::SQLException& e) {
+        throw DBException("Sync error: " + std::string(e.what()));
+    }
+    return contacts;
+}
+
+std::vector<ContactId> DB::get_contact_ids() const
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+    std::vector<ContactId> ids;
+    try {
+        ensure_connection();
+        auto stmt = std::unique_ptr<sql::PreparedStatement>(
+            conn_->prepareStatement("SELECT id FROM contacts ORDER BY id")
+        );
+        stmt->setFetchSize(4096);
+
+        auto res = std::unique_ptr<sql::ResultSet>(stmt->executeQuery());
+        while (res->next()) {
+            ids.push_back(res->getUInt64(1));
+        }
+    }
+    catch (const sql::SQLException& e) {
+        throw DBException("Sync error: " + std::string(e.what()));
+    }
+    return ids;
+}
+
+std::vector<Contact> DB::get_contacts_by_ids(const std::vector<ContactId>& ids) const
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+    // Primary key lookups, a bounded number of ids per statement
+    constexpr std::size_t kIdsPerQuery = 500;
+    std::vector<ContactId> sorted(ids);
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    std::vector<Contact> contacts;
+    try {
+        ensure_connection();
+        for (std::size_t first = 0; first < sorted.size(); first += kIdsPerQuery) {
+            std::size_t count = std::min(kIdsPerQuery, sorted.size() - first);
+            std::string text = std::string(sql_text<select_contacts<kNoTail>>.c_str()) + " WHERE id IN (?";
+            for (std::size_t i = 1; i < count; ++i)
+                text += ",?";
+            text += ") ORDER BY id";
+
+            auto stmt = std::unique_ptr<sql::PreparedStatement>(conn_->prepareStatement(text));
+            for (std::size_t i = 0; i < count; ++i)
+                stmt->setUInt64(static_cast<int32_t>(i + 1), sorted[first + i]);
+            auto res = std::unique_ptr<sql::ResultSet>(stmt->executeQuery());
+            while (res->next()) {
+                contacts.push_back(read_contact(*res));
+            }
+        }
+    }
+    catch (const sql::SQLException& e) {
+        throw DBException("Sync error: " + std::string(e.what()));
+    }
+    return contacts;
+}
+
+// -----------------------------
+// Snapshots
+// -----------------------------
+bool DB::lock_contacts_for_read()
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+    try {
+        ensure_connection();
+        auto stmt = std::unique_ptr<sql::Statement>(conn_->createStatement());
+        stmt->execute("LOCK TABLES contacts READ");
+        return true;
+    }
+    catch (const sql::SQLException& e) {
+        std::cerr << "Lock error: " << e.what() << "\n";
+        return false;
+    }
+}
+
+void DB::unlock_tables()
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+    try {
+        ensure_connection();
+        auto stmt = std::unique_ptr<sql::Statement>(conn_->createStatement());
+        stmt->execute("UNLOCK TABLES");
+    }
+    catch (const sql::SQLException& e) {
+        std::cerr << "Unlock error: " << e.what() << "\n";
+    }
+}
+
+void DB::begin_snapshot()
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+    try {
+        ensure_connection();
+        auto stmt = std::unique_ptr<sql::Statement>(conn_->createStatement());
+        stmt->execute("START TRANSACTION WITH CONSISTENT SNAPSHOT, READ ONLY");
+    }
+    catch (const sql::SQLException& e) {
+        throw DBException("Snapshot error: " + std::string(e.what()));
+    }
+}
+
+void DB::end_snapshot()
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+    try {
+        ensure_connection();
+        auto stmt = std::unique_ptr<sql::Statement>(conn_->createStatement());
+        stmt->execute("COMMIT");
+    }
+    catch (const sql::SQLException& e) {
+        std::cerr << "Snapshot error: " << e.what() << "\n";
+    }
+}
+
+// -----------------------------
+// Get contacts page
+// -----------------------------
+std::vector<Contact> DB::get_contacts_page(std::size_t offset, std::size_t limit) const
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+    std::vector<Contact> contacts;
+    try {
+        ensure_connection();
+        auto stmt = prepare_page(*conn_, offset, limit);
+        auto res = std::unique_ptr<sql::ResultSet>(stmt->executeQuery());
+        if (limit != 0) {
+            contacts.reserve(limit);
+        }
+        while (res->next()) {
+            contacts.push_back(read_contact(*res));
+        }
+    }
+    catch (const sql::SQLException& e) {
+        std::cerr << "Page query error: " << e.what() << "\n";
+    }
+    return contacts;
+}
+
+void DB::get_contacts_page(std::size_t offset, std::size_t limit, ContactTable& out) const
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+    try {
+        ensure_connection();
+        auto stmt = prepare_page(*conn_, offset, limit);
+        auto res = std::unique_ptr<sql::ResultSet>(stmt->executeQuery());
+        Contact scratch{};
+        while (res->next()) {
+            read_contact(*res, out, scratch);
+        }
+    }
+    catch (const sql::SQLException& e) {
+        std::cerr << "Page query error: " << e.what() << "\n";
+    }
+}
+
+void DB::get_contacts_page_after(const Contact& after, std::size_t limit, ContactTable& out) const
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+    try {
+        ensure_connection();
+        auto stmt = std::unique_ptr<sql::PreparedStatement>(
+            conn_->prepareStatement(sql_text<select_contacts<kPageAfter>>.c_str())
+        );
+        stmt->setString(1, after.last_name);
+        stmt->setString(2, after.last_name);
+        stmt->setString(3, after.last_name);
+        stmt->setString(4, after.first_name);
+        stmt->setString(5, after.first_name);
+        stmt->setUInt64(6, after.id);
+        stmt->setUInt64(7, limit == 0 ? UINT64_MAX : static_cast<uint64_t>(limit));
+        auto res = std::unique_ptr<sql::ResultSet>(stmt->executeQuery());
+        Contact scratch{};
+        while (res->next()) {
+            read_contact(*res, out, scratch);
+        }
+    }
+    catch (const sql::SQLException& e) {
+        std::cerr << "Page query error: " << e.what() << "\n";
+    }
+}
+
+std::pmr::vector<PmrContact> DB::get_contacts_page(std::size_t offset,
+                                                   std::size_t limit,
+                                                   std::pmr::memory_resource* mr) const
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+    std::pmr::vector<PmrContact> contacts(mr);
+    try {
+        ensure_connection();
+        auto stmt = prepare_page(*conn_, offset, limit);
+        auto res = std::unique_ptr<sql::ResultSet>(stmt->executeQuery());
+        if (limit != 0) {
+            contacts.reserve(limit);
+        }
+        while (res->next()) {
+            read_contact(*res, contacts.emplace_back());
+        }
+    }
+    catch (const sql::SQLException& e) {
+        std::cerr << "Page query error: " << e.what() << "\n";
+    }
     return contacts;
 }
 
@@ -252,6 +1110,8 @@ std::vector<Contact> DB::get_all_contacts() const
 // -----------------------------
 std::vector<Contact> DB::search_contacts(const std::string& query) const
 {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
     std::vector<Contact> contacts;
     if (query.empty()) {
         return get_all_contacts();
@@ -259,29 +1119,59 @@ std::vector<Contact> DB::search_contacts(const std::string& query) const
     
     try {
         ensure_connection();
-        auto stmt = std::unique_ptr<sql::PreparedStatement>(
-            conn_->prepareStatement(
-                "SELECT id, first_name, last_name, email, mobile FROM contacts "
-                "WHERE first_name LIKE ? OR last_name LIKE ? OR email LIKE ? OR mobile LIKE ? "
-                "ORDER BY last_name, first_name"
-            )
-        );
-        
-        std::string search_pattern = "%" + query + "%";
-        stmt->setString(1, search_pattern);
-        stmt->setString(2, search_pattern);
-        stmt->setString(3, search_pattern);
-        stmt->setString(4, search_pattern);
+        auto stmt = prepare_search(*conn_, query);
+        auto res = std::unique_ptr<sql::ResultSet>(stmt->executeQuery());
+        while (res->next()) {
+            contacts.push_back(read_contact(*res));
+        }
+    }
+    catch (const sql::SQLException& e) {
+        std::cerr << "Search error: " << e.what() << "\n";
+    }
+    return contacts;
+}
+
+std::pmr::vector<PmrContact> DB::search_contacts(const std::string& query,
+                                                 std::pmr::memory_resource* mr) const
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+    if (query.empty()) {
+        return get_contacts_page(0, 0, mr);
+    }
+
+    std::pmr::vector<PmrContact> contacts(mr);
+    try {
+        ensure_connection();
+        auto stmt = prepare_search(*conn_, query);
+        auto res = std::unique_ptr<sql::ResultSet>(stmt->executeQuery());
+        while (res->next()) {
+            read_contact(*res, contacts.emplace_back());
+        }
+    }
+    catch (const sql::SQLException& e) {
+        std::cerr << "Search error: " << e.what() << "\n";
+    }
+    return contacts;
+}
+
+std::vector<Contact> DB::get_contacts_by_domain(const std::string& domain) const
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
 
+    std::vector<Contact> contacts;
+    std::string_view name = domain;
+    if (!name.empty() && name[0] == '@')
+        name.remove_prefix(1);
+    if (name.empty())
+        return contacts;
+
+    try {
+        ensure_connection();
+        auto stmt = prepare_domain(*conn_, name);
         auto res = std::unique_ptr<sql::ResultSet>(stmt->executeQuery());
         while (res->next()) {
-            contacts.push_back(Contact{
-                res->getInt("id"),
-                res->getString("first_name").c_str(),
-                res->getString("last_name").c_str(),
-                res->getString("email").c_str(),
-                res->getString("mobile").c_str()
-            });
+            contacts.push_back(read_contact(*res));
         }
     }
     catch (const sql::SQLException& e) {
@@ -295,14 +1185,16 @@ std::vector<Contact> DB::search_contacts(const std::string& query) const
 // -----------------------------
 std::vector<Contact> DB::get_contacts_sorted(const std::string& column, bool ascending) const
 {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
     std::vector<Contact> contacts;
     try {
         ensure_connection();
         std::string safe_column = sanitize_column_name(column);
         std::string order = ascending ? "ASC" : "DESC";
         
-        std::string query = "SELECT id, first_name, last_name, email, mobile FROM contacts "
-                           "ORDER BY " + safe_column + " " + order;
+        std::string query = std::string(sql_text<select_contacts<kNoTail>>.c_str()) +
+                            " ORDER BY " + safe_column + " " + order;
         
         auto stmt = std::unique_ptr<sql::PreparedStatement>(
             conn_->prepareStatement(query)
@@ -310,13 +1202,7 @@ std::vector<Contact> DB::get_contacts_sorted(const std::string& column, bool asc
 
         auto res = std::unique_ptr<sql::ResultSet>(stmt->executeQuery());
         while (res->next()) {
-            contacts.push_back(Contact{
-                res->getInt("id"),
-                res->getString("first_name").c_str(),
-                res->getString("last_name").c_str(),
-                res->getString("email").c_str(),
-                res->getString("mobile").c_str()
-            });
+            contacts.push_back(read_contact(*res));
         }
     }
     catch (const sql::SQLException& e) {
@@ -330,6 +1216,8 @@ std::vector<Contact> DB::get_contacts_sorted(const std::string& column, bool asc
 // -----------------------------
 int DB::get_contact_count() const
 {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
     try {
         ensure_connection();
         auto stmt = std::unique_ptr<sql::PreparedStatement>(
@@ -351,6 +1239,8 @@ int DB::get_contact_count() const
 // -----------------------------
 void DB::delete_all_contacts()
 {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
     try {
         ensure_connection();
         auto stmt = std::unique_ptr<sql::PreparedStatement>(
@@ -365,48 +1255,197 @@ void DB::delete_all_contacts()
 }
 
 // -----------------------------
-// Import contacts
+// Insert batch
 // -----------------------------
-bool DB::import_contacts(const std::vector<Contact>& contacts)
+void DB::insert_batch(const std::vector<Contact>& contacts)
 {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
     try {
         ensure_connection();
         conn_->setAutoCommit(false);
-        
-        auto stmt = std::unique_ptr<sql::PreparedStatement>(
+        insert_rows(contacts);
+        conn_->commit();
+        conn_->setAutoCommit(true);
+    }
+    catch (const sql::SQLException& e) {
+        rollback_quietly();
+        throw DBException("Import error: " + std::string(e.what()));
+    }
+}
+
+bool DB::insert_batch(const std::vector<Contact>& contacts,
+                      const std::string& job_key,
+                      const ImportBatchRange& range,
+                      std::uint64_t batch_no)
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+    try {
+        ensure_connection();
+        conn_->setAutoCommit(false);
+
+        // Journal first: if another run already committed this batch, the
+        // primary key rejects it before any rows are written
+        auto journal = std::unique_ptr<sql::PreparedStatement>(
             conn_->prepareStatement(
-                "INSERT INTO contacts (first_name,last_name,email,mobile) VALUES (?,?,?,?)"
+                "INSERT INTO import_batches (job_key,start_offset,end_offset,batch_no,row_count) "
+                "VALUES (?,?,?,?,?)"
             )
         );
-        
-        for (const auto& c : contacts) {
-            stmt->setString(1, c.first_name);
-            stmt->setString(2, c.last_name);
-            stmt->setString(3, c.email);
-            stmt->setString(4, c.mobile);
-            stmt->executeUpdate();
-        }
-        
+        journal->setString(1, job_key);
+        journal->setUInt64(2, range.start);
+        journal->setUInt64(3, range.end);
+        journal->setUInt64(4, batch_no);
+        journal->setUInt(5, static_cast<uint32_t>(contacts.size()));
+        journal->executeUpdate();
+
+        insert_rows(contacts);
         conn_->commit();
         conn_->setAutoCommit(true);
-        std::cout << "Imported " << contacts.size() << " contacts\n";
         return true;
     }
     catch (const sql::SQLException& e) {
+        rollback_quietly();
+        if (e.getErrorCode() == kErrDuplicateKey)
+            return false;
+        throw DBException("Import error: " + std::string(e.what()));
+    }
+}
+
+void DB::insert_rows(const std::vector<Contact>& contacts)
+{
+    auto stmt = std::unique_ptr<sql::PreparedStatement>(
+        conn_->prepareStatement(sql_text<insert_contact_sql>.c_str())
+    );
+
+    for (const auto& c : contacts) {
+        bind_row(*stmt, c);
+        stmt->executeUpdate();
+    }
+}
+
+void DB::rollback_quietly()
+{
+    try {
         conn_->rollback();
         conn_->setAutoCommit(true);
-        std::cerr << "Import error: " << e.what() << "\n";
-        return false;
+    }
+    catch (const sql::SQLException&) {
+        // Connection is gone; the server rolls back on its own
+    }
+}
+
+// -----------------------------
+// Import journal
+// -----------------------------
+ImportJournal DB::load_import_journal(const std::string& job_key) const
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+    try {
+        ensure_connection();
+        auto stmt = std::unique_ptr<sql::PreparedStatement>(
+            conn_->prepareStatement(
+                "SELECT start_offset, end_offset, row_count FROM import_batches WHERE job_key = ?"
+            )
+        );
+        stmt->setString(1, job_key);
+        auto res = std::unique_ptr<sql::ResultSet>(stmt->executeQuery());
+
+        std::vector<ImportBatchRange> ranges;
+        while (res->next()) {
+            ranges.push_back(ImportBatchRange{res->getUInt64("start_offset"),
+                                              res->getUInt64("end_offset"),
+                                              res->getUInt("row_count")});
+        }
+        return ImportJournal(std::move(ranges));
+    }
+    catch (const sql::SQLException& e) {
+        throw DBException("Import journal error: " + std::string(e.what()));
+    }
+}
+
+void DB::finish_import_job(const std::string& job_key)
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+    try {
+        ensure_connection();
+        auto stmt = std::unique_ptr<sql::PreparedStatement>(
+            conn_->prepareStatement("DELETE FROM import_batches WHERE job_key = ?")
+        );
+        stmt->setString(1, job_key);
+        stmt->executeUpdate();
+    }
+    catch (const sql::SQLException& e) {
+        // A leftover journal only costs a little space; the import itself succeeded
+        std::cerr << "Import journal cleanup error: " << e.what() << "\n";
     }
 }
 
 // -----------------------------
-// Email validation
+// Search key backfill
 // -----------------------------
-bool DB::is_valid_email(const std::string& email)
+std::size_t DB::backfill_search_keys(ContactId& cursor, std::size_t batch_rows)
 {
-    const std::regex pattern(R"([a-zA-Z0-9._%+-]+@[a-zA-Z0-9.-]+\.[a-zA-Z]{2,})");
-    return std::regex_match(email, pattern);
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+    try {
+        ensure_connection();
+        // Once a pass has found every row keyed, finding that out again
+        // would walk the whole primary key
+        auto finished = std::unique_ptr<sql::PreparedStatement>(
+            conn_->prepareStatement("SELECT 1 FROM maintenance_tasks WHERE name=?")
+        );
+        finished->setString(1, kSearchKeyBackfill);
+        if (std::unique_ptr<sql::ResultSet>(finished->executeQuery())->next())
+            return 0;
+
+        auto select = std::unique_ptr<sql::PreparedStatement>(
+            conn_->prepareStatement(sql_text<select_contacts<kUnkeyed>>.c_str())
+        );
+        select->setUInt64(1, cursor);
+        select->setUInt64(2, batch_rows);
+        std::vector<Contact> rows;
+        auto res = std::unique_ptr<sql::ResultSet>(select->executeQuery());
+        while (res->next())
+            rows.push_back(read_contact(*res));
+        if (rows.empty()) {
+            // The pass started at id 0, so every row below cursor is keyed too
+            auto done = std::unique_ptr<sql::PreparedStatement>(
+                conn_->prepareStatement("INSERT IGNORE INTO maintenance_tasks (name) VALUES (?)")
+            );
+            done->setString(1, kSearchKeyBackfill);
+            done->executeUpdate();
+            return 0;
+        }
+
+        // Keep updated_at as it was: keying a row is not an edit, and
+        // incremental sync would otherwise resend every row. A row edited
+        // meanwhile already has a current key, and a key that is already
+        // right is left alone.
+        conn_->setAutoCommit(false);
+        auto update = std::unique_ptr<sql::PreparedStatement>(conn_->prepareStatement(
+            "UPDATE contacts SET search_key=?, updated_at=updated_at "
+            "WHERE id=? AND CAST(updated_at AS CHAR) = ? AND NOT (search_key <=> ?)"));
+        for (const auto& c : rows) {
+            std::string key = search_key(c);
+            update->setString(1, key);
+            update->setUInt64(2, c.id);
+            update->setString(3, c.updated_at);
+            update->setString(4, key);
+            update->executeUpdate();
+        }
+        conn_->commit();
+        conn_->setAutoCommit(true);
+        cursor = rows.back().id;
+        return rows.size();
+    }
+    catch (const sql::SQLException& e) {
+        rollback_quietly();
+        throw DBException("Search key backfill error: " + std::string(e.what()));
+    }
 }
 
 // -----------------------------
@@ -419,14 +1458,27 @@ void DB::ensure_connection() const
     }
 }
 
+std::string DB::order_by_clause(const std::string& column, bool ascending) const
+{
+    // Same tie-breaks as the list view, then id so the order is total; all
+    // in one direction, as ContactLess orders, so a descending sort is the
+    // ascending one reversed
+    std::string safe_column = sanitize_column_name(column);
+    std::string order = ascending ? " ASC" : " DESC";
+    std::string clause = safe_column + order;
+    if (safe_column == "last_name")
+        clause += ", first_name" + order;
+    if (safe_column != "id")
+        clause += ", id" + order;
+    return clause;
+}
+
 std::string DB::sanitize_column_name(const std::string& column) const
 {
-    static const std::vector<std::string> valid_columns = {
-        "id", "first_name", "last_name", "email", "mobile"
-    };
-    
-    if (std::find(valid_columns.begin(), valid_columns.end(), column) != valid_columns.end()) {
-        return column;
-    }
-    return "last_name"; // default
+    std::string safe = "last_name"; // default
+    for_each<sortable>([&](const auto& f) {
+        if (same_name(f.name, column))
+            safe = f.name;
+    });
+    return safe;
 }
@@ -3,14 +3,15 @@
 #include <iostream>
 #include <fstream>
 #include <filesystem>
+#include <chrono>
 
 DBConnectionDialog::DBConnectionDialog(
-    std::function<void(const std::string&, unsigned int, const std::string&, const std::string&)> on_connect)
+    std::function<void(const ConnectionSettings&)> on_connect)
 : Gtk::Window(),
   m_on_connect(on_connect)
 {
     set_title("Connect to MariaDB Database");
-    set_default_size(450, 350);
+    set_default_size(450, 420);
     set_resizable(false);
 
     // Setup main layout
@@ -32,12 +33,16 @@ DBConnectionDialog::DBConnectionDialog(
     auto* lbl_user = Gtk::make_managed<Gtk::Label>("Username:");
     auto* lbl_pass = Gtk::make_managed<Gtk::Label>("Password:");
     auto* lbl_db   = Gtk::make_managed<Gtk::Label>("Database:");
+    auto* lbl_connect_timeout = Gtk::make_managed<Gtk::Label>("Connect timeout (s):");
+    auto* lbl_read_timeout    = Gtk::make_managed<Gtk::Label>("Read timeout (s):");
 
     lbl_host->set_halign(Gtk::Align::END);
     lbl_port->set_halign(Gtk::Align::END);
     lbl_user->set_halign(Gtk::Align::END);
     lbl_pass->set_halign(Gtk::Align::END);
     lbl_db->set_halign(Gtk::Align::END);
+    lbl_connect_timeout->set_halign(Gtk::Align::END);
+    lbl_read_timeout->set_halign(Gtk::Align::END);
 
     // Entries
     entry_host.set_hexpand(true);
@@ -56,6 +61,10 @@ DBConnectionDialog::DBConnectionDialog(
     grid.attach(entry_password, 1, 3);
     grid.attach(*lbl_db, 0, 4);
     grid.attach(entry_database, 1, 4);
+    grid.attach(*lbl_connect_timeout, 0, 5);
+    grid.attach(spin_connect_timeout, 1, 5);
+    grid.attach(*lbl_read_timeout, 0, 6);
+    grid.attach(spin_read_timeout, 1, 6);
 
     // Default values
     entry_host.set_text("127.0.0.1");
@@ -65,16 +74,28 @@ DBConnectionDialog::DBConnectionDialog(
     entry_password.set_visibility(false);
     entry_password.set_input_purpose(Gtk::InputPurpose::PASSWORD);
 
+    ConnectionTimeouts defaults;
+    spin_connect_timeout.set_range(1, 120);
+    spin_connect_timeout.set_increments(1, 5);
+    spin_connect_timeout.set_value(defaults.connect_ms / 1000);
+    spin_read_timeout.set_range(1, 600);
+    spin_read_timeout.set_increments(1, 10);
+    spin_read_timeout.set_value(defaults.read_ms / 1000);
+
     // Remember checkbox
     check_remember.set_label("Remember credentials");
     check_remember.set_margin_top(5);
-    grid.attach(check_remember, 0, 5, 2, 1);
+    grid.attach(check_remember, 0, 7, 2, 1);
 
-    // Status label
+    // Status row: spinner while a test is running, then the result
+    m_status_row.set_spacing(8);
+    m_status_row.set_margin_top(5);
+    m_spinner.set_visible(false);
     m_status_label.set_halign(Gtk::Align::START);
-    m_status_label.set_margin_top(5);
     m_status_label.set_visible(false);
-    grid.attach(m_status_label, 0, 6, 2, 1);
+    m_status_row.append(m_spinner);
+    m_status_row.append(m_status_label);
+    grid.attach(m_status_row, 0, 8, 2, 1);
 
     // Load saved credentials
     load_saved_credentials();
@@ -97,66 +118,120 @@ DBConnectionDialog::DBConnectionDialog(
     entry_password.signal_activate().connect([this](){ on_ok(); });
 }
 
-void DBConnectionDialog::on_ok()
+DBConnectionDialog::~DBConnectionDialog()
 {
-    std::string host = entry_host.get_text();
+    m_test_ticker.disconnect();
+}
+
+std::optional<ConnectionSettings> DBConnectionDialog::read_settings()
+{
+    ConnectionSettings settings;
+    settings.host = entry_host.get_text();
+    settings.user = entry_user.get_text();
+    settings.password = entry_password.get_text();
+    settings.database = entry_database.get_text();
     std::string port_str = entry_port.get_text();
-    std::string user = entry_user.get_text();
-    std::string password = entry_password.get_text();
 
-    if (host.empty() || port_str.empty() || user.empty()) {
+    if (settings.host.empty() || port_str.empty() || settings.user.empty()) {
         show_status("Please fill in all required fields", true);
-        return;
+        return std::nullopt;
     }
 
-    unsigned int port;
     try {
-        port = std::stoi(port_str);
-        if (port == 0 || port > 65535)
+        int port = std::stoi(port_str);
+        if (port <= 0 || port > 65535)
             throw std::out_of_range("Port out of range");
+        settings.port = static_cast<unsigned int>(port);
     } catch (...) {
         show_status("Invalid port number", true);
+        return std::nullopt;
+    }
+
+    if (settings.database.empty())
+        settings.database = "Contacts";
+
+    settings.timeouts.connect_ms = static_cast<unsigned int>(spin_connect_timeout.get_value_as_int()) * 1000;
+    settings.timeouts.read_ms = static_cast<unsigned int>(spin_read_timeout.get_value_as_int()) * 1000;
+    return settings;
+}
+
+void DBConnectionDialog::on_ok()
+{
+    auto settings = read_settings();
+    if (!settings)
         return;
+
+    if (m_testing) {
+        m_test_task.cancel();
+        finish_test("", false);
     }
 
     // Save credentials
     if (check_remember.get_active())
         save_credentials();
 
+    // The caller connects in the background; the dialog does not block on it
     if (m_on_connect)
-        m_on_connect(host, port, user, password);
+        m_on_connect(*settings);
 
     hide(); // Let signal_hide in main.cpp handle deletion
 }
 
 void DBConnectionDialog::on_test_connection()
 {
-    std::string host = entry_host.get_text();
-    std::string port_str = entry_port.get_text();
-    std::string user = entry_user.get_text();
-    std::string password = entry_password.get_text();
-    std::string database = entry_database.get_text();
-
-    if (host.empty() || port_str.empty() || user.empty()) {
-        show_status("Please fill in all required fields", true);
+    // A second click while a test is in flight cancels it
+    if (m_testing) {
+        m_test_task.cancel();
+        finish_test("Connection test cancelled", true);
         return;
     }
 
-    unsigned int port;
-    try { port = std::stoi(port_str); } 
-    catch (...) { show_status("Invalid port number", true); return; }
+    auto settings = read_settings();
+    if (!settings)
+        return;
 
-    show_status("Testing connection...", false);
+    m_testing = true;
+    test_button.set_label("Cancel Test");
+    m_spinner.set_visible(true);
+    m_spinner.start();
 
-    try {
-        DB test_db(host, user, password, database, port);
-        if (test_db.test_connection())
-            show_status("✓ Connection successful!", false);
-        else
-            show_status("✗ Connection failed", true);
-    } catch (const std::exception& e) {
-        show_status("✗ Connection failed: " + std::string(e.what()), true);
-    }
+    std::string target = settings->host + ":" + std::to_string(settings->port);
+    show_status("Testing connection to " + target + "...", false);
+
+    auto started = std::chrono::steady_clock::now();
+    m_test_ticker = Glib::signal_timeout().connect_seconds([this, target, started]() {
+        auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::steady_clock::now() - started).count();
+        show_status("Testing connection to " + target + "... (" +
+                    std::to_string(elapsed) + "s)", false);
+        return true;
+    }, 1);
+
+    m_test_task.run(
+        [test_settings = *settings](const TaskContext&) {
+            DB test_db(test_settings);
+            return test_db.test_connection();
+        },
+        [this](bool ok) {
+            if (ok)
+                finish_test("✓ Connection successful!", false);
+            else
+                finish_test("✗ Connection failed", true);
+        },
+        [this](const std::string& error) {
+            finish_test("✗ Connection failed: " + error, true);
+        });
+}
+
+void DBConnectionDialog::finish_test(const std::string& message, bool is_error)
+{
+    m_testing = false;
+    m_test_ticker.disconnect();
+    m_spinner.stop();
+    m_spinner.set_visible(false);
+    test_button.set_label("Test Connection");
+    if (!message.empty())
+        show_status(message, is_error);
 }
 
 void DBConnectionDialog::load_saved_credentials()
@@ -172,6 +247,8 @@ void DBConnectionDialog::load_saved_credentials()
             if (std::getline(file, line)) entry_port.set_text(line);
             if (std::getline(file, line)) entry_user.set_text(line);
             if (std::getline(file, line)) entry_database.set_text(line);
+            if (std::getline(file, line)) spin_connect_timeout.set_value(std::stoi(line));
+            if (std::getline(file, line)) spin_read_timeout.set_value(std::stoi(line));
             check_remember.set_active(true);
         }
     } catch (...) {
@@ -193,6 +270,8 @@ void DBConnectionDialog::save_credentials()
             file << entry_port.get_text() << "\n";
             file << entry_user.get_text() << "\n";
             file << entry_database.get_text() << "\n";
+            file << spin_connect_timeout.get_value_as_int() << "\n";
+            file << spin_read_timeout.get_value_as_int() << "\n";
             
             // Set restrictive permissions (owner read/write only)
             std::filesystem::permissions(config_file, 
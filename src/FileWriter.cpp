@@ -0,0 +1,313 @@
+#include "FileWriter.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+// O_DIRECT needs buffer addresses, sizes and file offsets aligned to the
+// logical block size; a page satisfies every common device
+std::size_t page_size()
+{
+    return static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+}
+
+[[noreturn]] void throw_errno(int err, const std::string& what)
+{
+    throw std::system_error(err, std::generic_category(), what);
+}
+
+// Compresses blocks for every FileWriter in the process on one thread per
+// hardware thread. Parallel export partitions each have a writer; sharing
+// the threads, rather than splitting the cores between the writers, lets
+// a busy partition use cores the others leave idle.
+class CompressionPool {
+public:
+    static CompressionPool& instance()
+    {
+        static CompressionPool pool(std::max(1u, std::thread::hardware_concurrency()));
+        return pool;
+    }
+
+    ~CompressionPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_ready.notify_all();
+        for (auto& thread : m_threads)
+            thread.join();
+    }
+
+    std::future<std::string> submit(std::packaged_task<std::string()> job)
+    {
+        auto result = job.get_future();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_jobs.push_back(std::move(job));
+        }
+        m_ready.notify_one();
+        return result;
+    }
+
+private:
+    explicit CompressionPool(unsigned int threads)
+    {
+        for (unsigned int i = 0; i < threads; ++i)
+            m_threads.emplace_back([this]() { run(); });
+    }
+
+    void run()
+    {
+        for (;;) {
+            std::packaged_task<std::string()> job;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_ready.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+                if (m_jobs.empty())
+                    return;
+                job = std::move(m_jobs.front());
+                m_jobs.pop_front();
+            }
+            job();
+        }
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_ready;
+    std::deque<std::packaged_task<std::string()>> m_jobs;
+    bool m_stopping = false;
+    std::vector<std::thread> m_threads;
+};
+
+} // namespace
+
+FileWriter::FileWriter(const std::string& path, FileWriterOptions options)
+: m_path(path),
+  m_codec(options.codec),
+  m_level(options.level),
+  m_blocks_in_flight(options.blocks_in_flight ? options.blocks_in_flight
+                                              : std::max(1u, std::thread::hardware_concurrency()))
+{
+    if (!codec_available(m_codec))
+        throw CodecError(std::string(codec_name(m_codec)) + " support is not built in");
+
+    const int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+#ifdef O_DIRECT
+    // Compressed blocks have arbitrary sizes, which O_DIRECT cannot take
+    if (options.direct_io && m_codec == Codec::none) {
+        m_fd = ::open(path.c_str(), flags | O_DIRECT, 0644);
+        m_direct = m_fd >= 0;
+        // EINVAL: the filesystem (tmpfs, some FUSE mounts) refuses O_DIRECT
+    }
+#endif
+    if (m_fd < 0)
+        m_fd = ::open(path.c_str(), flags, 0644);
+    if (m_fd < 0)
+        throw_errno(errno, "Cannot create " + path);
+
+    const std::size_t page = page_size();
+    m_capacity = std::max(options.buffer_bytes, page) / page * page;
+    try {
+        m_buffer = allocate_buffer();
+    }
+    catch (...) {
+        ::close(m_fd);
+        throw;
+    }
+}
+
+FileWriter::~FileWriter()
+{
+    // The pool may still be reading buffers of blocks never written
+    for (auto& block : m_blocks) {
+        block.compressed.wait();
+        std::free(block.buffer);
+    }
+    for (char* buffer : m_spare_buffers)
+        std::free(buffer);
+    if (m_fd >= 0)
+        ::close(m_fd);
+    std::free(m_buffer);
+}
+
+char* FileWriter::allocate_buffer()
+{
+    void* buffer = nullptr;
+    if (::posix_memalign(&buffer, page_size(), m_capacity) != 0)
+        throw_errno(ENOMEM, "Cannot allocate write buffer for " + m_path);
+    return static_cast<char*>(buffer);
+}
+
+void FileWriter::write_slow(std::string_view bytes)
+{
+    while (!bytes.empty()) {
+        if (m_length == m_capacity)
+            flush_buffer();
+        std::size_t n = std::min(bytes.size(), m_capacity - m_length);
+        std::memcpy(m_buffer + m_length, bytes.data(), n);
+        m_length += n;
+        bytes.remove_prefix(n);
+    }
+}
+
+void FileWriter::flush_buffer()
+{
+    if (m_codec != Codec::none) {
+        compress_buffer();
+        return;
+    }
+    // Called only with a full buffer, so direct writes stay aligned
+    write_all(m_buffer, m_length);
+    m_flushed += m_length;
+    m_length = 0;
+}
+
+void FileWriter::compress_buffer()
+{
+    // Bound the blocks in flight, and so memory
+    while (m_blocks.size() >= m_blocks_in_flight)
+        write_oldest_block();
+
+    // The pool reads the full buffer in place; writing carries on in
+    // another, so at most blocks_in_flight + 1 buffers ever exist
+    char* next = nullptr;
+    if (!m_spare_buffers.empty()) {
+        next = m_spare_buffers.back();
+        m_spare_buffers.pop_back();
+    }
+    else {
+        next = allocate_buffer();
+    }
+
+    const char* data = m_buffer;
+    std::size_t length = m_length;
+    std::packaged_task<std::string()> job([codec = m_codec, level = m_level, data, length]() {
+        return compress_block(codec, data, length, level);
+    });
+    m_blocks.push_back(Block{m_buffer, CompressionPool::instance().submit(std::move(job))});
+    m_buffer = next;
+    m_flushed += length;
+    m_length = 0;
+}
+
+void FileWriter::write_oldest_block()
+{
+    // Once the job is done its buffer can take new data, whatever it returned
+    Block block = std::move(m_blocks.front());
+    m_blocks.pop_front();
+    block.compressed.wait();
+    m_spare_buffers.push_back(block.buffer);
+    std::string compressed = block.compressed.get();
+    write_all(compressed.data(), compressed.size());
+}
+
+void FileWriter::finish()
+{
+    if (m_fd < 0)
+        return;
+
+    if (m_codec != Codec::none) {
+        // An empty export still becomes a valid (empty) archive
+        if (m_length > 0 || (m_stored == 0 && m_blocks.empty()))
+            compress_buffer();
+        while (!m_blocks.empty())
+            write_oldest_block();
+    }
+
+#ifdef O_DIRECT
+    // The tail is rarely a whole number of blocks; write it through the cache
+    if (m_direct && m_length % page_size() != 0) {
+        int flags = ::fcntl(m_fd, F_GETFL);
+        if (flags < 0 || ::fcntl(m_fd, F_SETFL, flags & ~O_DIRECT) < 0)
+            throw_errno(errno, "Cannot write " + m_path);
+        m_direct = false;
+    }
+#endif
+    write_all(m_buffer, m_length);
+    m_flushed += m_length;
+    m_length = 0;
+
+    int fd = m_fd;
+    m_fd = -1;
+    if (::close(fd) != 0)
+        throw_errno(errno, "Cannot write " + m_path);
+}
+
+void FileWriter::write_all(const char* data, std::size_t length)
+{
+    while (length > 0) {
+        ssize_t n = ::write(m_fd, data, length);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            throw_errno(errno, "Cannot write " + m_path);
+        }
+        data += n;
+        length -= static_cast<std::size_t>(n);
+        m_stored += static_cast<std::uint64_t>(n);
+    }
+}
+
+void append_file(const std::string& dest, const std::string& src)
+{
+    int in = ::open(src.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0)
+        throw_errno(errno, "Cannot open " + src);
+    // Not O_APPEND: copy_file_range refuses such descriptors
+    int out = ::open(dest.c_str(), O_WRONLY | O_CLOEXEC);
+    if (out < 0 || ::lseek(out, 0, SEEK_END) < 0) {
+        int err = errno;
+        ::close(in);
+        if (out >= 0)
+            ::close(out);
+        throw_errno(err, "Cannot open " + dest);
+    }
+
+    auto fail = [&](int err, const std::string& what) {
+        ::close(in);
+        ::close(out);
+        throw_errno(err, what);
+    };
+
+    bool kernel_copy = true;
+    for (;;) {
+        ssize_t n = -1;
+        if (kernel_copy) {
+            n = ::copy_file_range(in, nullptr, out, nullptr, 1u << 30, 0);
+            if (n < 0 && (errno == EXDEV || errno == ENOSYS || errno == EINVAL ||
+                          errno == EOPNOTSUPP)) {
+                kernel_copy = false;
+                continue;
+            }
+        }
+        else {
+            static thread_local char buffer[1u << 20];
+            n = ::read(in, buffer, sizeof(buffer));
+            if (n > 0) {
+                for (ssize_t done = 0; done < n;) {
+                    ssize_t w = ::write(out, buffer + done, static_cast<std::size_t>(n - done));
+                    if (w < 0 && errno != EINTR)
+                        fail(errno, "Cannot write " + dest);
+                    if (w > 0)
+                        done += w;
+                }
+            }
+        }
+        if (n == 0)
+            break;
+        if (n < 0 && errno != EINTR)
+            fail(errno, "Cannot copy " + src + " to " + dest);
+    }
+
+    ::close(in);
+    if (::close(out) != 0)
+        throw_errno(errno, "Cannot write " + dest);
+}
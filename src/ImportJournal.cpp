@@ -0,0 +1,54 @@
+#include "ImportJournal.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <iterator>
+
+ImportJournal::ImportJournal(std::vector<ImportBatchRange> ranges)
+{
+    std::sort(ranges.begin(), ranges.end(),
+              [](const ImportBatchRange& a, const ImportBatchRange& b) { return a.start < b.start; });
+
+    // Batches can overlap when a resumed run re-batched around a committed
+    // gap; merge them so lookups are a single binary search
+    for (const auto& range : ranges) {
+        m_rows += range.rows;
+        if (!m_ranges.empty() && range.start <= m_ranges.back().end)
+            m_ranges.back().end = std::max(m_ranges.back().end, range.end);
+        else
+            m_ranges.push_back(range);
+    }
+}
+
+std::uint64_t ImportJournal::resume_offset() const
+{
+    if (m_ranges.empty() || m_ranges.front().start != 0)
+        return 0;
+    return m_ranges.front().end;
+}
+
+bool ImportJournal::contains(std::uint64_t record_offset) const
+{
+    auto it = std::upper_bound(m_ranges.begin(), m_ranges.end(), record_offset,
+                               [](std::uint64_t offset, const ImportBatchRange& r) { return offset < r.start; });
+    return it != m_ranges.begin() && record_offset < std::prev(it)->end;
+}
+
+std::string import_job_key(const std::string& path)
+{
+    namespace fs = std::filesystem;
+    std::string identity = fs::absolute(path).string();
+    identity += '\0' + std::to_string(fs::file_size(path));
+    identity += '\0' + std::to_string(fs::last_write_time(path).time_since_epoch().count());
+
+    // FNV-1a: stable across runs and platforms, unlike std::hash
+    std::uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : identity) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+
+    char key[17];
+    std::snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(hash));
+    return key;
+}
@@ -0,0 +1,286 @@
+#include "ImportPipeline.hpp"
+#include "BoundedQueue.hpp"
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace {
+
+unsigned int resolve_threads(unsigned int requested)
+{
+    if (requested)
+        return requested;
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Run fn(i) for i in [0, count) on up to `threads` threads
+template <typename Fn>
+void parallel_for(std::size_t count, unsigned int threads, Fn fn)
+{
+    std::atomic<std::size_t> next{0};
+    auto worker = [&]() {
+        for (std::size_t i = next++; i < count; i = next++)
+            fn(i);
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned int t = 1; t < threads && t < count; ++t)
+        pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool)
+        t.join();
+}
+
+// A parsed batch and the byte range of the input it came from
+struct PendingBatch {
+    ImportBatchRange range;
+    std::uint64_t batch_no = 0;
+    std::vector<Contact> rows;
+};
+
+} // namespace
+
+// -----------------------------
+// Chunking
+// -----------------------------
+std::vector<std::size_t> ImportPipeline::split_chunks(std::string_view csv,
+                                                      std::size_t chunk_bytes,
+                                                      unsigned int threads)
+{
+    const std::size_t size = csv.size();
+    std::vector<std::size_t> starts{0};
+    if (size == 0 || chunk_bytes == 0 || chunk_bytes >= size) {
+        starts.push_back(size);
+        return starts;
+    }
+
+    // Quote parity at each nominal boundary tells whether it falls inside a
+    // quoted field. Counting is the only pass over the whole input, so it
+    // runs in parallel; "" escapes toggle twice and do not disturb parity.
+    std::size_t nominal = (size + chunk_bytes - 1) / chunk_bytes;
+    std::vector<std::size_t> quotes(nominal);
+    parallel_for(nominal, resolve_threads(threads), [&](std::size_t i) {
+        auto piece = csv.substr(i * chunk_bytes, chunk_bytes);
+        quotes[i] = static_cast<std::size_t>(std::count(piece.begin(), piece.end(), '"'));
+    });
+
+    std::size_t quotes_before = 0;
+    for (std::size_t i = 1; i < nominal; ++i) {
+        quotes_before += quotes[i - 1];
+        std::size_t pos = i * chunk_bytes;
+        if (pos < starts.back())
+            continue; // previous boundary already walked past this one
+
+        // Walk forward to the first line break outside quotes
+        bool in_quotes = quotes_before % 2 != 0;
+        while (pos < size) {
+            char c = csv[pos];
+            if (c == '"')
+                in_quotes = !in_quotes;
+            else if (c == '\n' && !in_quotes)
+                break;
+            ++pos;
+        }
+        if (pos + 1 >= size)
+            break;
+        starts.push_back(pos + 1);
+    }
+    starts.push_back(size);
+    return starts;
+}
+
+// -----------------------------
+// Pipeline
+// -----------------------------
+ImportPipeline::ImportPipeline(const ContactStore& db, ImportOptions options)
+: m_db(db),
+  m_options(options)
+{
+}
+
+ImportProgress ImportPipeline::run(MappedFile& file,
+                                   const ProgressFn& on_progress,
+                                   const CancelFn& cancelled)
+{
+    m_release_file = &file;
+    try {
+        auto result = run(file.data(), on_progress, cancelled);
+        m_release_file = nullptr;
+        return result;
+    }
+    catch (...) {
+        m_release_file = nullptr;
+        throw;
+    }
+}
+
+ImportProgress ImportPipeline::run(std::string_view csv,
+                                   const ProgressFn& on_progress,
+                                   const CancelFn& cancelled)
+{
+    const unsigned int parsers = resolve_threads(m_options.parser_threads);
+    const unsigned int writers = std::max(1u, m_options.writer_connections);
+    const std::size_t batch_rows = std::max<std::size_t>(1, m_options.batch_rows);
+
+    const bool journaled = !m_options.job_key.empty();
+
+    // Open writer connections first so a bad server fails before parsing
+    std::vector<std::unique_ptr<ContactStore>> connections;
+    for (unsigned int w = 0; w < writers; ++w)
+        connections.push_back(m_db.clone());
+
+    // A resumed job starts after its committed prefix, which always ends on
+    // a record boundary, so chunking from there keeps quote parity intact
+    ImportJournal journal;
+    if (journaled)
+        journal = connections.front()->load_import_journal(m_options.job_key);
+    const std::size_t base = static_cast<std::size_t>(std::min<std::uint64_t>(journal.resume_offset(), csv.size()));
+
+    auto chunks = split_chunks(csv.substr(base), m_options.chunk_bytes, parsers);
+    for (auto& start : chunks)
+        start += base;
+
+    BoundedQueue<PendingBatch> queue(m_options.queue_batches);
+    std::atomic<std::size_t> next_chunk{0};
+    std::atomic<std::uint64_t> next_batch_no{0};
+    std::atomic<std::size_t> imported{0};
+    std::atomic<std::size_t> rejected{0};
+    std::atomic<std::size_t> parsed_bytes{base};
+    std::atomic<bool> failed{false};
+    std::mutex error_mutex;
+    std::string error;
+
+    auto fail = [&](const std::string& message) {
+        {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (error.empty())
+                error = message;
+        }
+        failed = true;
+        queue.close();
+    };
+    auto stopping = [&]() {
+        return failed.load() || (cancelled && cancelled());
+    };
+    auto progress = [&]() {
+        return ImportProgress{imported.load(), rejected.load(), parsed_bytes.load(), csv.size(),
+                              static_cast<std::size_t>(journal.rows_committed())};
+    };
+
+    auto parse_worker = [&]() {
+        try {
+            std::vector<CsvField> fields;
+            PendingBatch batch;
+            batch.rows.reserve(batch_rows);
+
+            // Where the next batch's range begins: the end of the previous
+            // one, so headers and rejected rows leave no gaps in the journal.
+            // After skipping a committed record that point may already be
+            // another batch's key, so the next batch starts at its first row.
+            std::uint64_t cursor = 0;
+            bool contiguous = false;
+
+            // Returns false once the pipeline is shutting down
+            auto flush = [&](std::uint64_t end) {
+                cursor = end;
+                contiguous = true;
+                batch.range.end = end;
+                batch.range.rows = batch.rows.size();
+                batch.batch_no = next_batch_no++;
+                if (stopping() || !queue.push(std::move(batch)))
+                    return false;
+                batch = {};
+                batch.rows.reserve(batch_rows);
+                return true;
+            };
+
+            for (std::size_t i = next_chunk++; i + 1 < chunks.size(); i = next_chunk++) {
+                CsvReader reader(csv.substr(chunks[i], chunks[i + 1] - chunks[i]));
+                bool skip = (chunks[i] == 0 && m_options.skip_header);
+                std::size_t chunk_rejected = 0;
+                cursor = chunks[i];
+                contiguous = true;
+
+                for (;;) {
+                    std::uint64_t record_start = chunks[i] + reader.offset();
+                    if (!reader.next(fields))
+                        break;
+                    if (skip) { skip = false; continue; }
+                    if (fields.size() == 1 && fields[0].raw.empty())
+                        continue; // blank line
+                    if (journaled && journal.contains(record_start)) {
+                        contiguous = false;
+                        continue;
+                    }
+
+                    Contact c = contact_from_csv(fields);
+                    if (!is_importable(c)) {
+                        ++chunk_rejected;
+                        continue;
+                    }
+                    if (batch.rows.empty())
+                        batch.range.start = contiguous ? cursor : record_start;
+                    batch.rows.push_back(std::move(c));
+                    if (batch.rows.size() >= batch_rows && !flush(chunks[i] + reader.offset()))
+                        return;
+                }
+                // Batches end with their chunk so each covers one contiguous range
+                if (!batch.rows.empty() && !flush(chunks[i + 1]))
+                    return;
+
+                rejected += chunk_rejected;
+                parsed_bytes += chunks[i + 1] - chunks[i];
+                if (m_release_file)
+                    m_release_file->release(chunks[i], chunks[i + 1] - chunks[i]);
+            }
+        }
+        catch (const std::exception& e) {
+            fail(e.what());
+        }
+    };
+
+    auto write_worker = [&](ContactStore& conn) {
+        try {
+            while (auto batch = queue.pop()) {
+                if (stopping())
+                    continue; // drain so parsers never block on a dead pipeline
+                bool committed = true;
+                if (journaled)
+                    committed = conn.insert_batch(batch->rows, m_options.job_key, batch->range, batch->batch_no);
+                else
+                    conn.insert_batch(batch->rows);
+                if (committed)
+                    imported += batch->rows.size();
+                if (on_progress)
+                    on_progress(progress());
+            }
+        }
+        catch (const std::exception& e) {
+            fail(e.what());
+        }
+    };
+
+    std::vector<std::thread> writer_threads;
+    for (auto& conn : connections)
+        writer_threads.emplace_back(write_worker, std::ref(*conn));
+
+    std::vector<std::thread> parser_threads;
+    for (unsigned int p = 0; p < parsers; ++p)
+        parser_threads.emplace_back(parse_worker);
+    for (auto& t : parser_threads)
+        t.join();
+
+    queue.close();
+    for (auto& t : writer_threads)
+        t.join();
+
+    if (failed)
+        throw DBException(error);
+
+    if (journaled && !(cancelled && cancelled()))
+        connections.front()->finish_import_job(m_options.job_key);
+
+    return progress();
+}
@@ -0,0 +1,562 @@
+#include "InMemoryStore.hpp"
+#include "ContactTable.hpp"
+#include "StoreSupport.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <set>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace {
+
+// Rows are stored in fixed-size chunks shared by pointer; see Table
+constexpr std::size_t kChunkRows = 4096;
+using Chunk = std::vector<Contact>;
+
+} // namespace
+
+// Rows by id, in chunks shared by pointer. Copying a Table copies only the
+// chunk pointers, which is how readers capture rows and let go of the lock;
+// a writer copies a chunk before changing it while a reader still holds it.
+// A deleted row keeps its slot with id 0.
+struct InMemoryStore::Table {
+    std::vector<std::shared_ptr<Chunk>> chunks;
+    ContactId first_id = 1; // id of the first slot
+    ContactId next_id = 1;  // like AUTO_INCREMENT, ids are never reused
+
+    const Contact& at(ContactId id) const
+    {
+        std::size_t slot = static_cast<std::size_t>(id - first_id);
+        return (*chunks[slot / kChunkRows])[slot % kChunkRows];
+    }
+
+    const Contact* find(ContactId id) const
+    {
+        if (id < first_id || id >= next_id)
+            return nullptr;
+        const Contact& row = at(id);
+        return row.id != 0 ? &row : nullptr;
+    }
+
+    // The functions below expect the store locked for writing
+    Chunk& writable(std::size_t index)
+    {
+        auto& chunk = chunks[index];
+        if (chunk.use_count() > 1)
+            chunk = std::make_shared<Chunk>(*chunk);
+        // A count of one may come from a reader that has just let go; its
+        // reads must happen before our writes
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return *chunk;
+    }
+
+    Contact& writable_row(ContactId id)
+    {
+        std::size_t slot = static_cast<std::size_t>(id - first_id);
+        return writable(slot / kChunkRows)[slot % kChunkRows];
+    }
+
+    Contact& append(Contact contact)
+    {
+        if (chunks.empty() || chunks.back()->size() == kChunkRows) {
+            chunks.push_back(std::make_shared<Chunk>());
+            chunks.back()->reserve(kChunkRows);
+        }
+        Chunk& chunk = writable(chunks.size() - 1);
+        chunk.reserve(kChunkRows); // a copied chunk has no spare capacity
+        contact.id = next_id++;
+        chunk.push_back(std::move(contact));
+        return chunk.back();
+    }
+};
+
+struct InMemoryStore::State {
+    // List order: last name, first name, id
+    struct NameLess {
+        const Table* table;
+        bool operator()(ContactId a, ContactId b) const
+        {
+            const Contact& x = table->at(a);
+            const Contact& y = table->at(b);
+            int cmp = compare_ci(x.last_name, y.last_name);
+            if (cmp == 0)
+                cmp = compare_ci(x.first_name, y.first_name);
+            return cmp != 0 ? cmp < 0 : a < b;
+        }
+    };
+
+    mutable std::shared_mutex mutex;
+    // Writers wait while any handle holds lock_contacts_for_read()
+    std::condition_variable_any unlocked;
+    int read_locks = 0;
+
+    Table table;
+    std::size_t count = 0;
+    std::set<ContactId, NameLess> by_name{NameLess{&table}};
+    std::unordered_map<std::string, std::map<std::uint64_t, ImportBatchRange>> journals;
+    UpdateClock clock;
+
+    std::unique_lock<std::shared_mutex> lock_for_write()
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        unlocked.wait(lock, [this]() { return read_locks == 0; });
+        return lock;
+    }
+
+    // Expects the write lock
+    void add(Contact contact, std::string updated_at)
+    {
+        contact.updated_at = std::move(updated_at);
+        Contact& stored = table.append(std::move(contact));
+        by_name.insert(stored.id);
+        ++count;
+    }
+};
+
+// -----------------------------
+// Constructor
+// -----------------------------
+InMemoryStore::InMemoryStore()
+: m_state(std::make_shared<State>())
+{
+}
+
+InMemoryStore::InMemoryStore(std::shared_ptr<State> state)
+: m_state(std::move(state))
+{
+}
+
+InMemoryStore::~InMemoryStore()
+{
+    unlock_tables();
+}
+
+std::unique_ptr<ContactStore> InMemoryStore::clone() const
+{
+    return std::unique_ptr<ContactStore>(new InMemoryStore(m_state));
+}
+
+std::shared_ptr<const InMemoryStore::Table> InMemoryStore::rows() const
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_snapshot)
+            return m_snapshot;
+    }
+    std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+    return std::make_shared<const Table>(m_state->table);
+}
+
+// -----------------------------
+// CRUD
+// -----------------------------
+Contact InMemoryStore::insert_contact(const std::string& first,
+                                      const std::string& last,
+                                      const std::string& email,
+                                      const std::string& mobile)
+{
+    validate_contact(first, last, email);
+
+    auto lock = m_state->lock_for_write();
+    m_state->add(Contact{0, first, last, email, mobile}, m_state->clock.next());
+    return m_state->table.at(m_state->table.next_id - 1);
+}
+
+Contact InMemoryStore::update_contact(ContactId id,
+                                      const std::string& first,
+                                      const std::string& last,
+                                      const std::string& email,
+                                      const std::string& mobile)
+{
+    validate_contact(first, last, email);
+
+    auto lock = m_state->lock_for_write();
+    if (!m_state->table.find(id)) {
+        throw DBException("Contact not found with ID: " + std::to_string(id));
+    }
+    // The index is ordered by these fields, so the row leaves it while they change
+    m_state->by_name.erase(id);
+    Contact& row = m_state->table.writable_row(id);
+    row = Contact{id, first, last, email, mobile, m_state->clock.next()};
+    m_state->by_name.insert(id);
+    return row;
+}
+
+void InMemoryStore::delete_contact(ContactId id)
+{
+    auto lock = m_state->lock_for_write();
+    if (!m_state->table.find(id)) {
+        throw DBException("Contact not found with ID: " + std::to_string(id));
+    }
+    m_state->by_name.erase(id);
+    m_state->table.writable_row(id) = Contact{0, {}, {}, {}, {}};
+    --m_state->count;
+}
+
+std::optional<Contact> InMemoryStore::get_contact_by_id(ContactId id)
+{
+    std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+    if (const Contact* row = m_state->table.find(id))
+        return *row;
+    return std::nullopt;
+}
+
+std::optional<Contact> InMemoryStore::get_contact_if_changed(ContactId id, const std::string& known_updated_at)
+{
+    std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+    const Contact* row = m_state->table.find(id);
+    if (row && row->updated_at != known_updated_at)
+        return *row;
+    return std::nullopt;
+}
+
+// -----------------------------
+// List reads
+// -----------------------------
+std::vector<Contact> InMemoryStore::get_all_contacts() const
+{
+    return get_contacts_page(0, 0);
+}
+
+std::vector<Contact> InMemoryStore::get_contacts_page(std::size_t offset, std::size_t limit) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+
+    std::vector<Contact> contacts;
+    if (offset >= m_state->count)
+        return contacts;
+    std::size_t rows = m_state->count - offset;
+    if (limit != 0)
+        rows = std::min(rows, limit);
+    contacts.reserve(rows);
+
+    auto it = std::next(m_state->by_name.begin(), static_cast<std::ptrdiff_t>(offset));
+    for (; rows > 0; --rows, ++it)
+        contacts.push_back(m_state->table.at(*it));
+    return contacts;
+}
+
+void InMemoryStore::get_contacts_page(std::size_t offset, std::size_t limit, ContactTable& out) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+
+    if (offset >= m_state->count)
+        return;
+    std::size_t rows = m_state->count - offset;
+    if (limit != 0)
+        rows = std::min(rows, limit);
+
+    auto it = std::next(m_state->by_name.begin(), static_cast<std::ptrdiff_t>(offset));
+    for (; rows > 0; --rows, ++it)
+        out.append(m_state->table.at(*it));
+}
+
+void InMemoryStore::get_contacts_page_after(const Contact& after, std::size_t limit, ContactTable& out) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+
+    const ContactLess by_name("last_name", true);
+    std::size_t rows = 0;
+    for (ContactId id : m_state->by_name) {
+        const Contact& row = m_state->table.at(id);
+        if (!by_name(after, row))
+            continue;
+        out.append(row);
+        if (++rows == limit)
+            return;
+    }
+}
+
+std::pmr::vector<PmrContact> InMemoryStore::get_contacts_page(std::size_t offset,
+                                                              std::size_t limit,
+                                                              std::pmr::memory_resource* mr) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+
+    std::pmr::vector<PmrContact> contacts(mr);
+    if (offset >= m_state->count)
+        return contacts;
+    std::size_t rows = m_state->count - offset;
+    if (limit != 0)
+        rows = std::min(rows, limit);
+    contacts.reserve(rows);
+
+    auto it = std::next(m_state->by_name.begin(), static_cast<std::ptrdiff_t>(offset));
+    for (; rows > 0; --rows, ++it)
+        contacts.emplace_back().assign(m_state->table.at(*it));
+    return contacts;
+}
+
+std::vector<Contact> InMemoryStore::search_contacts(const std::string& query) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+
+    std::vector<Contact> contacts;
+    for (ContactId id : m_state->by_name) {
+        const Contact& row = m_state->table.at(id);
+        if (matches_search(row, query))
+            contacts.push_back(row);
+    }
+    return contacts;
+}
+
+std::pmr::vector<PmrContact> InMemoryStore::search_contacts(const std::string& query,
+                                                            std::pmr::memory_resource* mr) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+
+    std::pmr::vector<PmrContact> contacts(mr);
+    for (ContactId id : m_state->by_name) {
+        const Contact& row = m_state->table.at(id);
+        if (matches_search(row, query))
+            contacts.emplace_back().assign(row);
+    }
+    return contacts;
+}
+
+std::vector<Contact> InMemoryStore::get_contacts_sorted(const std::string& column, bool ascending) const
+{
+    std::vector<Contact> contacts;
+    stream_contacts(ContactQuery{{}, column, ascending}, [&](const Contact& c) {
+        contacts.push_back(c);
+        return true;
+    });
+    return contacts;
+}
+
+std::vector<Contact> InMemoryStore::get_contacts_by_domain(const std::string& domain) const
+{
+    std::vector<Contact> contacts;
+    std::string_view name = domain;
+    if (!name.empty() && name[0] == '@')
+        name.remove_prefix(1);
+    if (name.empty())
+        return contacts;
+
+    std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+    for (ContactId id : m_state->by_name) {
+        const Contact& row = m_state->table.at(id);
+        if (compare_ci(email_domain(row.email), name) == 0)
+            contacts.push_back(row);
+    }
+    return contacts;
+}
+
+int InMemoryStore::get_contact_count() const
+{
+    std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+    return static_cast<int>(m_state->count);
+}
+
+// -----------------------------
+// Stream contacts
+// -----------------------------
+// Streams visit captured rows without holding the lock, so there is no
+// fetch window to size
+std::size_t InMemoryStore::stream_contacts(const IdRange& ids,
+                                           const std::function<bool(const Contact&)>& visit,
+                                           std::size_t /*fetch_size*/) const
+{
+    auto table = rows();
+
+    std::size_t visited = 0;
+    ContactId first = std::max(ids.first, table->first_id);
+    ContactId last = std::min(ids.last, table->next_id - 1);
+    for (ContactId id = first; id <= last; ++id) {
+        const Contact& row = table->at(id);
+        if (row.id == 0)
+            continue;
+        ++visited;
+        if (!visit(row))
+            break;
+    }
+    return visited;
+}
+
+std::size_t InMemoryStore::stream_contacts(const ContactQuery& query,
+                                           const std::function<bool(const Contact&)>& visit,
+                                           std::size_t /*fetch_size*/) const
+{
+    auto table = rows();
+
+    std::vector<const Contact*> view;
+    for (const auto& chunk : table->chunks) {
+        for (const Contact& row : *chunk) {
+            if (row.id != 0 && matches_search(row, query.search))
+                view.push_back(&row);
+        }
+    }
+    ContactLess less(query.sort_column, query.ascending);
+    std::sort(view.begin(), view.end(), [&less](const Contact* a, const Contact* b) {
+        return less(*a, *b);
+    });
+
+    std::size_t visited = 0;
+    for (const Contact* row : view) {
+        ++visited;
+        if (!visit(*row))
+            break;
+    }
+    return visited;
+}
+
+std::optional<IdRange> InMemoryStore::get_id_bounds() const
+{
+    std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+    if (m_state->count == 0)
+        return std::nullopt;
+
+    const Table& table = m_state->table;
+    IdRange bounds{table.first_id, table.next_id - 1};
+    while (table.at(bounds.first).id == 0)
+        ++bounds.first;
+    while (table.at(bounds.last).id == 0)
+        --bounds.last;
+    return bounds;
+}
+
+std::vector<Contact> InMemoryStore::get_contacts_updated_since(const std::string& since) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+
+    std::vector<Contact> contacts;
+    for (const auto& chunk : m_state->table.chunks) {
+        for (const Contact& row : *chunk) {
+            if (row.id != 0 && row.updated_at >= since)
+                contacts.push_back(row);
+        }
+    }
+    return contacts;
+}
+
+std::vector<ContactId> InMemoryStore::get_contact_ids() const
+{
+    std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+
+    std::vector<ContactId> ids;
+    ids.reserve(m_state->count);
+    for (const auto& chunk : m_state->table.chunks) {
+        for (const Contact& row : *chunk) {
+            if (row.id != 0)
+                ids.push_back(row.id);
+        }
+    }
+    return ids;
+}
+
+std::vector<Contact> InMemoryStore::get_contacts_by_ids(const std::vector<ContactId>& ids) const
+{
+    std::vector<ContactId> sorted(ids);
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+    std::vector<Contact> contacts;
+    for (ContactId id : sorted) {
+        if (const Contact* row = m_state->table.find(id))
+            contacts.push_back(*row);
+    }
+    return contacts;
+}
+
+// -----------------------------
+// Snapshots
+// -----------------------------
+bool InMemoryStore::lock_contacts_for_read()
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    if (!m_locked) {
+        std::unique_lock<std::shared_mutex> lock(m_state->mutex);
+        ++m_state->read_locks;
+        m_locked = true;
+    }
+    return true;
+}
+
+void InMemoryStore::unlock_tables()
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    if (m_locked) {
+        {
+            std::unique_lock<std::shared_mutex> lock(m_state->mutex);
+            --m_state->read_locks;
+        }
+        m_state->unlocked.notify_all();
+        m_locked = false;
+    }
+}
+
+void InMemoryStore::begin_snapshot()
+{
+    std::shared_ptr<const Table> snapshot;
+    {
+        std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+        snapshot = std::make_shared<const Table>(m_state->table);
+    }
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_snapshot = std::move(snapshot);
+}
+
+void InMemoryStore::end_snapshot()
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_snapshot.reset();
+}
+
+// -----------------------------
+// Bulk operations
+// -----------------------------
+void InMemoryStore::delete_all_contacts()
+{
+    auto lock = m_state->lock_for_write();
+    Table& table = m_state->table;
+    table.chunks.clear();
+    table.first_id = table.next_id;
+    m_state->by_name.clear();
+    m_state->count = 0;
+}
+
+void InMemoryStore::insert_batch(const std::vector<Contact>& contacts)
+{
+    auto lock = m_state->lock_for_write();
+    // One transaction, one timestamp
+    std::string now = m_state->clock.next();
+    for (const auto& c : contacts)
+        m_state->add(Contact{0, c.first_name, c.last_name, c.email, c.mobile}, now);
+}
+
+bool InMemoryStore::insert_batch(const std::vector<Contact>& contacts,
+                                 const std::string& job_key,
+                                 const ImportBatchRange& range,
+                                 std::uint64_t /*batch_no*/)
+{
+    auto lock = m_state->lock_for_write();
+    auto& journal = m_state->journals[job_key];
+    if (!journal.emplace(range.start, range).second)
+        return false;
+    std::string now = m_state->clock.next();
+    for (const auto& c : contacts)
+        m_state->add(Contact{0, c.first_name, c.last_name, c.email, c.mobile}, now);
+    return true;
+}
+
+ImportJournal InMemoryStore::load_import_journal(const std::string& job_key) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+
+    std::vector<ImportBatchRange> ranges;
+    auto it = m_state->journals.find(job_key);
+    if (it != m_state->journals.end()) {
+        for (const auto& entry : it->second)
+            ranges.push_back(entry.second);
+    }
+    return ImportJournal(std::move(ranges));
+}
+
+void InMemoryStore::finish_import_job(const std::string& job_key)
+{
+    auto lock = m_state->lock_for_write();
+    m_state->journals.erase(job_key);
+}
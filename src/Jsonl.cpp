@@ -0,0 +1,395 @@
+#include "Jsonl.hpp"
+#include "ContactFields.hpp"
+#include <charconv>
+#include <cstring>
+
+namespace {
+
+// Give parsed pages back once this much has been consumed since the last time
+constexpr std::size_t kReleaseStride = 32u << 20;
+
+// key is column in camelCase: "firstName" for "first_name"
+bool camel_case_name(const char* column, std::string_view key)
+{
+    std::size_t k = 0;
+    for (const char* c = column; *c != '\0'; ++c) {
+        char expected = *c;
+        if (expected == '_') {
+            if (*++c == '\0')
+                return false;
+            expected = static_cast<char>(*c - 'a' + 'A');
+        }
+        if (k == key.size() || key[k++] != expected)
+            return false;
+    }
+    return k == key.size();
+}
+
+void append_utf8(std::string& out, std::uint32_t cp)
+{
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    }
+    else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+// Four hex digits at s[i]; -1 if malformed
+long hex4(std::string_view s, std::size_t i)
+{
+    if (i + 4 > s.size())
+        return -1;
+    long v = 0;
+    for (std::size_t k = i; k < i + 4; ++k) {
+        char c = s[k];
+        v <<= 4;
+        if (c >= '0' && c <= '9') v |= c - '0';
+        else if (c >= 'a' && c <= 'f') v |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') v |= c - 'A' + 10;
+        else return -1;
+    }
+    return v;
+}
+
+// Cursor over one line of JSON
+class JsonCursor {
+public:
+    explicit JsonCursor(std::string_view text) : m_text(text) {}
+
+    void skip_ws()
+    {
+        while (m_pos < m_text.size() &&
+               (m_text[m_pos] == ' ' || m_text[m_pos] == '\t' || m_text[m_pos] == '\r' || m_text[m_pos] == '\n'))
+            ++m_pos;
+    }
+
+    bool consume(char c)
+    {
+        skip_ws();
+        if (m_pos < m_text.size() && m_text[m_pos] == c) {
+            ++m_pos;
+            return true;
+        }
+        return false;
+    }
+
+    bool at_end()
+    {
+        skip_ws();
+        return m_pos == m_text.size();
+    }
+
+    char peek()
+    {
+        skip_ws();
+        return m_pos < m_text.size() ? m_text[m_pos] : '\0';
+    }
+
+    // Expects the opening quote at the cursor
+    bool string(JsonString& out)
+    {
+        if (!consume('"'))
+            return false;
+        std::size_t start = m_pos;
+        out.has_escapes = false;
+        for (;;) {
+            // Jump straight to the next quote; only strings with a
+            // backslash before it need a closer look
+            const void* hit = std::memchr(m_text.data() + m_pos, '"', m_text.size() - m_pos);
+            if (!hit)
+                return false;
+            std::size_t quote = static_cast<std::size_t>(static_cast<const char*>(hit) - m_text.data());
+            std::size_t slashes = 0;
+            while (quote - slashes > start && m_text[quote - slashes - 1] == '\\')
+                ++slashes;
+            if (!out.has_escapes)
+                out.has_escapes = std::memchr(m_text.data() + m_pos, '\\', quote - m_pos) != nullptr;
+            m_pos = quote + 1;
+            if (slashes % 2 == 0) {
+                out.raw = m_text.substr(start, quote - start);
+                return true;
+            }
+        }
+    }
+
+    // Skip any value: string, number, literal, object or array
+    bool skip_value()
+    {
+        char c = peek();
+        if (c == '"') {
+            JsonString ignored;
+            return string(ignored);
+        }
+        if (c == '{' || c == '[') {
+            int depth = 0;
+            while (m_pos < m_text.size()) {
+                char ch = m_text[m_pos];
+                if (ch == '"') {
+                    JsonString ignored;
+                    if (!string(ignored))
+                        return false;
+                    continue;
+                }
+                ++m_pos;
+                if (ch == '{' || ch == '[')
+                    ++depth;
+                else if ((ch == '}' || ch == ']') && --depth == 0)
+                    return true;
+            }
+            return false;
+        }
+        // Number or literal: runs to the next delimiter
+        std::size_t start = m_pos;
+        while (m_pos < m_text.size() && m_text[m_pos] != ',' && m_text[m_pos] != '}' &&
+               m_text[m_pos] != ']' && m_text[m_pos] != ' ' && m_text[m_pos] != '\t')
+            ++m_pos;
+        return m_pos > start;
+    }
+
+private:
+    std::string_view m_text;
+    std::size_t m_pos = 0;
+};
+
+void assign(std::string& field, const JsonString& value)
+{
+    if (value.has_escapes)
+        field = value.str();
+    else
+        field.assign(value.raw);
+}
+
+} // namespace
+
+// -----------------------------
+// JsonString
+// -----------------------------
+std::string JsonString::str() const
+{
+    if (!has_escapes)
+        return std::string(raw);
+
+    std::string out;
+    out.reserve(raw.size());
+    for (std::size_t i = 0; i < raw.size(); ++i) {
+        char c = raw[i];
+        if (c != '\\' || i + 1 == raw.size()) {
+            out += c;
+            continue;
+        }
+        char e = raw[++i];
+        switch (e) {
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        case 't': out += '\t'; break;
+        case 'u': {
+            long cp = hex4(raw, i + 1);
+            if (cp < 0) {
+                out += "\xEF\xBF\xBD";
+                break;
+            }
+            i += 4;
+            // A high surrogate must be followed by \uDC00-\uDFFF
+            if (cp >= 0xD800 && cp <= 0xDBFF) {
+                long low = (i + 2 < raw.size() && raw[i + 1] == '\\' && raw[i + 2] == 'u') ? hex4(raw, i + 3) : -1;
+                if (low >= 0xDC00 && low <= 0xDFFF) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    i += 6;
+                }
+                else {
+                    cp = 0xFFFD;
+                }
+            }
+            else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                cp = 0xFFFD;
+            }
+            append_utf8(out, static_cast<std::uint32_t>(cp));
+            break;
+        }
+        default:
+            out += e; // \" \\ \/
+        }
+    }
+    return out;
+}
+
+// -----------------------------
+// Record decoding
+// -----------------------------
+bool parse_contact_json(std::string_view line, Contact& contact)
+{
+    JsonCursor json(line);
+    contact = Contact{0, {}, {}, {}, {}};
+    if (!json.consume('{'))
+        return false;
+    if (json.consume('}'))
+        return json.at_end();
+
+    do {
+        JsonString key;
+        if (!json.string(key) || !json.consume(':'))
+            return false;
+
+        std::string* field = nullptr;
+        std::string_view k = key.raw;
+        contact_fields::for_each<contact_fields::editable>([&](const auto& f) {
+            if (!field && contact_fields::same_name(f.name, k))
+                field = &f.get(contact);
+        });
+        if (!field) {
+            contact_fields::for_each<contact_fields::editable>([&](const auto& f) {
+                if (!field && camel_case_name(f.name, k))
+                    field = &f.get(contact);
+            });
+        }
+
+        if (field && json.peek() == '"') {
+            JsonString value;
+            if (!json.string(value))
+                return false;
+            assign(*field, value);
+        }
+        else if (!json.skip_value()) {
+            return false; // other members, and null contact fields, are skipped
+        }
+    } while (json.consume(','));
+
+    return json.consume('}') && json.at_end();
+}
+
+// -----------------------------
+// JsonlContactSource
+// -----------------------------
+JsonlContactSource::JsonlContactSource(MappedFile& file)
+: m_file(&file)
+{
+    m_file->advise_sequential();
+}
+
+JsonlContactSource::JsonlContactSource(std::unique_ptr<ByteSource> input)
+: m_input(std::move(input))
+{
+    m_lines.emplace(*m_input);
+}
+
+bool JsonlContactSource::next_line(std::string_view& line, std::uint64_t& start)
+{
+    if (m_lines) {
+        start = m_lines->offset();
+        return m_lines->next(line);
+    }
+
+    std::string_view data = m_file->data();
+    if (m_pos >= data.size())
+        return false;
+    start = m_pos;
+    const void* nl = std::memchr(data.data() + m_pos, '\n', data.size() - m_pos);
+    std::size_t end = nl ? static_cast<std::size_t>(static_cast<const char*>(nl) - data.data()) : data.size();
+    line = data.substr(m_pos, end - m_pos);
+    m_pos = nl ? end + 1 : end;
+
+    if (m_pos - m_released >= kReleaseStride) {
+        m_file->release(m_released, m_pos - m_released);
+        m_released = m_pos;
+    }
+    return true;
+}
+
+bool JsonlContactSource::next(Contact& contact)
+{
+    std::string_view line;
+    std::uint64_t start = 0;
+    while (next_line(line, start)) {
+        // Skip a UTF-8 byte order mark
+        if (start == 0 && line.size() >= 3 && std::memcmp(line.data(), "\xEF\xBB\xBF", 3) == 0)
+            line.remove_prefix(3);
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        if (line.find_first_not_of(" \t") == std::string_view::npos)
+            continue; // blank line
+
+        if (parse_contact_json(line, contact) && is_importable(contact)) {
+            m_record_offset = start;
+            return true;
+        }
+        ++m_rejected;
+    }
+    return false;
+}
+
+std::uint64_t JsonlContactSource::position() const
+{
+    return m_lines ? m_lines->offset() : m_pos;
+}
+
+bool JsonlContactSource::seek(std::uint64_t offset)
+{
+    if (m_lines)
+        return m_lines->skip(offset);
+    if (offset > m_file->size())
+        return false;
+    m_pos = static_cast<std::size_t>(offset);
+    m_released = m_pos;
+    return true;
+}
+
+// -----------------------------
+// JsonlWriter
+// -----------------------------
+void JsonlWriter::write(const Contact& c)
+{
+    char id[24];
+    auto end = std::to_chars(id, id + sizeof(id), c.id).ptr;
+    m_out.write("{\"id\":");
+    m_out.write(std::string_view(id, static_cast<std::size_t>(end - id)));
+    contact_fields::for_each<contact_fields::editable>([&](const auto& f) {
+        m_out.write(",\"");
+        m_out.write(f.name);
+        m_out.write("\":");
+        string(f.get(c));
+    });
+    m_out.write("}\n");
+}
+
+void JsonlWriter::string(std::string_view value)
+{
+    static const char hex[] = "0123456789abcdef";
+    m_out.put('"');
+    std::size_t run = 0;
+    for (std::size_t i = 0; i < value.size(); ++i) {
+        auto c = static_cast<unsigned char>(value[i]);
+        if (c >= 0x20 && c != '"' && c != '\\')
+            continue;
+        // Copy the clean run in one go, then the escape
+        m_out.write(value.substr(run, i - run));
+        run = i + 1;
+        switch (c) {
+        case '"':  m_out.write("\\\""); break;
+        case '\\': m_out.write("\\\\"); break;
+        case '\n': m_out.write("\\n"); break;
+        case '\r': m_out.write("\\r"); break;
+        case '\t': m_out.write("\\t"); break;
+        default: {
+            char esc[] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+            m_out.write(std::string_view(esc, sizeof(esc)));
+        }
+        }
+    }
+    m_out.write(value.substr(run));
+    m_out.put('"');
+}
@@ -0,0 +1,85 @@
+#include "LineReader.hpp"
+#include <algorithm>
+#include <cstring>
+
+LineReader::LineReader(ByteSource& input, std::size_t window_bytes)
+: m_input(input),
+  m_window(std::max<std::size_t>(window_bytes, 4096))
+{
+}
+
+bool LineReader::next(std::string_view& line)
+{
+    std::size_t scanned = m_pos;
+    for (;;) {
+        const char* begin = m_window.data() + scanned;
+        const char* end = m_window.data() + m_filled;
+        const char* brk = std::find_if(begin, end, [](char c) { return c == '\n' || c == '\r'; });
+
+        // A CR at the end of the window may be the first half of a CRLF
+        bool complete = brk != end && (*brk == '\n' || brk + 1 != end || m_eof);
+        if (complete) {
+            std::size_t at = static_cast<std::size_t>(brk - m_window.data());
+            line = std::string_view(m_window.data() + m_pos, at - m_pos);
+            m_pos = at + 1;
+            if (*brk == '\r' && m_pos < m_filled && m_window[m_pos] == '\n')
+                ++m_pos;
+            return true;
+        }
+
+        if (m_eof) {
+            if (m_pos == m_filled)
+                return false;
+            line = std::string_view(m_window.data() + m_pos, m_filled - m_pos);
+            m_pos = m_filled;
+            return true;
+        }
+
+        std::size_t seen = static_cast<std::size_t>(brk - m_window.data()) - m_pos;
+        refill();
+        scanned = m_pos + seen;
+    }
+}
+
+int LineReader::peek()
+{
+    if (m_pos == m_filled && !refill())
+        return -1;
+    return static_cast<unsigned char>(m_window[m_pos]);
+}
+
+bool LineReader::refill()
+{
+    std::size_t unread = m_filled - m_pos;
+    std::memmove(m_window.data(), m_window.data() + m_pos, unread);
+    m_base += m_pos;
+    m_pos = 0;
+    m_filled = unread;
+
+    if (m_filled == m_window.size())
+        m_window.resize(m_window.size() * 2);
+
+    std::size_t before = m_filled;
+    while (!m_eof && m_filled < m_window.size()) {
+        std::size_t n = m_input.read(m_window.data() + m_filled, m_window.size() - m_filled);
+        if (n == 0)
+            m_eof = true;
+        m_filled += n;
+    }
+    return m_filled > before;
+}
+
+bool LineReader::skip(std::uint64_t bytes)
+{
+    if (m_base != 0 || m_filled != 0)
+        return bytes == 0;
+
+    while (m_base < bytes) {
+        std::size_t want = static_cast<std::size_t>(std::min<std::uint64_t>(m_window.size(), bytes - m_base));
+        std::size_t n = m_input.read(m_window.data(), want);
+        if (n == 0)
+            return false;
+        m_base += n;
+    }
+    return true;
+}
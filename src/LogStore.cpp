@@ -0,0 +1,1503 @@
+#include "LogStore.hpp"
+#include "ContactFields.hpp"
+#include "ContactTable.hpp"
+#include "StoreSupport.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+namespace {
+
+constexpr const char* kLogFile = "contacts.log";
+constexpr const char* kIndexFile = "indexes.idx";
+constexpr const char* kLockFile = "LOCK";
+
+// Bump the index magic whenever the name or email order changes. Version 2
+// widened ids to 64 bits; version 1 logs are upgraded on open.
+constexpr char kLogMagic[8] = {'C', 'N', 'T', 'L', 'O', 'G', '0', '2'};
+constexpr char kLogMagicV1[8] = {'C', 'N', 'T', 'L', 'O', 'G', '0', '1'};
+constexpr char kIndexMagic[8] = {'C', 'N', 'T', 'I', 'D', 'X', '0', '2'};
+
+// Every record is [crc32][payload length][type][payload]; the checksum
+// covers the type and the payload. Integers are in host byte order.
+constexpr std::size_t kRecordHeader = 9;
+constexpr std::size_t kMaxRecord = 1u << 30;
+// Compaction packs rows into records of about this size
+constexpr std::size_t kCompactRecordBytes = 4u << 20;
+// Mappings are reserved ahead of the log so appends rarely remap
+constexpr std::size_t kMinMapping = 1u << 30;
+
+enum class RecordType : std::uint8_t {
+    header = 1,     // magic, generation, first id, next id
+    rows = 2,       // optional import batch, then rows (inserts or updates)
+    remove = 3,     // id
+    clear = 4,      // new first id
+    finish_job = 5  // job key
+};
+
+const ContactLess kNameOrder("last_name", true);
+
+struct Location {
+    std::uint64_t offset = 0; // of the encoded row in the log
+    std::uint32_t size = 0;   // 0: no such row
+};
+
+// A row as stored: a 64-bit id, then each text field in kContactFields
+// order (first name, last name, email, mobile, updated_at), each with a
+// 32-bit length
+struct RowView {
+    ContactId id = 0;
+    std::string_view first_name;
+    std::string_view last_name;
+    std::string_view email;
+    std::string_view mobile;
+    std::string_view updated_at;
+
+    Contact to_contact() const
+    {
+        return Contact{id, std::string(first_name), std::string(last_name), std::string(email),
+                       std::string(mobile), std::string(updated_at)};
+    }
+};
+static_assert(sizeof(RowView) == sizeof(ContactId) + contact_fields::count_text() * sizeof(std::string_view),
+              "RowView out of step with kContactFields");
+
+// The two persisted orders: the list's (last name, first name, id), and by email
+struct NameOrder {
+    static std::string_view field(const RowView& r) { return r.last_name; }
+    static bool less(const RowView& a, const RowView& b) { return kNameOrder(a, b); }
+};
+
+struct EmailOrder {
+    static std::string_view field(const RowView& r) { return r.email; }
+    static bool less(const RowView& a, const RowView& b)
+    {
+        int cmp = compare_ci(a.email, b.email);
+        return cmp != 0 ? cmp < 0 : a.id < b.id;
+    }
+};
+
+struct CorruptRecord {};
+
+// Bounds-checked decoding; running off the end means a corrupt record
+class Reader {
+public:
+    Reader(const char* data, std::size_t size) : m_data(data), m_size(size) {}
+
+    std::size_t pos() const { return m_pos; }
+    bool at_end() const { return m_pos == m_size; }
+
+    const char* take(std::size_t n)
+    {
+        if (n > m_size - m_pos)
+            throw CorruptRecord{};
+        const char* p = m_data + m_pos;
+        m_pos += n;
+        return p;
+    }
+
+    template <typename T>
+    T get()
+    {
+        T value;
+        std::memcpy(&value, take(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    std::string_view str()
+    {
+        auto n = get<std::uint32_t>();
+        return {take(n), n};
+    }
+
+    RowView row()
+    {
+        RowView r;
+        r.id = get<ContactId>();
+        contact_fields::for_each_text([&](const auto& f) { f.get(r) = str(); });
+        return r;
+    }
+
+private:
+    const char* m_data;
+    std::size_t m_size;
+    std::size_t m_pos = 0;
+};
+
+template <typename T>
+void put(std::string& out, T value)
+{
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void put_str(std::string& out, std::string_view s)
+{
+    put(out, static_cast<std::uint32_t>(s.size()));
+    out.append(s.data(), s.size());
+}
+
+// The id, then each text field in kContactFields order, with updated_at
+// as given rather than c's
+void put_row(std::string& out, ContactId id, const Contact& c, const std::string& updated_at)
+{
+    put(out, id);
+    contact_fields::for_each_text([&](const auto& f) {
+        put_str(out, contact_fields::same_name(f.name, "updated_at") ? std::string_view(updated_at)
+                                                                     : std::string_view(f.get(c)));
+    });
+}
+
+// Starts a record in out; finish_record fills in its header
+std::size_t begin_record(std::string& out, RecordType type)
+{
+    std::size_t start = out.size();
+    out.append(kRecordHeader - 1, '\0');
+    out.push_back(static_cast<char>(type));
+    return start;
+}
+
+void finish_record(std::string& out, std::size_t start)
+{
+    auto length = static_cast<std::uint32_t>(out.size() - start - kRecordHeader);
+    auto crc = static_cast<std::uint32_t>(
+        crc32(0, reinterpret_cast<const Bytef*>(out.data() + start + 8), length + 1));
+    std::memcpy(&out[start], &crc, 4);
+    std::memcpy(&out[start + 4], &length, 4);
+}
+
+// The rows part of a rows record: no import batch, then a row count
+void begin_rows(std::string& out, std::uint32_t count)
+{
+    put(out, std::uint32_t{0});
+    put(out, count);
+}
+
+[[noreturn]] void throw_errno(const std::string& what)
+{
+    throw DBException("Log store error: " + what + ": " + std::strerror(errno));
+}
+
+void write_all(int fd, const char* data, std::size_t size)
+{
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            throw_errno("cannot write");
+        }
+        data += n;
+        size -= static_cast<std::size_t>(n);
+    }
+}
+
+void sync_directory(const std::string& dir)
+{
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+}
+
+std::uint64_t new_generation()
+{
+    std::random_device rd;
+    return (static_cast<std::uint64_t>(rd()) << 32) ^ rd() ^
+           static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+}
+
+// A read-only shared mapping of the log, reserved past its end so appends
+// (visible through it at once) seldom need a new one. Readers keep the
+// mapping they started with alive, even across a compaction.
+struct Mapping {
+    const char* data = nullptr;
+    std::size_t length = 0;
+
+    Mapping(int fd, std::size_t length)
+    : length(length)
+    {
+        void* addr = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED)
+            throw_errno("cannot map the log");
+        data = static_cast<const char*>(addr);
+    }
+    ~Mapping() { ::munmap(const_cast<char*>(data), length); }
+
+    Mapping(const Mapping&) = delete;
+    Mapping& operator=(const Mapping&) = delete;
+};
+
+} // namespace
+
+// The rows reads see: a mapping of the log and where each id's row is in it
+struct LogStore::View {
+    std::shared_ptr<const Mapping> map;
+    std::vector<Location> ids; // indexed by id - first_id
+    ContactId first_id = 1;
+
+    const Location* find(ContactId id) const
+    {
+        if (id < first_id || id - first_id >= ids.size())
+            return nullptr;
+        const Location& loc = ids[static_cast<std::size_t>(id - first_id)];
+        return loc.size != 0 ? &loc : nullptr;
+    }
+
+    RowView row(const Location& loc) const
+    {
+        return Reader(map->data + loc.offset, loc.size).row();
+    }
+
+    RowView row(ContactId id) const { return row(ids[static_cast<std::size_t>(id - first_id)]); }
+
+    template <typename Fn>
+    void for_each_id(Fn fn) const
+    {
+        for (std::size_t i = 0; i < ids.size(); ++i) {
+            if (ids[i].size != 0)
+                fn(first_id + i);
+        }
+    }
+};
+
+namespace {
+
+// Live ids in one Order. Each entry carries its row's folded field prefix,
+// so most comparisons are settled without reading rows out of the log.
+// A row must leave the index before its location changes.
+template <typename Order, typename View>
+class OrderIndex {
+public:
+    struct Key {
+        std::uint64_t prefix;
+        ContactId id;
+    };
+
+    explicit OrderIndex(const View* view) : m_view(view), m_set(Less{view}) {}
+
+    void insert(ContactId id) { m_set.insert(key(id)); }
+    void erase(ContactId id) { m_set.erase(key(id)); }
+    void clear() { m_set.clear(); }
+    std::size_t size() const { return m_set.size(); }
+
+    // Replace the contents with ids in any order
+    void build(const std::vector<ContactId>& ids)
+    {
+        std::vector<Key> keys;
+        keys.reserve(ids.size());
+        for (ContactId id : ids)
+            keys.push_back(key(id));
+        std::sort(keys.begin(), keys.end(), Less{m_view});
+        m_set.clear();
+        for (const Key& k : keys)
+            m_set.insert(m_set.end(), k);
+    }
+
+    // Replace the contents with keys already in this order
+    void assign(const std::vector<Key>& keys)
+    {
+        m_set.clear();
+        for (const Key& k : keys)
+            m_set.insert(m_set.end(), k);
+    }
+
+    std::vector<Key> keys() const { return {m_set.begin(), m_set.end()}; }
+
+    std::vector<ContactId> ids() const
+    {
+        std::vector<ContactId> out;
+        out.reserve(m_set.size());
+        for (const Key& k : m_set)
+            out.push_back(k.id);
+        return out;
+    }
+
+    // fn(id) for ids from position offset on, until it returns false
+    template <typename Fn>
+    void visit_from(std::size_t offset, Fn fn) const
+    {
+        if (offset >= m_set.size())
+            return;
+        for (auto it = std::next(m_set.begin(), static_cast<std::ptrdiff_t>(offset)); it != m_set.end(); ++it) {
+            if (!fn(it->id))
+                return;
+        }
+    }
+
+private:
+    struct Less {
+        const View* view;
+        bool operator()(const Key& a, const Key& b) const
+        {
+            if (a.prefix != b.prefix)
+                return a.prefix < b.prefix;
+            return a.id != b.id && Order::less(view->row(a.id), view->row(b.id));
+        }
+    };
+
+    Key key(ContactId id) const { return Key{folded_prefix(Order::field(m_view->row(id))), id}; }
+
+    const View* m_view;
+    std::set<Key, Less> m_set;
+};
+
+} // namespace
+
+struct LogStore::State {
+    std::string dir;
+    LogStoreOptions options;
+    int lock_fd = -1;
+    int fd = -1;
+    std::uint64_t generation = 0;
+    std::uint64_t end = 0;        // committed length of the log
+    std::uint64_t live_bytes = 0; // bytes of rows still current
+
+    mutable std::shared_mutex mutex;
+    // Writers wait while any handle holds lock_contacts_for_read()
+    std::condition_variable_any unlocked;
+    int read_locks = 0;
+
+    View live;
+    ContactId next_id = 1;
+    std::size_t count = 0;
+    // The secondary indexes are maintained only once replay has loaded or
+    // built them
+    bool indexed = false;
+    OrderIndex<NameOrder, View> by_name{&live};
+    OrderIndex<EmailOrder, View> by_email{&live};
+    std::unordered_map<std::string, std::map<std::uint64_t, ImportBatchRange>> journals;
+    UpdateClock clock;
+
+    std::string path(const char* name) const { return dir + "/" + name; }
+
+    std::unique_lock<std::shared_mutex> lock_for_write()
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        unlocked.wait(lock, [this]() { return read_locks == 0; });
+        return lock;
+    }
+
+    ~State()
+    {
+        if (fd >= 0) {
+            save_indexes();
+            ::close(fd);
+        }
+        if (lock_fd >= 0)
+            ::close(lock_fd);
+    }
+
+    void open(const std::string& directory, const LogStoreOptions& opts);
+    void upgrade_v1();
+    void ensure_mapped(std::uint64_t size);
+    void replay();
+    void apply(RecordType type, Reader payload, std::uint64_t payload_offset);
+    void put_row(ContactId id, Location loc);
+    void remove_row(ContactId id);
+    void build_indexes();
+    bool load_indexes(std::uint64_t covered);
+    void save_indexes() const;
+    void append(const std::string& records);
+    void compact();
+    void maybe_compact();
+};
+
+// -----------------------------
+// Opening and replay
+// -----------------------------
+void LogStore::State::open(const std::string& directory, const LogStoreOptions& opts)
+{
+    dir = directory;
+    options = opts;
+    if (::mkdir(dir.c_str(), 0700) != 0 && errno != EEXIST)
+        throw_errno("cannot create " + dir);
+
+    lock_fd = ::open(path(kLockFile).c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (lock_fd < 0)
+        throw_errno("cannot open " + path(kLockFile));
+    if (::flock(lock_fd, LOCK_EX | LOCK_NB) != 0)
+        throw DBException("Log store error: " + dir + " is in use by another process");
+
+    fd = ::open(path(kLogFile).c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (fd < 0)
+        throw_errno("cannot open " + path(kLogFile));
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0)
+        throw_errno("cannot stat " + path(kLogFile));
+    end = static_cast<std::uint64_t>(st.st_size);
+
+    if (end == 0) {
+        generation = new_generation();
+        std::string header;
+        std::size_t start = begin_record(header, RecordType::header);
+        header.append(kLogMagic, sizeof(kLogMagic));
+        put(header, generation);
+        put(header, ContactId{1});
+        put(header, ContactId{1});
+        finish_record(header, start);
+        write_all(fd, header.data(), header.size());
+        if (::fdatasync(fd) != 0)
+            throw_errno("cannot sync the log");
+        sync_directory(dir);
+        end = header.size();
+    }
+    else {
+        upgrade_v1();
+    }
+    replay();
+}
+
+// A version 1 log, with 32-bit ids, is rewritten once in the current
+// format, record for record, and renamed over the original. Like replay it
+// stops at the first torn or corrupt record.
+void LogStore::State::upgrade_v1()
+{
+    Mapping old(fd, static_cast<std::size_t>(end));
+    const char* data = old.data;
+    if (end < kRecordHeader + sizeof(kLogMagicV1) || data[8] != static_cast<char>(RecordType::header) ||
+        std::memcmp(data + kRecordHeader, kLogMagicV1, sizeof(kLogMagicV1)) != 0)
+        return;
+
+    const std::string tmp = path(kLogFile) + ".upgrade";
+    int new_fd = ::open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0600);
+    if (new_fd < 0)
+        throw_errno("cannot create " + tmp);
+
+    try {
+        std::string out;
+        auto widen = [](Reader& in) { return static_cast<ContactId>(in.get<std::int32_t>()); };
+        std::uint64_t offset = 0;
+        while (offset + kRecordHeader <= end) {
+            std::uint32_t crc;
+            std::uint32_t length;
+            std::memcpy(&crc, data + offset, 4);
+            std::memcpy(&length, data + offset + 4, 4);
+            if (length > kMaxRecord || length > end - offset - kRecordHeader ||
+                crc != crc32(0, reinterpret_cast<const Bytef*>(data + offset + 8), length + 1))
+                break;
+
+            auto type = static_cast<RecordType>(data[offset + 8]);
+            Reader in(data + offset + kRecordHeader, length);
+            std::size_t start = begin_record(out, type);
+            try {
+                switch (type) {
+                case RecordType::header:
+                    in.take(sizeof(kLogMagicV1));
+                    out.append(kLogMagic, sizeof(kLogMagic));
+                    put(out, in.get<std::uint64_t>());
+                    put(out, widen(in));
+                    put(out, widen(in));
+                    break;
+                case RecordType::rows: {
+                    std::string_view job = in.str();
+                    put_str(out, job);
+                    if (!job.empty()) {
+                        for (int i = 0; i < 3; ++i)
+                            put(out, in.get<std::uint64_t>());
+                    }
+                    auto rows = in.get<std::uint32_t>();
+                    put(out, rows);
+                    for (std::uint32_t i = 0; i < rows; ++i) {
+                        put(out, widen(in));
+                        for (int f = 0; f < 5; ++f)
+                            put_str(out, in.str());
+                    }
+                    break;
+                }
+                case RecordType::remove:
+                case RecordType::clear:
+                    put(out, widen(in));
+                    break;
+                case RecordType::finish_job:
+                    put_str(out, in.str());
+                    break;
+                default:
+                    throw CorruptRecord{};
+                }
+                if (!in.at_end())
+                    throw CorruptRecord{};
+            }
+            catch (const CorruptRecord&) {
+                out.resize(start);
+                break;
+            }
+            finish_record(out, start);
+            offset += kRecordHeader + length;
+            if (out.size() >= kCompactRecordBytes) {
+                write_all(new_fd, out.data(), out.size());
+                out.clear();
+            }
+        }
+        write_all(new_fd, out.data(), out.size());
+
+        if (::fdatasync(new_fd) != 0)
+            throw_errno("cannot sync " + tmp);
+        if (::rename(tmp.c_str(), path(kLogFile).c_str()) != 0)
+            throw_errno("cannot replace " + path(kLogFile));
+    }
+    catch (...) {
+        ::close(new_fd);
+        ::unlink(tmp.c_str());
+        throw;
+    }
+    sync_directory(dir);
+
+    ::close(fd);
+    fd = new_fd;
+    struct stat st {};
+    ::fstat(fd, &st);
+    end = static_cast<std::uint64_t>(st.st_size);
+    std::cout << "Upgraded " << path(kLogFile) << " to 64-bit contact ids\n";
+}
+
+void LogStore::State::ensure_mapped(std::uint64_t size)
+{
+    if (!live.map || size > live.map->length) {
+        auto length = std::max<std::size_t>(kMinMapping, static_cast<std::size_t>(size) * 2);
+        live.map = std::make_shared<const Mapping>(fd, length);
+    }
+}
+
+// Rebuild the id index from the whole log, checking every record. The first
+// torn or corrupt record ends the log; everything from it on is cut off.
+void LogStore::State::replay()
+{
+    const std::uint64_t file_size = end;
+    ensure_mapped(file_size);
+    const char* data = live.map->data;
+
+    // Saved indexes are valid as of a point in this log; they are loaded
+    // when replay reaches it and kept up to date from there
+    std::uint64_t covered = 0;
+    {
+        int ifd = ::open(path(kIndexFile).c_str(), O_RDONLY | O_CLOEXEC);
+        if (ifd >= 0) {
+            char head[24];
+            if (::pread(ifd, head, sizeof(head), 0) == static_cast<ssize_t>(sizeof(head)) &&
+                std::memcmp(head, kIndexMagic, sizeof(kIndexMagic)) == 0) {
+                std::memcpy(&covered, head + 16, 8);
+            }
+            ::close(ifd);
+        }
+    }
+
+    std::uint64_t offset = 0;
+    while (offset + kRecordHeader <= file_size) {
+        std::uint32_t crc;
+        std::uint32_t length;
+        std::memcpy(&crc, data + offset, 4);
+        std::memcpy(&length, data + offset + 4, 4);
+        if (length > kMaxRecord || length > file_size - offset - kRecordHeader)
+            break;
+        auto actual = static_cast<std::uint32_t>(
+            crc32(0, reinterpret_cast<const Bytef*>(data + offset + 8), length + 1));
+        if (actual != crc)
+            break;
+
+        auto type = static_cast<RecordType>(data[offset + 8]);
+        if (offset == 0 && type != RecordType::header)
+            throw DBException("Log store error: " + path(kLogFile) + " is not a contacts log");
+        if (!indexed && covered != 0 && offset == covered)
+            indexed = load_indexes(covered);
+
+        try {
+            apply(type, Reader(data + offset + kRecordHeader, length), offset + kRecordHeader);
+        }
+        catch (const CorruptRecord&) {
+            break;
+        }
+        offset += kRecordHeader + length;
+    }
+
+    if (offset == 0)
+        throw DBException("Log store error: " + path(kLogFile) + " is not a contacts log");
+    if (offset < file_size) {
+        std::cerr << "Log store: discarding " << (file_size - offset)
+                  << " bytes of incomplete or corrupt records at the end of " << path(kLogFile) << "\n";
+        if (::ftruncate(fd, static_cast<off_t>(offset)) != 0)
+            throw_errno("cannot truncate the log");
+        ::fdatasync(fd);
+    }
+    end = offset;
+
+    if (!indexed && !(covered == end && (indexed = load_indexes(covered))))
+        build_indexes();
+}
+
+void LogStore::State::apply(RecordType type, Reader payload, std::uint64_t payload_offset)
+{
+    switch (type) {
+    case RecordType::header: {
+        if (std::memcmp(payload.take(sizeof(kLogMagic)), kLogMagic, sizeof(kLogMagic)) != 0)
+            throw CorruptRecord{};
+        generation = payload.get<std::uint64_t>();
+        live.first_id = payload.get<ContactId>();
+        next_id = payload.get<ContactId>();
+        break;
+    }
+    case RecordType::rows: {
+        std::string_view job = payload.str();
+        if (!job.empty()) {
+            ImportBatchRange range;
+            range.start = payload.get<std::uint64_t>();
+            range.end = payload.get<std::uint64_t>();
+            range.rows = payload.get<std::uint64_t>();
+            journals[std::string(job)].emplace(range.start, range);
+        }
+        auto rows = payload.get<std::uint32_t>();
+        for (std::uint32_t i = 0; i < rows; ++i) {
+            std::size_t start = payload.pos();
+            ContactId id = payload.row().id;
+            put_row(id, Location{payload_offset + start, static_cast<std::uint32_t>(payload.pos() - start)});
+        }
+        break;
+    }
+    case RecordType::remove:
+        remove_row(payload.get<ContactId>());
+        break;
+    case RecordType::clear:
+        live.ids.clear();
+        live.first_id = next_id = payload.get<ContactId>();
+        count = 0;
+        live_bytes = 0;
+        by_name.clear();
+        by_email.clear();
+        break;
+    case RecordType::finish_job:
+        journals.erase(std::string(payload.str()));
+        break;
+    default:
+        throw CorruptRecord{};
+    }
+    if (!payload.at_end())
+        throw CorruptRecord{};
+}
+
+void LogStore::State::put_row(ContactId id, Location loc)
+{
+    if (id < live.first_id)
+        throw CorruptRecord{};
+    if (id >= next_id)
+        next_id = id + 1;
+    auto slot = static_cast<std::size_t>(id - live.first_id);
+    if (slot >= live.ids.size())
+        live.ids.resize(slot + 1);
+
+    Location& current = live.ids[slot];
+    if (current.size != 0) {
+        // The indexes order by the old row, so it leaves them first
+        if (indexed) {
+            by_name.erase(id);
+            by_email.erase(id);
+        }
+        live_bytes -= current.size;
+    }
+    else {
+        ++count;
+    }
+    current = loc;
+    live_bytes += loc.size;
+    if (indexed) {
+        by_name.insert(id);
+        by_email.insert(id);
+    }
+}
+
+void LogStore::State::remove_row(ContactId id)
+{
+    if (!live.find(id))
+        return;
+    if (indexed) {
+        by_name.erase(id);
+        by_email.erase(id);
+    }
+    Location& current = live.ids[static_cast<std::size_t>(id - live.first_id)];
+    live_bytes -= current.size;
+    current = Location{};
+    --count;
+}
+
+// -----------------------------
+// Secondary indexes
+// -----------------------------
+void LogStore::State::build_indexes()
+{
+    std::vector<ContactId> ids;
+    ids.reserve(count);
+    live.for_each_id([&](ContactId id) { ids.push_back(id); });
+    by_name.build(ids);
+    by_email.build(ids);
+    indexed = true;
+}
+
+// indexes.idx: magic, generation, covered log offset, row count, the name
+// order's keys, the email order's keys, crc32 of everything before it
+bool LogStore::State::load_indexes(std::uint64_t covered)
+{
+    int ifd = ::open(path(kIndexFile).c_str(), O_RDONLY | O_CLOEXEC);
+    if (ifd < 0)
+        return false;
+    std::string file;
+    char buf[1 << 16];
+    for (ssize_t n; (n = ::read(ifd, buf, sizeof(buf))) > 0;)
+        file.append(buf, static_cast<std::size_t>(n));
+    ::close(ifd);
+
+    try {
+        if (file.size() < 4)
+            return false;
+        std::uint32_t crc;
+        std::memcpy(&crc, file.data() + file.size() - 4, 4);
+        if (crc != crc32(0, reinterpret_cast<const Bytef*>(file.data()), static_cast<uInt>(file.size() - 4)))
+            return false;
+
+        Reader in(file.data(), file.size() - 4);
+        if (std::memcmp(in.take(sizeof(kIndexMagic)), kIndexMagic, sizeof(kIndexMagic)) != 0 ||
+            in.get<std::uint64_t>() != generation || in.get<std::uint64_t>() != covered ||
+            in.get<std::uint64_t>() != count)
+            return false;
+
+        // Trust the order, but every id must be a live row
+        auto read_keys = [&](auto& keys) {
+            for (auto& key : keys) {
+                key.prefix = in.get<std::uint64_t>();
+                key.id = in.get<ContactId>();
+                if (!live.find(key.id))
+                    return false;
+            }
+            return true;
+        };
+        std::vector<decltype(by_name)::Key> names(count);
+        std::vector<decltype(by_email)::Key> emails(count);
+        if (!read_keys(names) || !read_keys(emails) || !in.at_end())
+            return false;
+
+        by_name.assign(names);
+        by_email.assign(emails);
+        return by_name.size() == count && by_email.size() == count;
+    }
+    catch (const CorruptRecord&) {
+        return false;
+    }
+}
+
+void LogStore::State::save_indexes() const
+{
+    if (!indexed)
+        return;
+    std::string file;
+    file.reserve(36 + count * 32);
+    file.append(kIndexMagic, sizeof(kIndexMagic));
+    put(file, generation);
+    put(file, end);
+    put(file, static_cast<std::uint64_t>(count));
+    auto put_keys = [&file](const auto& keys) {
+        for (const auto& key : keys) {
+            put(file, key.prefix);
+            put(file, key.id);
+        }
+    };
+    put_keys(by_name.keys());
+    put_keys(by_email.keys());
+    put(file, static_cast<std::uint32_t>(
+        crc32(0, reinterpret_cast<const Bytef*>(file.data()), static_cast<uInt>(file.size()))));
+
+    // Best effort: a missing or stale file only means a rebuild on open
+    std::string tmp = path(kIndexFile) + ".tmp";
+    int ofd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (ofd < 0)
+        return;
+    try {
+        write_all(ofd, file.data(), file.size());
+        ::close(ofd);
+        ::rename(tmp.c_str(), path(kIndexFile).c_str());
+    }
+    catch (const DBException& e) {
+        ::close(ofd);
+        ::unlink(tmp.c_str());
+        std::cerr << e.what() << "\n";
+    }
+}
+
+// -----------------------------
+// Writing
+// -----------------------------
+// Append whole records, then apply them exactly as replay would. A failed
+// write is cut back off so the log never keeps half a record.
+void LogStore::State::append(const std::string& records)
+{
+    try {
+        write_all(fd, records.data(), records.size());
+        if (options.sync && ::fdatasync(fd) != 0)
+            throw_errno("cannot sync the log");
+    }
+    catch (...) {
+        if (::ftruncate(fd, static_cast<off_t>(end)) != 0)
+            std::cerr << "Log store: cannot truncate a failed write: " << std::strerror(errno) << "\n";
+        throw;
+    }
+
+    ensure_mapped(end + records.size());
+    const char* data = live.map->data;
+    std::size_t pos = 0;
+    while (pos < records.size()) {
+        std::uint32_t length;
+        std::memcpy(&length, records.data() + pos + 4, 4);
+        std::uint64_t payload = end + pos + kRecordHeader;
+        apply(static_cast<RecordType>(records[pos + 8]), Reader(data + payload, length), payload);
+        pos += kRecordHeader + length;
+    }
+    end += records.size();
+    maybe_compact();
+}
+
+void LogStore::State::maybe_compact()
+{
+    if (end < options.compact_min_bytes)
+        return;
+    if (static_cast<double>(end - live_bytes) <= options.compact_garbage_ratio * static_cast<double>(end))
+        return;
+    // The write that got here has committed; a failed compaction leaves
+    // the old log in place and is retried after a later write
+    try {
+        compact();
+    }
+    catch (const DBException& e) {
+        std::cerr << e.what() << "\n";
+    }
+}
+
+// Write the live rows and journals to a new log, make it durable, and
+// rename it over the old one. Readers of the old log keep their mapping.
+void LogStore::State::compact()
+{
+    const std::string tmp = path(kLogFile) + ".compact";
+    int new_fd = ::open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0600);
+    if (new_fd < 0)
+        throw_errno("cannot create " + tmp);
+
+    try {
+        const std::uint64_t new_generation_id = new_generation();
+        std::string out;
+        out.reserve(kCompactRecordBytes + (1u << 16));
+        auto flush = [&]() {
+            write_all(new_fd, out.data(), out.size());
+            out.clear();
+        };
+
+        std::size_t start = begin_record(out, RecordType::header);
+        out.append(kLogMagic, sizeof(kLogMagic));
+        put(out, new_generation_id);
+        put(out, live.first_id);
+        put(out, next_id);
+        finish_record(out, start);
+
+        for (const auto& [job, ranges] : journals) {
+            for (const auto& entry : ranges) {
+                start = begin_record(out, RecordType::rows);
+                put_str(out, job);
+                put(out, entry.second.start);
+                put(out, entry.second.end);
+                put(out, static_cast<std::uint64_t>(entry.second.rows));
+                put(out, std::uint32_t{0});
+                finish_record(out, start);
+            }
+        }
+
+        // Rows go in id order, copied as they are encoded
+        std::size_t i = 0;
+        while (i < live.ids.size()) {
+            start = begin_record(out, RecordType::rows);
+            begin_rows(out, 0);
+            std::size_t count_at = out.size() - 4;
+            std::uint32_t rows = 0;
+            for (; i < live.ids.size() && out.size() - start < kCompactRecordBytes; ++i) {
+                const Location& loc = live.ids[i];
+                if (loc.size == 0)
+                    continue;
+                out.append(live.map->data + loc.offset, loc.size);
+                ++rows;
+            }
+            std::memcpy(&out[count_at], &rows, 4);
+            finish_record(out, start);
+            flush();
+        }
+        flush();
+
+        if (::fdatasync(new_fd) != 0)
+            throw_errno("cannot sync " + tmp);
+        if (::rename(tmp.c_str(), path(kLogFile).c_str()) != 0)
+            throw_errno("cannot replace " + path(kLogFile));
+    }
+    catch (...) {
+        ::close(new_fd);
+        ::unlink(tmp.c_str());
+        throw;
+    }
+    sync_directory(dir);
+
+    // Replay the new log; the index orders are unchanged, only where rows
+    // live has moved, so they are carried over instead of rebuilt
+    auto names = by_name.keys();
+    auto emails = by_email.keys();
+    ::close(fd);
+    fd = new_fd;
+    struct stat st {};
+    ::fstat(fd, &st);
+    end = static_cast<std::uint64_t>(st.st_size);
+
+    live.map.reset();
+    live.ids.clear();
+    count = 0;
+    live_bytes = 0;
+    journals.clear();
+    indexed = false;
+    by_name.clear();
+    by_email.clear();
+    ensure_mapped(end);
+    std::uint64_t offset = 0;
+    while (offset < end) {
+        std::uint32_t length;
+        std::memcpy(&length, live.map->data + offset + 4, 4);
+        apply(static_cast<RecordType>(live.map->data[offset + 8]),
+              Reader(live.map->data + offset + kRecordHeader, length), offset + kRecordHeader);
+        offset += kRecordHeader + length;
+    }
+    by_name.assign(names);
+    by_email.assign(emails);
+    indexed = true;
+    save_indexes();
+    std::cout << "Compacted " << path(kLogFile) << " to " << end << " bytes\n";
+}
+
+// -----------------------------
+// Constructor
+// -----------------------------
+LogStore::LogStore(const std::string& dir, LogStoreOptions options)
+: m_state(std::make_shared<State>())
+{
+    m_state->open(dir, options);
+}
+
+LogStore::LogStore(std::shared_ptr<State> state)
+: m_state(std::move(state))
+{
+}
+
+LogStore::~LogStore()
+{
+    unlock_tables();
+}
+
+std::unique_ptr<ContactStore> LogStore::clone() const
+{
+    return std::unique_ptr<ContactStore>(new LogStore(m_state));
+}
+
+std::shared_ptr<const LogStore::View> LogStore::view() const
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_snapshot)
+            return m_snapshot;
+    }
+    std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+    return std::make_shared<const View>(m_state->live);
+}
+
+void LogStore::compact()
+{
+    auto lock = m_state->lock_for_write();
+    m_state->compact();
+}
+
+// -----------------------------
+// CRUD
+// -----------------------------
+Contact LogStore::insert_contact(const std::string& first,
+                                 const std::string& last,
+                                 const std::string& email,
+                                 const std::string& mobile)
+{
+    validate_contact(first, last, email);
+
+    auto lock = m_state->lock_for_write();
+    Contact saved{m_state->next_id, first, last, email, mobile, m_state->clock.next()};
+    std::string record;
+    std::size_t start = begin_record(record, RecordType::rows);
+    begin_rows(record, 1);
+    put_row(record, saved.id, saved, saved.updated_at);
+    finish_record(record, start);
+    m_state->append(record);
+    return saved;
+}
+
+Contact LogStore::update_contact(ContactId id,
+                                 const std::string& first,
+                                 const std::string& last,
+                                 const std::string& email,
+                                 const std::string& mobile)
+{
+    validate_contact(first, last, email);
+
+    auto lock = m_state->lock_for_write();
+    if (!m_state->live.find(id)) {
+        throw DBException("Contact not found with ID: " + std::to_string(id));
+    }
+    Contact saved{id, first, last, email, mobile, m_state->clock.next()};
+    std::string record;
+    std::size_t start = begin_record(record, RecordType::rows);
+    begin_rows(record, 1);
+    put_row(record, id, saved, saved.updated_at);
+    finish_record(record, start);
+    m_state->append(record);
+    return saved;
+}
+
+void LogStore::delete_contact(ContactId id)
+{
+    auto lock = m_state->lock_for_write();
+    if (!m_state->live.find(id)) {
+        throw DBException("Contact not found with ID: " + std::to_string(id));
+    }
+    std::string record;
+    std::size_t start = begin_record(record, RecordType::remove);
+    put(record, id);
+    finish_record(record, start);
+    m_state->append(record);
+}
+
+std::optional<Contact> LogStore::get_contact_by_id(ContactId id)
+{
+    std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+    if (const Location* loc = m_state->live.find(id))
+        return m_state->live.row(*loc).to_contact();
+    return std::nullopt;
+}
+
+std::optional<Contact> LogStore::get_contact_if_changed(ContactId id, const std::string& known_updated_at)
+{
+    std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+    if (const Location* loc = m_state->live.find(id)) {
+        RowView row = m_state->live.row(*loc);
+        if (row.updated_at != known_updated_at)
+            return row.to_contact();
+    }
+    return std::nullopt;
+}
+
+// -----------------------------
+// List reads
+// -----------------------------
+std::vector<Contact> LogStore::get_all_contacts() const
+{
+    return get_contacts_page(0, 0);
+}
+
+std::vector<Contact> LogStore::get_contacts_page(std::size_t offset, std::size_t limit) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+
+    std::vector<Contact> contacts;
+    if (offset >= m_state->count)
+        return contacts;
+    std::size_t rows = m_state->count - offset;
+    if (limit != 0)
+        rows = std::min(rows, limit);
+    contacts.reserve(rows);
+
+    m_state->by_name.visit_from(offset, [&](ContactId id) {
+        contacts.push_back(m_state->live.row(id).to_contact());
+        return contacts.size() < rows;
+    });
+    return contacts;
+}
+
+void LogStore::get_contacts_page(std::size_t offset, std::size_t limit, ContactTable& out) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+
+    if (offset >= m_state->count)
+        return;
+    std::size_t rows = m_state->count - offset;
+    if (limit != 0)
+        rows = std::min(rows, limit);
+
+    // Field bytes go from the mapped log into the table's arena directly
+    m_state->by_name.visit_from(offset, [&](ContactId id) {
+        RowView row = m_state->live.row(id);
+        out.append(row.id, row.first_name, row.last_name, row.email, row.mobile, row.updated_at);
+        return --rows > 0;
+    });
+}
+
+void LogStore::get_contacts_page_after(const Contact& after, std::size_t limit, ContactTable& out) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+
+    std::size_t rows = 0;
+    m_state->by_name.visit_from(0, [&](ContactId id) {
+        RowView row = m_state->live.row(id);
+        if (!kNameOrder(after, row))
+            return true;
+        out.append(row.id, row.first_name, row.last_name, row.email, row.mobile, row.updated_at);
+        return ++rows != limit;
+    });
+}
+
+std::pmr::vector<PmrContact> LogStore::get_contacts_page(std::size_t offset,
+                                                         std::size_t limit,
+                                                         std::pmr::memory_resource* mr) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+
+    std::pmr::vector<PmrContact> contacts(mr);
+    if (offset >= m_state->count)
+        return contacts;
+    std::size_t rows = m_state->count - offset;
+    if (limit != 0)
+        rows = std::min(rows, limit);
+    contacts.reserve(rows);
+
+    m_state->by_name.visit_from(offset, [&](ContactId id) {
+        contacts.emplace_back().assign(m_state->live.row(id));
+        return contacts.size() < rows;
+    });
+    return contacts;
+}
+
+std::vector<Contact> LogStore::search_contacts(const std::string& query) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+
+    std::vector<Contact> contacts;
+    m_state->by_name.visit_from(0, [&](ContactId id) {
+        RowView row = m_state->live.row(id);
+        if (matches_search(row, query))
+            contacts.push_back(row.to_contact());
+        return true;
+    });
+    return contacts;
+}
+
+std::pmr::vector<PmrContact> LogStore::search_contacts(const std::string& query,
+                                                       std::pmr::memory_resource* mr) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+
+    std::pmr::vector<PmrContact> contacts(mr);
+    m_state->by_name.visit_from(0, [&](ContactId id) {
+        RowView row = m_state->live.row(id);
+        if (matches_search(row, query))
+            contacts.emplace_back().assign(row);
+        return true;
+    });
+    return contacts;
+}
+
+std::vector<Contact> LogStore::get_contacts_sorted(const std::string& column, bool ascending) const
+{
+    std::vector<Contact> contacts;
+    stream_contacts(ContactQuery{{}, column, ascending}, [&](const Contact& c) {
+        contacts.push_back(c);
+        return true;
+    });
+    return contacts;
+}
+
+std::vector<Contact> LogStore::get_contacts_by_domain(const std::string& domain) const
+{
+    std::vector<Contact> contacts;
+    std::string_view name = domain;
+    if (!name.empty() && name[0] == '@')
+        name.remove_prefix(1);
+    if (name.empty())
+        return contacts;
+
+    std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+    m_state->by_name.visit_from(0, [&](ContactId id) {
+        RowView row = m_state->live.row(id);
+        if (compare_ci(email_domain(row.email), name) == 0)
+            contacts.push_back(row.to_contact());
+        return true;
+    });
+    return contacts;
+}
+
+int LogStore::get_contact_count() const
+{
+    std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+    return static_cast<int>(m_state->count);
+}
+
+// -----------------------------
+// Stream contacts
+// -----------------------------
+// Streams read from a captured view and hold no lock while visiting, so
+// there is no fetch window to size
+std::size_t LogStore::stream_contacts(const IdRange& ids,
+                                      const std::function<bool(const Contact&)>& visit,
+                                      std::size_t /*fetch_size*/) const
+{
+    auto v = view();
+
+    std::size_t visited = 0;
+    ContactId first = std::max(ids.first, v->first_id);
+    ContactId last = std::min(ids.last, v->first_id + v->ids.size() - 1);
+    for (ContactId id = first; id <= last; ++id) {
+        const Location* loc = v->find(id);
+        if (!loc)
+            continue;
+        ++visited;
+        if (!visit(v->row(*loc).to_contact()))
+            break;
+    }
+    return visited;
+}
+
+std::size_t LogStore::stream_contacts(const ContactQuery& query,
+                                      const std::function<bool(const Contact&)>& visit,
+                                      std::size_t /*fetch_size*/) const
+{
+    ContactLess less(query.sort_column, query.ascending);
+    const bool by_name = less.column() == ContactLess::Column::last_name;
+    const bool by_email = less.column() == ContactLess::Column::email;
+
+    // The live indexes already hold the ascending name and email orders;
+    // a snapshot, or any other order, is sorted here
+    std::shared_ptr<const View> v;
+    std::vector<ContactId> order;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        v = m_snapshot;
+    }
+    if (!v) {
+        std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+        v = std::make_shared<const View>(m_state->live);
+        if (query.ascending && by_name)
+            order = m_state->by_name.ids();
+        else if (query.ascending && by_email)
+            order = m_state->by_email.ids();
+    }
+
+    std::vector<RowView> rows;
+    if (!order.empty()) {
+        for (ContactId id : order) {
+            RowView row = v->row(id);
+            if (matches_search(row, query.search))
+                rows.push_back(row);
+        }
+    }
+    else {
+        v->for_each_id([&](ContactId id) {
+            RowView row = v->row(id);
+            if (matches_search(row, query.search))
+                rows.push_back(row);
+        });
+        std::sort(rows.begin(), rows.end(), less);
+    }
+
+    std::size_t visited = 0;
+    for (const RowView& row : rows) {
+        ++visited;
+        if (!visit(row.to_contact()))
+            break;
+    }
+    return visited;
+}
+
+std::optional<IdRange> LogStore::get_id_bounds() const
+{
+    std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+    if (m_state->count == 0)
+        return std::nullopt;
+
+    const auto& ids = m_state->live.ids;
+    std::size_t first = 0;
+    std::size_t last = ids.size() - 1;
+    while (ids[first].size == 0)
+        ++first;
+    while (ids[last].size == 0)
+        --last;
+    return IdRange{m_state->live.first_id + first, m_state->live.first_id + last};
+}
+
+std::vector<Contact> LogStore::get_contacts_updated_since(const std::string& since) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+
+    std::vector<Contact> contacts;
+    m_state->live.for_each_id([&](ContactId id) {
+        RowView row = m_state->live.row(id);
+        if (row.updated_at >= since)
+            contacts.push_back(row.to_contact());
+    });
+    return contacts;
+}
+
+std::vector<ContactId> LogStore::get_contact_ids() const
+{
+    std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+
+    std::vector<ContactId> ids;
+    ids.reserve(m_state->count);
+    m_state->live.for_each_id([&ids](ContactId id) { ids.push_back(id); });
+    return ids;
+}
+
+std::vector<Contact> LogStore::get_contacts_by_ids(const std::vector<ContactId>& ids) const
+{
+    std::vector<ContactId> sorted(ids);
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+    std::vector<Contact> contacts;
+    for (ContactId id : sorted) {
+        if (const Location* loc = m_state->live.find(id))
+            contacts.push_back(m_state->live.row(*loc).to_contact());
+    }
+    return contacts;
+}
+
+// -----------------------------
+// Snapshots
+// -----------------------------
+bool LogStore::lock_contacts_for_read()
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    if (!m_locked) {
+        std::unique_lock<std::shared_mutex> lock(m_state->mutex);
+        ++m_state->read_locks;
+        m_locked = true;
+    }
+    return true;
+}
+
+void LogStore::unlock_tables()
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    if (m_locked) {
+        {
+            std::unique_lock<std::shared_mutex> lock(m_state->mutex);
+            --m_state->read_locks;
+        }
+        m_state->unlocked.notify_all();
+        m_locked = false;
+    }
+}
+
+void LogStore::begin_snapshot()
+{
+    std::shared_ptr<const View> snapshot;
+    {
+        std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+        snapshot = std::make_shared<const View>(m_state->live);
+    }
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_snapshot = std::move(snapshot);
+}
+
+void LogStore::end_snapshot()
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_snapshot.reset();
+}
+
+// -----------------------------
+// Bulk operations
+// -----------------------------
+void LogStore::delete_all_contacts()
+{
+    auto lock = m_state->lock_for_write();
+    std::string record;
+    std::size_t start = begin_record(record, RecordType::clear);
+    put(record, m_state->next_id);
+    finish_record(record, start);
+    m_state->append(record);
+}
+
+void LogStore::insert_batch(const std::vector<Contact>& contacts)
+{
+    if (contacts.empty())
+        return;
+    auto lock = m_state->lock_for_write();
+    // One record, so the batch commits or is lost as a whole
+    std::string record;
+    std::size_t start = begin_record(record, RecordType::rows);
+    begin_rows(record, static_cast<std::uint32_t>(contacts.size()));
+    std::string now = m_state->clock.next();
+    ContactId id = m_state->next_id;
+    for (const auto& c : contacts)
+        put_row(record, id++, c, now);
+    finish_record(record, start);
+    m_state->append(record);
+}
+
+bool LogStore::insert_batch(const std::vector<Contact>& contacts,
+                            const std::string& job_key,
+                            const ImportBatchRange& range,
+                            std::uint64_t /*batch_no*/)
+{
+    auto lock = m_state->lock_for_write();
+    auto job = m_state->journals.find(job_key);
+    if (job != m_state->journals.end() && job->second.count(range.start))
+        return false;
+
+    std::string record;
+    std::size_t start = begin_record(record, RecordType::rows);
+    put_str(record, job_key);
+    put(record, range.start);
+    put(record, range.end);
+    put(record, static_cast<std::uint64_t>(range.rows));
+    put(record, static_cast<std::uint32_t>(contacts.size()));
+    std::string now = m_state->clock.next();
+    ContactId id = m_state->next_id;
+    for (const auto& c : contacts)
+        put_row(record, id++, c, now);
+    finish_record(record, start);
+    m_state->append(record);
+    return true;
+}
+
+ImportJournal LogStore::load_import_journal(const std::string& job_key) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_state->mutex);
+
+    std::vector<ImportBatchRange> ranges;
+    auto it = m_state->journals.find(job_key);
+    if (it != m_state->journals.end()) {
+        for (const auto& entry : it->second)
+            ranges.push_back(entry.second);
+    }
+    return ImportJournal(std::move(ranges));
+}
+
+void LogStore::finish_import_job(const std::string& job_key)
+{
+    auto lock = m_state->lock_for_write();
+    if (!m_state->journals.count(job_key))
+        return;
+    std::string record;
+    std::size_t start = begin_record(record, RecordType::finish_job);
+    put_str(record, job_key);
+    finish_record(record, start);
+    m_state->append(record);
+}
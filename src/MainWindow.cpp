@@ -1,21 +1,39 @@
 #include "MainWindow.hpp"
 #include "ContactDialogs.hpp"
+#include "ImportPipeline.hpp"
+#include "MappedFile.hpp"
+#include "ContactFormat.hpp"
+#include "Jsonl.hpp"
+#include "StoreSupport.hpp"
 #include <iostream>
-#include <fstream>
-#include <sstream>
+#include <numeric>
+#include <algorithm>
+#include <filesystem>
+#include <iterator>
+#include <memory_resource>
 
-MainWindow::MainWindow(std::shared_ptr<DB> db)
-: m_db(db)
-{
-    set_title("Contacts Database Manager");
-    set_default_size(900, 600);
+namespace {
 
-    // Initialize database schema
+// Rows shown from a snapshot before the rest is decoded behind them
+constexpr std::size_t kSnapshotFirstPage = 200;
+
+// A snapshot is only a cache: failing to save one is not worth a dialog
+template <typename Rows>
+void write_snapshot(const std::string& source, const Rows& rows)
+{
     try {
-        m_db->initialize_schema();
-    } catch (const DBException& e) {
-        show_error("Failed to initialize database: " + std::string(e.what()));
+        ContactSnapshot::write(source, rows);
+    } catch (const std::exception& e) {
+        std::cerr << "Could not save contact snapshot: " << e.what() << "\n";
     }
+}
+
+} // namespace
+
+MainWindow::MainWindow()
+{
+    set_title("Contacts Database Manager");
+    set_default_size(900, 600);
 
     // Setup list store and tree view
     m_ref_list_store = Gtk::ListStore::create(m_columns);
@@ -44,7 +62,7 @@ MainWindow::MainWindow(std::shared_ptr<DB> db)
     auto* search_label = Gtk::make_managed<Gtk::Label>("Search:");
     m_toolbar_box.append(*search_label);
     m_search_entry.set_hexpand(true);
-    m_search_entry.set_placeholder_text("Search contacts...");
+    m_search_entry.set_placeholder_text("Search contacts, or @domain...");
     m_toolbar_box.append(m_search_entry);
     m_toolbar_box.append(m_clear_search_button);
 
@@ -96,16 +114,176 @@ MainWindow::MainWindow(std::shared_ptr<DB> db)
     m_status_box.set_margin_start(10);
     m_status_box.append(m_status_label);
 
+    // Loading banner, shown until the first page of contacts arrives
+    m_loading_box.set_spacing(10);
+    m_loading_box.set_margin_start(10);
+    m_loading_box.set_margin_end(10);
+    m_loading_box.append(m_loading_spinner);
+    m_loading_label.set_hexpand(true);
+    m_loading_label.set_halign(Gtk::Align::START);
+    m_loading_box.append(m_loading_label);
+    m_loading_box.append(m_loading_cancel_button);
+    m_loading_cancel_button.signal_clicked().connect([this](){
+        if (m_on_cancel_loading)
+            m_on_cancel_loading();
+    });
+
     // Assemble main layout
     m_main_box.append(m_toolbar_box);
+    m_main_box.append(m_loading_box);
     m_main_box.append(m_scrolled_window);
     m_main_box.append(m_button_box);
     m_main_box.append(m_status_box);
 
     set_child(m_main_box);
 
-    refresh_list();
-    update_status();
+    show_loading("Connecting to database...");
+}
+
+//-------------------- Startup --------------------
+
+void MainWindow::show_loading(const std::string& message)
+{
+    set_controls_sensitive(false);
+    m_loading_label.set_text(message);
+    m_loading_spinner.start();
+    m_loading_box.set_visible(true);
+    m_status_label.set_text(message);
+}
+
+void MainWindow::set_on_cancel_loading(std::function<void()> on_cancel)
+{
+    m_on_cancel_loading = std::move(on_cancel);
+}
+
+void MainWindow::attach_database(std::shared_ptr<ContactStore> db,
+                                 ContactTable first_page,
+                                 int total_contacts)
+{
+    m_db = std::move(db);
+    finish_loading();
+
+    m_total_contacts = total_contacts;
+    adjust_status(0);
+
+    std::size_t loaded = first_page.size();
+    Contact last_shown = loaded ? first_page.contact(loaded - 1) : Contact{};
+    std::string source = m_snapshot_source;
+    ContactTable snapshot_rows;
+    if (!source.empty())
+        snapshot_rows = first_page;
+    show_rows(std::move(first_page));
+
+    // The window is usable now; fetch the rest of the list behind it,
+    // reading on from the last row shown so rows written meanwhile are
+    // neither skipped nor repeated. To snapshot the whole list the rest
+    // goes in after a copy of the first page, which the window then skips.
+    if (loaded < static_cast<std::size_t>(total_contacts)) {
+        auto db_ref = m_db;
+        std::size_t skip = source.empty() ? 0 : loaded;
+        m_list_loader.run(
+            [db_ref, last_shown, source, rows = std::move(snapshot_rows)](const TaskContext& ctx) mutable {
+                db_ref->get_contacts_page_after(last_shown, 0, rows);
+                if (!source.empty() && !ctx.cancelled())
+                    write_snapshot(source, rows);
+                return std::move(rows);
+            },
+            [this, skip](ContactTable rows) {
+                append_rows(std::move(rows), skip);
+            },
+            [this](const std::string& error) {
+                show_error("Failed to load contacts: " + error);
+            });
+    } else if (!source.empty()) {
+        m_snapshot_writer.run(
+            [source, rows = std::move(snapshot_rows)](const TaskContext&) { write_snapshot(source, rows); },
+            []() {});
+    }
+}
+
+void MainWindow::set_snapshot_source(std::string source)
+{
+    m_snapshot_source = std::move(source);
+}
+
+void MainWindow::show_snapshot(std::shared_ptr<const ContactSnapshot> snapshot)
+{
+    m_snapshot = std::move(snapshot);
+    m_total_contacts = static_cast<int>(m_snapshot->size());
+    ContactTable first_page;
+    m_snapshot->contacts(0, kSnapshotFirstPage, first_page);
+    show_rows(std::move(first_page));
+
+    // Decoding a large snapshot takes a moment; the first page is up already
+    if (m_snapshot->size() > kSnapshotFirstPage) {
+        auto snapshot_ref = m_snapshot;
+        m_snapshot_loading = true;
+        m_list_loader.run(
+            [snapshot_ref](const TaskContext&) {
+                ContactTable rest;
+                snapshot_ref->contacts(kSnapshotFirstPage, snapshot_ref->size(), rest);
+                return rest;
+            },
+            [this](ContactTable rest) {
+                append_rows(std::move(rest));
+                m_snapshot_loading = false;
+                if (m_pending_delta) {
+                    apply_delta(*m_pending_delta);
+                    m_pending_delta.reset();
+                }
+            });
+    }
+}
+
+void MainWindow::attach_database(std::shared_ptr<ContactStore> db,
+                                 SnapshotDelta delta,
+                                 int total_contacts)
+{
+    m_db = std::move(db);
+    finish_loading();
+
+    m_total_contacts = total_contacts;
+    adjust_status(0);
+
+    // The next start should not have to catch up on the same changes
+    if (!m_snapshot_source.empty() && (!delta.changed.empty() || !delta.removed.empty())) {
+        m_snapshot_writer.run(
+            [source = m_snapshot_source, snapshot = m_snapshot, delta](const TaskContext&) {
+                write_snapshot(source, snapshot->apply(delta));
+            },
+            []() {});
+    }
+
+    if (m_snapshot_loading)
+        m_pending_delta = std::move(delta);
+    else
+        apply_delta(delta);
+}
+
+void MainWindow::finish_loading()
+{
+    m_loading_spinner.stop();
+    m_loading_box.set_visible(false);
+    set_controls_sensitive(true);
+}
+
+void MainWindow::apply_delta(const SnapshotDelta& delta)
+{
+    // Past a point one reload is cheaper than patching row by row
+    if (delta.changed.size() + delta.removed.size() > kSnapshotFirstPage + m_rows_by_id.size() / 4) {
+        refresh_list();
+        return;
+    }
+    for (ContactId id : delta.removed)
+        remove_row(id);
+    for (const auto& contact : delta.changed)
+        upsert_row(contact);
+}
+
+void MainWindow::set_controls_sensitive(bool sensitive)
+{
+    m_toolbar_box.set_sensitive(sensitive);
+    m_button_box.set_sensitive(sensitive);
 }
 
 void MainWindow::setup_tree_view_columns()
@@ -114,34 +292,26 @@ void MainWindow::setup_tree_view_columns()
     col_id->set_visible(false);
     m_tree_view.append_column(*col_id);
 
-    auto* col_first = Gtk::manage(new Gtk::TreeViewColumn("First Name", m_columns.col_first));
-    col_first->set_resizable(true);
-    col_first->set_sort_column(m_columns.col_first);
-    m_tree_view.append_column(*col_first);
-
-    auto* col_last = Gtk::manage(new Gtk::TreeViewColumn("Last Name", m_columns.col_last));
-    col_last->set_resizable(true);
-    col_last->set_sort_column(m_columns.col_last);
-    m_tree_view.append_column(*col_last);
-
-    auto* col_email = Gtk::manage(new Gtk::TreeViewColumn("Email", m_columns.col_email));
-    col_email->set_resizable(true);
-    col_email->set_sort_column(m_columns.col_email);
-    m_tree_view.append_column(*col_email);
+    // Header clicks sort the cached rows client-side (see on_column_clicked)
+    std::size_t i = 0;
+    contact_fields::for_each<contact_fields::editable>([this, &i](const auto& f) {
+        auto* col = Gtk::manage(new Gtk::TreeViewColumn(f.title, m_columns.col_fields[i++]));
+        col->set_resizable(true);
+        col->set_clickable(true);
+        std::string db_column = f.name;
+        col->signal_clicked().connect([this, db_column](){ on_column_clicked(db_column); });
+        m_tree_view.append_column(*col);
+    });
 
-    auto* col_mobile = Gtk::manage(new Gtk::TreeViewColumn("Mobile", m_columns.col_mobile));
-    col_mobile->set_resizable(true);
-    col_mobile->set_sort_column(m_columns.col_mobile);
-    m_tree_view.append_column(*col_mobile);
+    update_sort_indicators();
 }
 
 //-------------------- Contact Handlers --------------------
 
 void MainWindow::on_add_contact()
 {
-    auto* dialog = new ContactDialog(*this, *m_db,
-                                    [this](){ refresh_list(); update_status(); },
-                                    false, 0);
+    auto* dialog = new ContactDialog(*this, m_db,
+                                    [this](const Contact& c){ on_contact_saved(c, true); });
     dialog->set_modal(true);
 
     // Use signal_hide to properly cleanup when dialog closes
@@ -154,15 +324,15 @@ void MainWindow::on_add_contact()
 
 void MainWindow::on_edit_contact()
 {
-    auto id = get_selected_id();
-    if (!id) {
+    auto contact = get_selected_contact();
+    if (!contact) {
         show_info("Please select a contact to edit");
         return;
     }
 
-    auto* dialog = new ContactDialog(*this, *m_db,
-                                    [this](){ refresh_list(); update_status(); },
-                                    true, *id);
+    auto* dialog = new ContactDialog(*this, m_db,
+                                    [this](const Contact& c){ on_contact_saved(c, false); },
+                                    *contact);
     dialog->set_modal(true);
 
     // Use signal_hide to properly cleanup when dialog closes
@@ -190,8 +360,8 @@ void MainWindow::on_delete_contact()
         if (response_id == Gtk::ResponseType::OK) {
             try {
                 m_db->delete_contact(*id);
-                refresh_list();
-                update_status();
+                remove_row(*id);
+                adjust_status(-1);
                 show_info("Contact deleted successfully");
             } catch (const DBException& e) {
                 show_error(std::string(e.what()));
@@ -219,11 +389,87 @@ void MainWindow::on_clear_search()
     refresh_list();
 }
 
+//-------------------- Sorting --------------------
+
+void MainWindow::on_column_clicked(const std::string& column)
+{
+    if (column == m_sort_column) {
+        m_sort_ascending = !m_sort_ascending;
+    } else {
+        m_sort_column = column;
+        m_sort_ascending = true;
+    }
+    apply_sort();
+    update_sort_indicators();
+}
+
+void MainWindow::apply_sort()
+{
+    m_client_sorted = true;
+    if (m_rows_by_id.size() < 2)
+        return;
+
+    // Collation keys are built once per column and reused for both directions
+    if (m_sorter_column != m_sort_column) {
+        m_sorter.build_keys(m_contacts.size(), [this](std::size_t i) {
+            return contact_field(m_contacts.row(i), m_sort_column);
+        });
+        m_sorter_column = m_sort_column;
+    }
+
+    // Keys only order by the sort column; sorts_before settles the rest,
+    // so rows saved later are placed the same way
+    auto perm = m_sorter.sort(m_sort_ascending, [this](std::size_t a, std::size_t b) {
+        return sorts_before(a, b);
+    });
+    perm.erase(std::remove_if(perm.begin(), perm.end(), [this](std::size_t i) { return !m_shown[i]; }),
+               perm.end());
+
+    // ListStore::reorder wants new_order[new_pos] = current store position
+    std::vector<std::size_t> store_pos(m_contacts.size());
+    std::size_t pos = 0;
+    for (const auto& row : m_ref_list_store->children())
+        store_pos[row.get_value(m_columns.col_row)] = pos++;
+
+    std::vector<int> new_order(perm.size());
+    for (std::size_t i = 0; i < perm.size(); ++i)
+        new_order[i] = static_cast<int>(store_pos[perm[i]]);
+
+    m_ref_list_store->reorder(new_order);
+}
+
+void MainWindow::update_sort_indicators()
+{
+    // Column 0 is the hidden ID column
+    int i = 1;
+    contact_fields::for_each<contact_fields::editable>([this, &i](const auto& f) {
+        auto* col = m_tree_view.get_column(i++);
+        if (!col)
+            return;
+        col->set_sort_indicator(contact_fields::same_name(f.name, m_sort_column));
+        col->set_sort_order(m_sort_ascending ? Gtk::SortType::ASCENDING
+                                             : Gtk::SortType::DESCENDING);
+    });
+}
+
+std::string_view MainWindow::contact_field(const ContactTable::Row& c, const std::string& column)
+{
+    std::string_view value = c.last_name;
+    contact_fields::for_each<contact_fields::editable>([&](const auto& f) {
+        if (contact_fields::same_name(f.name, column))
+            value = f.get(c);
+    });
+    return value;
+}
+
 //-------------------- Row Activation --------------------
 
 void MainWindow::on_row_activated([[maybe_unused]] const Gtk::TreeModel::Path& path,
                                   [[maybe_unused]] Gtk::TreeViewColumn* column)
 {
+    // Rows shown from a snapshot cannot be edited until the store is open
+    if (!m_db)
+        return;
     on_edit_contact();
 }
 
@@ -231,7 +477,7 @@ void MainWindow::on_row_activated([[maybe_unused]] const Gtk::TreeModel::Path& p
 
 void MainWindow::on_import_csv()
 {
-    auto* dialog = new Gtk::FileChooserDialog(*this, "Import Contacts from CSV", Gtk::FileChooser::Action::OPEN);
+    auto* dialog = new Gtk::FileChooserDialog(*this, "Import Contacts", Gtk::FileChooser::Action::OPEN);
     dialog->set_modal(true);
 
     dialog->add_button("Cancel", Gtk::ResponseType::CANCEL);
@@ -240,48 +486,17 @@ void MainWindow::on_import_csv()
     auto filter = Gtk::FileFilter::create();
     filter->set_name("CSV files");
     filter->add_pattern("*.csv");
+    filter->add_pattern("*.csv.gz");
+    if (codec_available(Codec::zstd))
+        filter->add_pattern("*.csv.zst");
     dialog->add_filter(filter);
+    add_format_filters(*dialog);
 
     dialog->signal_response().connect([this, dialog](int response_id){
         if (response_id == Gtk::ResponseType::ACCEPT) {
             auto file = dialog->get_file();
-            if (file) {
-                std::ifstream infile(file->get_path());
-                if (!infile.is_open()) {
-                    show_error("Failed to open file");
-                    dialog->close();
-                    delete dialog;
-                    return;
-                }
-
-                std::vector<Contact> contacts;
-                std::string line;
-                bool first_line = true;
-
-                while (std::getline(infile, line)) {
-                    if (first_line) { first_line = false; continue; }
-                    std::stringstream ss(line);
-                    std::string first, last, email, mobile;
-
-                    std::getline(ss, first, ',');
-                    std::getline(ss, last, ',');
-                    std::getline(ss, email, ',');
-                    std::getline(ss, mobile, ',');
-
-                    if (!first.empty() || !last.empty())
-                        contacts.push_back(Contact{0, first, last, email, mobile});
-                }
-
-                if (contacts.empty()) {
-                    show_info("No valid contacts found in CSV");
-                } else if (m_db->import_contacts(contacts)) {
-                    refresh_list();
-                    update_status();
-                    show_info("Successfully imported " + std::to_string(contacts.size()) + " contacts");
-                } else {
-                    show_error("Failed to import contacts");
-                }
-            }
+            if (file)
+                start_import(file->get_path());
         }
         dialog->close();
         delete dialog;
@@ -290,9 +505,129 @@ void MainWindow::on_import_csv()
     dialog->present();
 }
 
+void MainWindow::add_format_filters(Gtk::FileChooserDialog& dialog)
+{
+    static const std::pair<const char*, std::vector<const char*>> formats[] = {
+        {"vCard files", {"*.vcf"}},
+        {"JSON Lines files", {"*.jsonl", "*.ndjson"}},
+    };
+    for (const auto& [name, patterns] : formats) {
+        auto filter = Gtk::FileFilter::create();
+        filter->set_name(name);
+        for (const char* pattern : patterns) {
+            filter->add_pattern(pattern);
+            filter->add_pattern(std::string(pattern) + ".gz");
+            if (codec_available(Codec::zstd))
+                filter->add_pattern(std::string(pattern) + ".zst");
+        }
+        dialog.add_filter(filter);
+    }
+}
+
+void MainWindow::start_import(const std::string& path)
+{
+    auto db = m_db;
+    set_controls_sensitive(false);
+    m_status_label.set_text("Importing...");
+
+    m_import_task.run(
+        [this, db, path](const TaskContext& ctx) {
+            // Importing the same unchanged file again resumes an interrupted run
+            ImportOptions options;
+            options.job_key = import_job_key(path);
+
+            auto report = [this, &ctx](const ImportProgress& progress) {
+                ctx.post([this, progress]() { show_import_progress(progress); });
+            };
+
+            // Single-connection import; total_bytes 0 when the size is unknown
+            auto stream_import = [&](ContactSource& source, std::size_t total_bytes) {
+                ImportProgress progress;
+                progress.total_bytes = total_bytes;
+                progress.rows_resumed = db->load_import_journal(options.job_key).rows_committed();
+                auto on_batch = [&](std::size_t imported) {
+                    progress.rows_imported = imported;
+                    progress.bytes_parsed = source.position();
+                    report(progress);
+                    return !ctx.cancelled();
+                };
+                progress.rows_imported = db->import_stream(source, {}, on_batch, options.job_key);
+                progress.rows_rejected = source.rejected();
+                return progress;
+            };
+
+            // Compressed files are decoded as a stream. Decoding is serial,
+            // so the parallel pipeline would have nothing to split.
+            const ContactFormat format = format_for_path(path);
+            if (codec_for_path(path) != Codec::none) {
+                auto source = open_contact_source(path);
+                return stream_import(*source, 0);
+            }
+            if (format == ContactFormat::vcard) {
+                auto source = open_contact_source(path);
+                return stream_import(*source, std::filesystem::file_size(path));
+            }
+            if (format == ContactFormat::jsonl) {
+                MappedFile mapped(path);
+                JsonlContactSource source(mapped);
+                return stream_import(source, mapped.size());
+            }
+
+            // Files that fit in one parse chunk gain nothing from extra
+            // connections and threads; stream them over this connection.
+            MappedFile mapped(path);
+            if (mapped.size() <= options.chunk_bytes) {
+                CsvContactSource source(mapped);
+                return stream_import(source, mapped.size());
+            }
+
+            ImportPipeline pipeline(*db, options);
+            return pipeline.run(mapped, report, [&ctx]() { return ctx.cancelled(); });
+        },
+        [this, path](ImportProgress result) {
+            set_controls_sensitive(true);
+            refresh_list();
+            update_status();
+
+            std::string skipped = result.rows_rejected
+                ? " (" + std::to_string(result.rows_rejected) + " invalid rows skipped)"
+                : "";
+            std::string resumed = result.rows_resumed
+                ? "\nResumed an interrupted import; " + std::to_string(result.rows_resumed) +
+                  " contacts had already been imported."
+                : "";
+            if (result.rows_imported == 0 && result.rows_resumed == 0)
+                show_info(std::string("No valid ") + format_name(format_for_path(path)) +
+                          " contacts found in " + std::filesystem::path(path).filename().string() +
+                          skipped);
+            else
+                show_info("Successfully imported " + std::to_string(result.rows_imported) +
+                          " contacts" + skipped + resumed);
+        },
+        [this](const std::string& error) {
+            // Batches committed before the failure are kept, so reload
+            set_controls_sensitive(true);
+            refresh_list();
+            update_status();
+            show_error("Failed to import contacts: " + error +
+                       "\nRows imported before the error have been kept; importing the same "
+                       "file again resumes where it stopped.");
+        });
+}
+
+void MainWindow::show_import_progress(const ImportProgress& progress)
+{
+    std::string text = "Importing... " + std::to_string(progress.rows_imported) + " contacts";
+    if (progress.total_bytes) {
+        auto percent = progress.bytes_parsed * 100 / progress.total_bytes;
+        text += " (" + std::to_string(percent) + "% parsed)";
+    }
+    m_status_label.set_text(text);
+}
+
 void MainWindow::on_export_csv()
 {
-    auto* dialog = new Gtk::FileChooserDialog(*this, "Export Contacts to CSV", Gtk::FileChooser::Action::SAVE);
+    auto* dialog = new Gtk::FileChooserDialog(*this, "Export Contacts", Gtk::FileChooser::Action::SAVE);
     dialog->set_modal(true);
 
     dialog->add_button("Cancel", Gtk::ResponseType::CANCEL);
@@ -301,30 +636,19 @@ void MainWindow::on_export_csv()
     auto filter = Gtk::FileFilter::create();
     filter->set_name("CSV files");
     filter->add_pattern("*.csv");
+    filter->add_pattern("*.csv.gz");
+    if (codec_available(Codec::zstd))
+        filter->add_pattern("*.csv.zst");
     dialog->add_filter(filter);
+    add_format_filters(*dialog);
 
     dialog->set_current_name("contacts.csv");
 
     dialog->signal_response().connect([this, dialog](int response_id){
         if (response_id == Gtk::ResponseType::ACCEPT) {
             auto file = dialog->get_file();
-            if (file) {
-                std::ofstream outfile(file->get_path());
-                if (!outfile.is_open()) {
-                    show_error("Failed to create file");
-                    dialog->close();
-                    delete dialog;
-                    return;
-                }
-
-                outfile << "First Name,Last Name,Email,Mobile\n";
-                auto contacts = m_db->get_all_contacts();
-                for (const auto& c : contacts) {
-                    outfile << c.first_name << "," << c.last_name << "," << c.email << "," << c.mobile << "\n";
-                }
-
-                show_info("Successfully exported " + std::to_string(contacts.size()) + " contacts");
-            }
+            if (file)
+                start_export(file->get_path());
         }
         dialog->close();
         delete dialog;
@@ -333,36 +657,237 @@ void MainWindow::on_export_csv()
     dialog->present();
 }
 
+void MainWindow::start_export(const std::string& path)
+{
+    auto db = m_db;
+    set_controls_sensitive(false);
+    m_status_label.set_text("Exporting...");
+
+    // Export what the list shows: the active search, in the active order.
+    // Without a search a large table is worth more exported in parallel id
+    // ranges than in the list's order.
+    ExportOptions options;
+    options.view = ContactQuery{m_current_search, m_sort_column, m_sort_ascending};
+    options.id_order_ok = true;
+    // contacts.vcf writes vCards; a .gz / .zst suffix compresses as it writes
+    options.format = format_for_path(path);
+    options.file.codec = codec_for_path(path);
+
+    m_export_task.run(
+        [this, db, path, options](const TaskContext& ctx) {
+            ContactExporter exporter(*db, options);
+            return exporter.run(path,
+                [this, &ctx](const ExportProgress& progress) {
+                    ctx.post([this, progress]() { show_export_progress(progress); });
+                },
+                [&ctx]() { return ctx.cancelled(); });
+        },
+        [this](ExportProgress result) {
+            set_controls_sensitive(true);
+            update_status();
+            show_info("Successfully exported " + std::to_string(result.rows_written) + " contacts" +
+                      (result.id_order ? " in id order" : ""));
+        },
+        [this](const std::string& error) {
+            set_controls_sensitive(true);
+            update_status();
+            show_error("Failed to export contacts: " + error);
+        });
+}
+
+void MainWindow::show_export_progress(const ExportProgress& progress)
+{
+    std::string text = "Exporting... " + std::to_string(progress.rows_written) + " contacts";
+    if (progress.total_rows) {
+        auto percent = std::min<std::size_t>(progress.rows_written * 100 / progress.total_rows, 100);
+        text += " (" + std::to_string(percent) + "%)";
+    }
+    m_status_label.set_text(text);
+}
+
 //-------------------- List / Status --------------------
 
 void MainWindow::refresh_list()
 {
-    m_ref_list_store->clear();
+    m_list_loader.cancel();
+    // A full reload supersedes whatever the snapshot still had to deliver
+    m_snapshot_loading = false;
+    m_pending_delta.reset();
 
-    std::vector<Contact> contacts;
     try {
-        if (!m_current_search.empty())
-            contacts = m_db->search_contacts(m_current_search);
-        else
-            contacts = m_db->get_all_contacts();
-
-        for (const auto& c : contacts) {
-            auto row = *(m_ref_list_store->append());
-            row[m_columns.col_id] = c.id;
-            row[m_columns.col_first] = c.first_name;
-            row[m_columns.col_last] = c.last_name;
-            row[m_columns.col_email] = c.email;
-            row[m_columns.col_mobile] = c.mobile;
+        ContactTable rows;
+        if (!m_current_search.empty()) {
+            // The result only lives until it is copied into the table
+            std::pmr::monotonic_buffer_resource arena;
+            auto found = m_db->search_contacts(m_current_search, &arena);
+            for (const auto& c : found)
+                rows.append(c.id, c.first_name, c.last_name, c.email, c.mobile, c.updated_at);
+        } else {
+            m_db->get_contacts_page(0, 0, rows);
         }
+        show_rows(std::move(rows));
     } catch (const DBException& e) {
         show_error("Failed to load contacts: " + std::string(e.what()));
     }
 }
 
+void MainWindow::show_rows(ContactTable contacts)
+{
+    m_ref_list_store->clear();
+    m_rows_by_id.clear();
+    m_contacts.clear();
+    m_shown.clear();
+    m_sorter.clear();
+    m_sorter_column.clear();
+    m_client_sorted = false;
+
+    append_rows(std::move(contacts));
+}
+
+void MainWindow::append_rows(ContactTable contacts, std::size_t first)
+{
+    std::size_t begin = m_contacts.size();
+    if (m_contacts.empty() && first == 0) {
+        m_contacts = std::move(contacts);
+    } else {
+        m_contacts.reserve(begin + contacts.size() - first, m_contacts.arena_bytes() + contacts.arena_bytes());
+        for (std::size_t i = first; i < contacts.size(); ++i) {
+            // Rows saved while the rest of the list was loading are already shown
+            if (!m_rows_by_id.count(contacts.id(i)))
+                m_contacts.append(contacts.row(i));
+        }
+    }
+    m_shown.resize(m_contacts.size(), true);
+
+    m_rows_by_id.reserve(m_rows_by_id.size() + m_contacts.size() - begin);
+    for (std::size_t i = begin; i < m_contacts.size(); ++i) {
+        auto iter = m_ref_list_store->append();
+        auto row = *iter;
+        set_row_values(row, i);
+        m_rows_by_id[m_contacts.id(i)] = iter;
+    }
+    m_sorter_column.clear();
+
+    // The DB already returns rows by last name; only re-sort for other
+    // orders, or once the list has been sorted here
+    if (m_client_sorted || m_sort_column != "last_name" || !m_sort_ascending)
+        apply_sort();
+}
+
 void MainWindow::update_status()
 {
-    int count = m_db->get_contact_count();
-    m_status_label.set_text("Total contacts: " + std::to_string(count));
+    m_total_contacts = m_db->get_contact_count();
+    adjust_status(0);
+}
+
+void MainWindow::adjust_status(int delta)
+{
+    m_total_contacts += delta;
+    m_status_label.set_text("Total contacts: " + std::to_string(m_total_contacts));
+}
+
+//-------------------- Single-row Patching --------------------
+
+void MainWindow::on_contact_saved(const Contact& contact, bool is_new)
+{
+    upsert_row(contact);
+    if (is_new)
+        adjust_status(1);
+}
+
+void MainWindow::upsert_row(const Contact& contact)
+{
+    if (m_rows_by_id.count(contact.id))
+        remove_row(contact.id);
+
+    if (!m_current_search.empty() && !matches_search(contact, m_current_search))
+        return;
+
+    std::size_t index = m_contacts.size();
+    m_contacts.append(contact);
+    m_shown.push_back(true);
+    std::size_t pos = sorted_position(index);
+
+    auto iter = pos < m_rows_by_id.size()
+        ? m_ref_list_store->insert(m_ref_list_store->get_iter(Gtk::TreeModel::Path(1, static_cast<int>(pos))))
+        : m_ref_list_store->append();
+    auto row = *iter;
+    set_row_values(row, index);
+    m_rows_by_id[contact.id] = iter;
+    m_sorter_column.clear();
+}
+
+void MainWindow::remove_row(ContactId id)
+{
+    auto found = m_rows_by_id.find(id);
+    if (found == m_rows_by_id.end())
+        return;
+
+    // The row stays in m_contacts, so indexes and sort keys stay valid
+    std::size_t index = (*found->second)[m_columns.col_row];
+    m_shown[index] = false;
+    m_ref_list_store->erase(found->second);
+    m_rows_by_id.erase(found);
+}
+
+std::size_t MainWindow::sorted_position(std::size_t row) const
+{
+    // Binary search over the displayed order. The ListStore keeps its rows
+    // in a balanced tree, so each probe and the insert that follows are
+    // O(log n) and a save never touches every row.
+    std::size_t lo = 0;
+    std::size_t hi = m_rows_by_id.size();
+    while (lo < hi) {
+        std::size_t mid = lo + (hi - lo) / 2;
+        if (sorts_before(row_at(mid), row))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+bool MainWindow::sorts_before(std::size_t row_a, std::size_t row_b) const
+{
+    ContactTable::Row a = m_contacts.row(row_a);
+    ContactTable::Row b = m_contacts.row(row_b);
+
+    // Compare the way the list was ordered: rows straight from the store
+    // are in its by-name order, re-sorted rows in m_sorter's collation.
+    // Either way first name follows last name, then id breaks ties, all
+    // in the sort's direction as the stores order them.
+    if (!m_client_sorted)
+        return ContactLess("last_name", true)(a, b);
+
+    int cmp = m_sorter.compare(contact_field(a, m_sort_column), contact_field(b, m_sort_column));
+    if (cmp == 0 && m_sort_column == "last_name")
+        cmp = m_sorter.compare(a.first_name, b.first_name);
+    if (cmp == 0)
+        cmp = (a.id > b.id) - (a.id < b.id);
+    return m_sort_ascending ? cmp < 0 : cmp > 0;
+}
+
+std::size_t MainWindow::row_at(std::size_t position) const
+{
+    auto iter = m_ref_list_store->get_iter(Gtk::TreeModel::Path(1, static_cast<int>(position)));
+    return (*iter)[m_columns.col_row];
+}
+
+void MainWindow::set_row_values(Gtk::TreeModel::Row& row, std::size_t index)
+{
+    ContactTable::Row c = m_contacts.row(index);
+    row[m_columns.col_id] = c.id;
+    row[m_columns.col_row] = index;
+    std::size_t i = 0;
+    contact_fields::for_each<contact_fields::editable>([&](const auto& f) {
+        row[m_columns.col_fields[i++]] = std::string(f.get(c));
+    });
+}
+
+bool MainWindow::matches_search(const Contact& c, const std::string& query)
+{
+    // Same folding as the search_key that ContactStore::search_contacts matches
+    return ::matches_search(c, query);
 }
 
 //-------------------- Dialogs --------------------
@@ -399,7 +924,7 @@ void MainWindow::show_info(const std::string& message)
 
 //-------------------- Helpers --------------------
 
-std::optional<int> MainWindow::get_selected_id()
+std::optional<ContactId> MainWindow::get_selected_id()
 {
     auto selection = m_tree_view.get_selection();
     if (!selection) return std::nullopt;
@@ -409,3 +934,15 @@ std::optional<int> MainWindow::get_selected_id()
 
     return (*iter)[m_columns.col_id];
 }
+
+std::optional<Contact> MainWindow::get_selected_contact()
+{
+    auto selection = m_tree_view.get_selection();
+    if (!selection) return std::nullopt;
+
+    auto iter = selection->get_selected();
+    if (!iter) return std::nullopt;
+
+    std::size_t index = (*iter)[m_columns.col_row];
+    return m_contacts.contact(index);
+}
@@ -0,0 +1,87 @@
+#include "MappedFile.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <system_error>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "Cannot open " + path);
+    }
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+        int err = errno;
+        ::close(fd);
+        throw std::system_error(err, std::generic_category(), "Cannot stat " + path);
+    }
+
+    m_size = static_cast<std::size_t>(st.st_size);
+    if (m_size > 0) {
+        void* addr = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            int err = errno;
+            ::close(fd);
+            throw std::system_error(err, std::generic_category(), "Cannot map " + path);
+        }
+        m_data = static_cast<const char*>(addr);
+    }
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    unmap();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+: m_data(std::exchange(other.m_data, nullptr)),
+  m_size(std::exchange(other.m_size, 0))
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other) {
+        unmap();
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+    }
+    return *this;
+}
+
+void MappedFile::advise_sequential()
+{
+    if (m_data) {
+        ::madvise(const_cast<char*>(m_data), m_size, MADV_SEQUENTIAL);
+    }
+}
+
+void MappedFile::release(std::size_t offset, std::size_t length)
+{
+    if (!m_data || offset >= m_size)
+        return;
+
+    // Only whole pages can be released; round the range inwards
+    const std::size_t page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    std::size_t begin = (offset + page - 1) / page * page;
+    std::size_t end = std::min(offset + length, m_size) / page * page;
+    if (begin < end)
+        ::madvise(const_cast<char*>(m_data) + begin, end - begin, MADV_DONTNEED);
+}
+
+void MappedFile::unmap()
+{
+    if (m_data) {
+        ::munmap(const_cast<char*>(m_data), m_size);
+        m_data = nullptr;
+        m_size = 0;
+    }
+}
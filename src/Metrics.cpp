@@ -0,0 +1,28 @@
+#include "Metrics.hpp"
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace metrics {
+
+void record(const std::string& name, double milliseconds)
+{
+    std::ostringstream value;
+    value << std::fixed << std::setprecision(1) << milliseconds;
+
+    std::cout << "[metric] " << name << " = " << value.str() << " ms\n";
+
+    const char* path = std::getenv("CONTACTS_METRICS_FILE");
+    if (!path || !*path)
+        return;
+
+    std::ofstream file(path, std::ios::app);
+    if (file.is_open()) {
+        file << std::time(nullptr) << " " << name << " " << value.str() << "\n";
+    }
+}
+
+} // namespace metrics
@@ -0,0 +1,356 @@
+#include "VCard.hpp"
+#include <cctype>
+#include <vector>
+
+namespace {
+
+bool iequals(std::string_view a, std::string_view b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        if (std::toupper(static_cast<unsigned char>(a[i])) != std::toupper(static_cast<unsigned char>(b[i])))
+            return false;
+    }
+    return true;
+}
+
+bool istarts_with(std::string_view s, std::string_view prefix)
+{
+    return s.size() >= prefix.size() && iequals(s.substr(0, prefix.size()), prefix);
+}
+
+// "item1.EMAIL;TYPE=INTERNET,pref:a@b.c" -> name EMAIL, params, value
+struct Property {
+    std::string_view name;
+    std::string_view params;
+    std::string_view value;
+};
+
+bool split_property(std::string_view line, Property& prop)
+{
+    // Parameter values may be quoted and contain ':'
+    bool quoted = false;
+    std::size_t colon = std::string_view::npos;
+    for (std::size_t i = 0; i < line.size(); ++i) {
+        if (line[i] == '"')
+            quoted = !quoted;
+        else if (line[i] == ':' && !quoted) {
+            colon = i;
+            break;
+        }
+    }
+    if (colon == std::string_view::npos)
+        return false;
+
+    std::string_view head = line.substr(0, colon);
+    std::size_t semi = head.find(';');
+    prop.name = head.substr(0, semi);
+    prop.params = semi == std::string_view::npos ? std::string_view() : head.substr(semi + 1);
+    std::size_t dot = prop.name.rfind('.');
+    if (dot != std::string_view::npos)
+        prop.name.remove_prefix(dot + 1);
+    prop.value = line.substr(colon + 1);
+    return true;
+}
+
+// True if a parameter name or value equals token: matches "TYPE=CELL",
+// 2.1's bare "CELL", "TYPE=cell,voice" and 4.0's "PREF=1"
+bool has_param(std::string_view params, std::string_view token)
+{
+    std::size_t start = 0;
+    for (std::size_t i = 0; i <= params.size(); ++i) {
+        if (i == params.size() || params[i] == ';' || params[i] == ',' || params[i] == '=') {
+            std::string_view word = params.substr(start, i - start);
+            if (!word.empty() && word.front() == '"' && word.back() == '"' && word.size() >= 2)
+                word = word.substr(1, word.size() - 2);
+            if (iequals(word, token))
+                return true;
+            start = i + 1;
+        }
+    }
+    return false;
+}
+
+bool is_quoted_printable(std::string_view line)
+{
+    Property prop;
+    return split_property(line, prop) && has_param(prop.params, "QUOTED-PRINTABLE");
+}
+
+int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+std::string decode_quoted_printable(std::string_view value)
+{
+    std::string out;
+    out.reserve(value.size());
+    for (std::size_t i = 0; i < value.size(); ++i) {
+        if (value[i] == '=' && i + 2 < value.size()) {
+            int hi = hex_value(value[i + 1]);
+            int lo = hex_value(value[i + 2]);
+            if (hi >= 0 && lo >= 0) {
+                out += static_cast<char>(hi * 16 + lo);
+                i += 2;
+                continue;
+            }
+        }
+        out += value[i];
+    }
+    return out;
+}
+
+std::string latin1_to_utf8(std::string_view value)
+{
+    std::string out;
+    out.reserve(value.size());
+    for (char ch : value) {
+        auto c = static_cast<unsigned char>(ch);
+        if (c < 0x80) {
+            out += ch;
+        }
+        else {
+            out += static_cast<char>(0xC0 | (c >> 6));
+            out += static_cast<char>(0x80 | (c & 0x3F));
+        }
+    }
+    return out;
+}
+
+// Raw property value as UTF-8 text, before unescaping
+std::string decode_value(const Property& prop)
+{
+    std::string value = has_param(prop.params, "QUOTED-PRINTABLE")
+        ? decode_quoted_printable(prop.value)
+        : std::string(prop.value);
+    if (has_param(prop.params, "ISO-8859-1") || has_param(prop.params, "LATIN1") ||
+        has_param(prop.params, "WINDOWS-1252"))
+        value = latin1_to_utf8(value);
+    return value;
+}
+
+// Split a structured value on unescaped ';' and undo text escaping
+std::vector<std::string> split_components(std::string_view value)
+{
+    std::vector<std::string> parts(1);
+    for (std::size_t i = 0; i < value.size(); ++i) {
+        char c = value[i];
+        if (c == '\\' && i + 1 < value.size()) {
+            char e = value[++i];
+            parts.back() += (e == 'n' || e == 'N') ? '\n' : e;
+        }
+        else if (c == ';') {
+            parts.emplace_back();
+        }
+        else {
+            parts.back() += c;
+        }
+    }
+    return parts;
+}
+
+std::string unescape_text(std::string_view value)
+{
+    std::string out;
+    out.reserve(value.size());
+    for (std::size_t i = 0; i < value.size(); ++i) {
+        if (value[i] == '\\' && i + 1 < value.size()) {
+            char e = value[++i];
+            out += (e == 'n' || e == 'N') ? '\n' : e;
+        }
+        else {
+            out += value[i];
+        }
+    }
+    return out;
+}
+
+void escape_text(std::string& out, std::string_view value)
+{
+    for (char c : value) {
+        switch (c) {
+        case '\\': out += "\\\\"; break;
+        case ',':  out += "\\,"; break;
+        case ';':  out += "\\;"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': break;
+        default:   out += c;
+        }
+    }
+}
+
+} // namespace
+
+// -----------------------------
+// VCardContactSource
+// -----------------------------
+VCardContactSource::VCardContactSource(std::unique_ptr<ByteSource> input)
+: m_input(std::move(input)),
+  m_lines(*m_input)
+{
+}
+
+bool VCardContactSource::next_line()
+{
+    std::string_view line;
+    if (!m_lines.next(line))
+        return false;
+    m_line.assign(line);
+
+    for (;;) {
+        // 2.1 quoted-printable soft line break: a trailing '=' continues
+        // the value on the next line, which is not indented
+        if (!m_line.empty() && m_line.back() == '=' && is_quoted_printable(m_line)) {
+            if (!m_lines.next(line))
+                break;
+            m_line.pop_back();
+            m_line.append(line);
+            continue;
+        }
+        // RFC 6350 folding: a line starting with a space or tab continues the last
+        int c = m_lines.peek();
+        if (c != ' ' && c != '\t')
+            break;
+        m_lines.next(line);
+        m_line.append(line.substr(1));
+    }
+    return true;
+}
+
+bool VCardContactSource::next(Contact& contact)
+{
+    for (;;) {
+        std::uint64_t card_start = m_lines.offset();
+        if (!next_line())
+            return false;
+        if (!iequals(m_line, "BEGIN:VCARD"))
+            continue; // stray text between cards
+
+        std::string family, given, formatted, email, tel;
+        int email_rank = 0;
+        int tel_rank = 0;
+
+        while (next_line() && !iequals(m_line, "END:VCARD")) {
+            Property prop;
+            if (!split_property(m_line, prop))
+                continue;
+
+            if (iequals(prop.name, "N")) {
+                auto parts = split_components(decode_value(prop));
+                family = parts[0];
+                given = parts.size() > 1 ? parts[1] : std::string();
+            }
+            else if (iequals(prop.name, "FN")) {
+                formatted = unescape_text(decode_value(prop));
+            }
+            else if (iequals(prop.name, "EMAIL")) {
+                int rank = has_param(prop.params, "PREF") ? 2 : 1;
+                if (rank > email_rank) {
+                    email = unescape_text(decode_value(prop));
+                    email_rank = rank;
+                }
+            }
+            else if (iequals(prop.name, "TEL")) {
+                int rank = 1 + (has_param(prop.params, "CELL") ? 2 : 0) + (has_param(prop.params, "PREF") ? 1 : 0);
+                if (rank > tel_rank) {
+                    tel = unescape_text(decode_value(prop));
+                    if (istarts_with(tel, "tel:"))
+                        tel.erase(0, 4); // 4.0 URI form
+                    tel_rank = rank;
+                }
+            }
+        }
+
+        // Cards with only a formatted name: "Given Family"
+        if (family.empty() && given.empty() && !formatted.empty()) {
+            std::size_t space = formatted.rfind(' ');
+            if (space == std::string::npos) {
+                given = formatted;
+            }
+            else {
+                given = formatted.substr(0, space);
+                family = formatted.substr(space + 1);
+            }
+        }
+
+        contact = Contact{0, given, family, email, tel};
+        if (is_importable(contact)) {
+            m_record_offset = card_start;
+            return true;
+        }
+        ++m_rejected;
+    }
+}
+
+// -----------------------------
+// VCardWriter
+// -----------------------------
+VCardWriter::VCardWriter(FileWriter& out, int version)
+: m_out(out),
+  m_version(version == 4 ? 4 : 3)
+{
+}
+
+void VCardWriter::write(const Contact& c)
+{
+    std::string value;
+
+    m_out.write("BEGIN:VCARD\r\n");
+    property("VERSION", m_version == 4 ? "4.0" : "3.0");
+
+    escape_text(value, c.last_name);
+    value += ';';
+    escape_text(value, c.first_name);
+    value += ";;;";
+    property("N", value);
+
+    // FN is mandatory and must not be empty
+    std::string full = c.first_name;
+    if (!c.last_name.empty())
+        full += (full.empty() ? "" : " ") + c.last_name;
+    if (full.empty())
+        full = !c.email.empty() ? c.email : c.mobile;
+    value.clear();
+    escape_text(value, full);
+    property("FN", value);
+
+    if (!c.email.empty()) {
+        value.clear();
+        escape_text(value, c.email);
+        property(m_version == 4 ? "EMAIL" : "EMAIL;TYPE=INTERNET", value);
+    }
+    if (!c.mobile.empty()) {
+        value.clear();
+        escape_text(value, c.mobile);
+        property(m_version == 4 ? "TEL;VALUE=text;TYPE=cell" : "TEL;TYPE=CELL", value);
+    }
+    m_out.write("END:VCARD\r\n");
+}
+
+void VCardWriter::property(std::string_view name, std::string_view value)
+{
+    m_line.assign(name);
+    m_line += ':';
+    m_line.append(value);
+
+    // Fold at 75 octets, never inside a UTF-8 sequence; continuation lines
+    // spend one octet on the leading space
+    std::string_view rest(m_line);
+    std::size_t limit = 75;
+    while (rest.size() > limit) {
+        std::size_t cut = limit;
+        while (cut > 1 && (static_cast<unsigned char>(rest[cut]) & 0xC0) == 0x80)
+            --cut;
+        m_out.write(rest.substr(0, cut));
+        m_out.write("\r\n ");
+        rest.remove_prefix(cut);
+        limit = 74;
+    }
+    m_out.write(rest);
+    m_out.write("\r\n");
+}
@@ -2,8 +2,17 @@
 #include "DBConnectionDialog.hpp"
 #include "MainWindow.hpp"
 #include "DB.hpp"
+#include "InMemoryStore.hpp"
+#include "LogStore.hpp"
+#include "ContactSnapshot.hpp"
+#include "BackgroundTask.hpp"
+#include "Metrics.hpp"
+#include <cstdlib>
+#include <iterator>
 #include <memory>
+#include <optional>
 #include <iostream>
+#include <vector>
 
 class ContactsApplication : public Gtk::Application {
 protected:
@@ -11,43 +20,55 @@ protected:
         : Gtk::Application("com.contacts.app") {}
 
     void on_activate() override {
+        // CONTACTS_STORE=memory starts on an empty in-process store, so the
+        // UI and import/export can be timed without a server
+        const char* store = std::getenv("CONTACTS_STORE");
+        if (store && std::string(store) == "memory") {
+            open_store_async("in-memory store", []() {
+                return std::make_shared<InMemoryStore>();
+            });
+            return;
+        }
+        // CONTACTS_STORE=log[:dir] runs on the embedded log store, for
+        // machines with no server to reach
+        if (store && std::string(store).rfind("log", 0) == 0) {
+            std::string spec(store);
+            std::string dir = spec.size() > 4 && spec[3] == ':'
+                ? spec.substr(4)
+                : default_store_dir();
+            open_store_async(dir, [dir]() {
+                return std::make_shared<LogStore>(dir);
+            });
+            return;
+        }
         show_connection_dialog();
     }
 
-    void show_connection_dialog() {
-        // Heap-allocate dialog for GTKmm 4 async usage
-        auto* dialog = new DBConnectionDialog([this](const std::string& host,
-                                                     unsigned int port,
-                                                     const std::string& user,
-                                                     const std::string& password) {
-            try {
-                // Create DB instance
-                m_db = std::make_shared<DB>(host, user, password, "Contacts", port);
+    // ~/.local/share/contacts-app/store; GLib's user data directory when
+    // HOME is unset, as it can be under systemd or a minimal environment
+    static std::string default_store_dir() {
+        const char* home = std::getenv("HOME");
+        std::string data = home && *home ? std::string(home) + "/.local/share"
+                                         : Glib::get_user_data_dir();
+        return data + "/contacts-app/store";
+    }
 
-                // Test connection
-                if (!m_db->test_connection()) {
-                    throw std::runtime_error("Connection test failed");
-                }
+    // Everything the main window needs before it can show data. Built on a
+    // worker thread so a slow or unreachable server never blocks GTK.
+    struct StartupData {
+        std::shared_ptr<ContactStore> db;
+        ContactTable first_page;
+        int total_contacts = 0;
+        // Set instead of first_page when the window is showing a snapshot
+        std::optional<SnapshotDelta> delta;
+    };
 
-                // Open main window
-                auto* window = new MainWindow(m_db);
-                add_window(*window);
-                window->present();
+    static constexpr std::size_t kFirstPageSize = 200;
 
-                std::cout << "Application started successfully\n";
-            }
-            catch (const DBException& e) {
-                show_error_dialog("Database Error", e.what(), [this](){
-                    show_connection_dialog();
-                });
-            }
-            catch (const std::exception& e) {
-                show_error_dialog("Connection Error",
-                                  "Failed to connect to database:\n" + std::string(e.what()),
-                                  [this](){
-                    show_connection_dialog();
-                });
-            }
+    void show_connection_dialog() {
+        // Heap-allocate dialog for GTKmm 4 async usage
+        auto* dialog = new DBConnectionDialog([this](const ConnectionSettings& settings) {
+            connect_async(settings);
         });
 
         add_window(*dialog);
@@ -59,6 +80,143 @@ protected:
         dialog->present();
     }
 
+    void connect_async(const ConnectionSettings& settings) {
+        std::string server = settings.host + ":" + std::to_string(settings.port);
+        open_store_async(server, [settings]() {
+            return std::make_shared<DB>(settings);
+        }, settings.user + "@" + server + "/" + settings.database);
+    }
+
+    // open runs on the worker thread and may block or throw. With a
+    // snapshot_source the list is cached between runs (see ContactSnapshot).
+    void open_store_async(const std::string& name,
+                          std::function<std::shared_ptr<ContactStore>()> open,
+                          const std::string& snapshot_source = {}) {
+        // The main window is built while the store is being set up. Each
+        // attempt gets its own, deleted when hidden: its BackgroundTasks
+        // drop whatever their workers still deliver.
+        auto* window = new MainWindow();
+        add_window(*window);
+        window->signal_hide().connect([window]() { delete window; });
+        window->set_snapshot_source(snapshot_source);
+
+        // Last session's rows go up before the server is even contacted
+        metrics::Stopwatch snapshot_open;
+        std::shared_ptr<const ContactSnapshot> snapshot;
+        if (!snapshot_source.empty())
+            snapshot = ContactSnapshot::open(snapshot_source);
+        if (snapshot && snapshot->size() > 0) {
+            window->show_snapshot(snapshot);
+            window->show_loading("Showing saved contacts; connecting to " + name + "...");
+            metrics::record("startup.snapshot_first_rows", snapshot_open.elapsed_ms());
+        } else {
+            snapshot.reset();
+            window->show_loading("Connecting to " + name + "...");
+        }
+        window->present();
+
+        auto abandon = [this, window]() {
+            m_connect_task.cancel();
+            discard_window(*window, [this]() { show_connection_dialog(); });
+        };
+        window->set_on_cancel_loading(abandon);
+
+        metrics::Stopwatch since_connect;
+
+        m_connect_task.run(
+            [open, window, snapshot](const TaskContext& ctx) {
+                StartupData data;
+                data.db = open();
+
+                // Test connection
+                if (!data.db->test_connection()) {
+                    throw std::runtime_error("Connection test failed");
+                }
+                if (ctx.cancelled()) return data;
+
+                ctx.post([window]() { window->show_loading("Checking database schema..."); });
+                metrics::Stopwatch schema_check;
+                data.db->initialize_schema();
+                metrics::record("startup.schema_check", schema_check.elapsed_ms());
+                if (ctx.cancelled()) return data;
+
+                data.total_contacts = data.db->get_contact_count();
+                if (snapshot) {
+                    ctx.post([window]() { window->show_loading("Checking for changes..."); });
+                    // Ids first: a row added after they are read still
+                    // arrives below as a change
+                    auto ids = data.db->get_contact_ids();
+                    auto changed = data.db->get_contacts_updated_since(snapshot->newest_updated_at());
+                    auto missing = data.db->get_contacts_by_ids(snapshot->missing(changed, ids));
+                    changed.insert(changed.end(), std::make_move_iterator(missing.begin()),
+                                   std::make_move_iterator(missing.end()));
+                    data.delta = snapshot->diff(std::move(changed), ids);
+                    return data;
+                }
+
+                ctx.post([window]() { window->show_loading("Loading contacts..."); });
+                data.db->get_contacts_page(0, kFirstPageSize, data.first_page);
+                return data;
+            },
+            [this, window, since_connect](StartupData data) {
+                start_search_key_backfill(data.db);
+                if (data.delta)
+                    window->attach_database(std::move(data.db), std::move(*data.delta),
+                                            data.total_contacts);
+                else
+                    window->attach_database(std::move(data.db),
+                                            std::move(data.first_page),
+                                            data.total_contacts);
+                metrics::record("startup.time_to_first_row", since_connect.elapsed_ms());
+                std::cout << "Application started successfully\n";
+            },
+            [this, window](const std::string& error) {
+                discard_window(*window, [this, error]() {
+                    show_error_dialog("Connection Error",
+                                      "Failed to connect to database:\n" + error,
+                                      [this](){
+                        show_connection_dialog();
+                    });
+                });
+            });
+    }
+
+    // Hides (and so deletes) a window whose store never opened, then runs
+    // show_next. The hold keeps the application running while it has no
+    // window between the two.
+    void discard_window(MainWindow& window, const std::function<void()>& show_next) {
+        hold();
+        window.hide();
+        show_next();
+        release();
+    }
+
+    // Rows written before the search_key column existed are matched field by
+    // field until keyed; key them in small batches on a handle of their
+    // own, so the UI's connection is never held for long. Stores with
+    // nothing to key return at once.
+    void start_search_key_backfill(const std::shared_ptr<ContactStore>& store) {
+        m_backfill_task.run(
+            [store](const TaskContext& ctx) {
+                auto worker = store->clone();
+                metrics::Stopwatch elapsed;
+                ContactId cursor = 0;
+                std::size_t keyed = 0;
+                while (!ctx.cancelled()) {
+                    std::size_t rows = worker->backfill_search_keys(cursor);
+                    if (rows == 0)
+                        break;
+                    keyed += rows;
+                }
+                if (keyed > 0)
+                    metrics::record("startup.search_key_backfill", elapsed.elapsed_ms());
+            },
+            []() {},
+            [](const std::string& error) {
+                std::cerr << "Search key backfill stopped: " << error << "\n";
+            });
+    }
+
     void show_error_dialog(const std::string& title,
                            const std::string& message,
                            std::function<void()> on_close = nullptr) {
@@ -81,6 +239,8 @@ protected:
 
         err_dialog->set_title(title);
         err_dialog->set_modal(true);
+        // Keeps the application running while this is its only window
+        add_window(*err_dialog);
 
         err_dialog->signal_hide().connect([err_dialog, on_close]() {
             if (on_close) on_close();
@@ -96,7 +256,8 @@ public:
     }
 
 private:
-    std::shared_ptr<DB> m_db;
+    BackgroundTask m_connect_task;
+    BackgroundTask m_backfill_task;
 };
 
 int main(int argc, char* argv[])